@@ -0,0 +1,127 @@
+/**
+ * Native implementation of the Arduino core stand-in: clock, GPIO, serial
+ * port and the `ESP` object.
+ */
+#include <Arduino.h>
+#include <NativeHal.hpp>
+#include <EEPROM.h>
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+namespace {
+bool     virtualClock = false;
+uint64_t virtualMicros = 0;
+
+const auto bootTime = std::chrono::steady_clock::now();
+
+uint8_t           modes[hal::NUM_PINS];
+uint8_t           levels[hal::NUM_PINS];
+uint32_t          writes[hal::NUM_PINS];
+hal::PinWriteHook pinWriteHook;
+
+uint32_t rtcMemory[128];
+}  // namespace
+
+namespace hal {
+
+void setVirtualClock(bool enabled) {
+  if (enabled && !virtualClock) virtualMicros = nowMicros();
+  virtualClock = enabled;
+}
+
+bool isVirtualClock() { return virtualClock; }
+
+void advanceMicros(uint64_t us) {
+  if (virtualClock) {
+    virtualMicros += us;
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  }
+}
+
+void advanceMillis(uint64_t ms) { advanceMicros(ms * 1000ULL); }
+
+uint64_t nowMicros() {
+  if (virtualClock) return virtualMicros;
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint8_t pinMode(uint8_t pin) { return pin < NUM_PINS ? modes[pin] : 0; }
+uint8_t pinLevel(uint8_t pin) { return pin < NUM_PINS ? levels[pin] : 0; }
+
+void setInputLevel(uint8_t pin, uint8_t level) {
+  if (pin < NUM_PINS) levels[pin] = level ? HIGH : LOW;
+}
+
+void setPinWriteHook(const PinWriteHook& hook) { pinWriteHook = hook; }
+
+uint32_t pinWriteCount(uint8_t pin) { return pin < NUM_PINS ? writes[pin] : 0; }
+
+void resetGpio() {
+  memset(modes, 0, sizeof(modes));
+  memset(levels, 0, sizeof(levels));
+  memset(writes, 0, sizeof(writes));
+}
+
+void writeOutputMask(uint32_t setMask, uint32_t clearMask) {
+  for (uint8_t pin = 0; pin < NUM_PINS; pin++) {
+    const uint32_t bit = 1UL << pin;
+    if ((setMask | clearMask) & bit) {
+      levels[pin] = (setMask & bit) ? HIGH : LOW;
+      writes[pin]++;
+      if (pinWriteHook) pinWriteHook(pin, levels[pin]);
+    }
+  }
+}
+
+}  // namespace hal
+
+unsigned long millis() { return (unsigned long)(hal::nowMicros() / 1000ULL); }
+unsigned long micros() { return (unsigned long)hal::nowMicros(); }
+void          delay(unsigned long ms) { hal::advanceMillis(ms); }
+void          delayMicroseconds(unsigned int us) { hal::advanceMicros(us); }
+void          yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= hal::NUM_PINS) return;
+  modes[pin] = mode;
+  if (mode == INPUT_PULLUP) levels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= hal::NUM_PINS) return;
+  hal::writeOutputMask(val ? (1UL << pin) : 0, val ? 0 : (1UL << pin));
+}
+
+int digitalRead(uint8_t pin) { return pin < hal::NUM_PINS ? levels[pin] : LOW; }
+
+size_t HardwareSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+void   HardwareSerial::flush() { fflush(stdout); }
+
+uint32_t EspClass::getFreeHeap() { return 40000; }
+uint32_t EspClass::getMaxFreeBlockSize() { return 30000; }
+uint8_t  EspClass::getHeapFragmentation() { return 25; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(hal::nowMicros() * getCpuFreqMHz()); }
+String   EspClass::getResetReason() { return String("Power On"); }
+void     EspClass::restart() { exit(0); }
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+  if (offset * 4 + size > sizeof(rtcMemory)) return false;
+  memcpy(data, reinterpret_cast<uint8_t*>(rtcMemory) + offset * 4, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+  if (offset * 4 + size > sizeof(rtcMemory)) return false;
+  memcpy(reinterpret_cast<uint8_t*>(rtcMemory) + offset * 4, data, size);
+  return true;
+}
+EEPROMClass EEPROM;
+
+GpioMaskRegister GPOS(true);
+GpioMaskRegister GPOC(false);
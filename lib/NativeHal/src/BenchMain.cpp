@@ -0,0 +1,68 @@
+/**
+ * Entry point of the native benchmark build: boots the sketch, runs one
+ * pass of loop() so that Homie's setup handler sets up the rules, and runs
+ * the benchmarks of src/Benchmark.hpp on the wall clock.
+ *
+ *   program [--set name=value]...
+ *
+ * The JSON lines of the benchmarks go to stdout, the log output of the
+ * firmware is discarded.
+ */
+#ifdef NATIVE_BENCH
+
+#include <Arduino.h>
+#include <Homie.hpp>
+#include <unistd.h>
+
+void setup();
+void loop();
+void runBenchmarks(Print& out);
+
+namespace {
+
+class FilePrint : public Print {
+public:
+  explicit FilePrint(FILE* file) : _file(file) {}
+  size_t write(uint8_t c) override { return fputc(c, _file) == EOF ? 0 : 1; }
+
+private:
+  FILE* _file;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    char* value = (strcmp(argv[i], "--set") == 0 && i + 1 < argc) ? strchr(argv[++i], '=') : nullptr;
+    if (value == nullptr) {
+      fprintf(stderr, "usage: %s [--set name=value]...\n", argv[0]);
+      return 2;
+    }
+    *value++ = '\0';
+
+    HomieInternals::IHomieSetting* setting = HomieInternals::IHomieSetting::find(argv[i]);
+    if (setting == nullptr || !setting->parse(value)) {
+      fprintf(stderr, "invalid setting: %s=%s\n", argv[i], value);
+      return 2;
+    }
+  }
+
+  // the results keep stdout, the serial port of the firmware goes to /dev/null
+  fflush(stdout);
+  FILE* results = fdopen(dup(fileno(stdout)), "w");
+  if (results == nullptr || freopen("/dev/null", "w", stdout) == nullptr) {
+    perror("stdout");
+    return 1;
+  }
+
+  Homie.setPublishHook([](const char*, const char*, bool) {});
+  setup();
+  loop();
+
+  FilePrint out(results);
+  runBenchmarks(out);
+  fclose(results);
+  return 0;
+}
+
+#endif
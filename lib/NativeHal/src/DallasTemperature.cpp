@@ -0,0 +1,320 @@
+/**
+ * Native stand-in for the DallasTemperature library.
+ */
+#include <DallasTemperature.h>
+#include <NativeHal.hpp>
+#include "OneWireBus.hpp"
+
+namespace {
+const uint8_t STARTCONVO      = 0x44;
+const uint8_t COPYSCRATCH     = 0x48;
+const uint8_t READSCRATCH     = 0xBE;
+const uint8_t WRITESCRATCH    = 0x4E;
+const uint8_t READPOWERSUPPLY = 0xB4;
+
+const uint8_t CONFIGURATION = 4;
+const uint8_t SCRATCHPAD_CRC = 8;
+
+const uint8_t TEMP_9_BIT  = 0x1F;
+const uint8_t TEMP_10_BIT = 0x3F;
+const uint8_t TEMP_11_BIT = 0x5F;
+const uint8_t TEMP_12_BIT = 0x7F;
+}  // namespace
+
+/**
+ * Finds the devices on the bus, their power mode and the highest resolution.
+ */
+void DallasTemperature::scan() {
+  DeviceAddress deviceAddress;
+
+  _scanPending   = false;
+  _devices       = 0;
+  _parasite      = false;
+  _bitResolution = 9;
+
+  _wire->reset_search();
+  while (_wire->search(deviceAddress)) {
+    if (validAddress(deviceAddress)) {
+      if (!_parasite && readPowerSupply(deviceAddress)) _parasite = true;
+      _bitResolution = max(_bitResolution, getResolution(deviceAddress));
+      _devices++;
+    }
+  }
+}
+
+void DallasTemperature::scanIfPending() {
+  if (_scanPending) scan();
+}
+
+uint8_t DallasTemperature::getDeviceCount() {
+  scanIfPending();
+  return _devices;
+}
+
+bool DallasTemperature::isParasitePowerMode() {
+  scanIfPending();
+  return _parasite;
+}
+
+/**
+ * Address of the device with the given index in search order.
+ */
+bool DallasTemperature::getAddress(uint8_t* deviceAddress, uint8_t index) {
+  uint8_t depth = 0;
+
+  _wire->reset_search();
+  while (depth <= index && _wire->search(deviceAddress)) {
+    if (depth == index && validAddress(deviceAddress)) return true;
+    depth++;
+  }
+  return false;
+}
+
+bool DallasTemperature::validAddress(const uint8_t* deviceAddress) {
+  return OneWire::crc8(deviceAddress, 7) == deviceAddress[7];
+}
+
+bool DallasTemperature::validFamily(const uint8_t* deviceAddress) {
+  switch (deviceAddress[0]) {
+    case 0x10:  // DS18S20
+    case 0x22:  // DS1822
+    case 0x28:  // DS18B20
+    case 0x3B:  // MAX31850
+    case 0x42:  // DS28EA00
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool DallasTemperature::isConnected(const uint8_t* deviceAddress) {
+  ScratchPad scratchPad;
+  return isConnected(deviceAddress, scratchPad);
+}
+
+/**
+ * Reads the scratchpad, false if the device doesn't answer or the CRC fails.
+ */
+bool DallasTemperature::isConnected(const uint8_t* deviceAddress, uint8_t* scratchPad) {
+  const bool b = readScratchPad(deviceAddress, scratchPad);
+
+  bool allZeros = true;
+  for (uint8_t i = 0; i < 9; i++) allZeros &= (scratchPad[i] == 0);
+
+  return b && !allZeros && OneWire::crc8(scratchPad, 8) == scratchPad[SCRATCHPAD_CRC];
+}
+
+bool DallasTemperature::readScratchPad(const uint8_t* deviceAddress, uint8_t* scratchPad) {
+  if (_wire->reset() == 0) {
+    memset(scratchPad, 0, sizeof(ScratchPad));
+    return false;
+  }
+
+  _wire->select(deviceAddress);
+  _wire->write(READSCRATCH);
+  for (uint8_t i = 0; i < 9; i++) scratchPad[i] = _wire->read();
+
+  return _wire->reset() == 1;
+}
+
+/**
+ * Writes TH, TL and the configuration and copies them to the EEPROM.
+ */
+void DallasTemperature::writeScratchPad(const uint8_t* deviceAddress, const uint8_t* scratchPad) {
+  _wire->reset();
+  _wire->select(deviceAddress);
+  _wire->write(WRITESCRATCH);
+  _wire->write(scratchPad[2]);
+  _wire->write(scratchPad[3]);
+  _wire->write(scratchPad[CONFIGURATION]);
+
+  _wire->reset();
+  _wire->select(deviceAddress);
+  _wire->write(COPYSCRATCH, _parasite);
+  delay(20);  // EEPROM write time, 10 ms by the datasheet
+  if (_parasite) delay(10);
+  _wire->reset();
+}
+
+/**
+ * @return true if the device, or any device without an address, is parasite powered
+ */
+bool DallasTemperature::readPowerSupply(const uint8_t* deviceAddress) {
+  bool parasite = false;
+
+  _wire->reset();
+  if (deviceAddress == nullptr) {
+    _wire->skip();
+  } else {
+    _wire->select(deviceAddress);
+  }
+  _wire->write(READPOWERSUPPLY);
+  if (_wire->read_bit() == 0) parasite = true;
+  _wire->reset();
+
+  return parasite;
+}
+
+uint8_t DallasTemperature::getResolution() {
+  scanIfPending();
+  return _bitResolution;
+}
+
+uint8_t DallasTemperature::getResolution(const uint8_t* deviceAddress) {
+  if (deviceAddress[0] == 0x10) return 12;  // DS18S20, fixed
+
+  ScratchPad scratchPad;
+  if (isConnected(deviceAddress, scratchPad)) {
+    switch (scratchPad[CONFIGURATION]) {
+      case TEMP_12_BIT: return 12;
+      case TEMP_11_BIT: return 11;
+      case TEMP_10_BIT: return 10;
+      case TEMP_9_BIT: return 9;
+    }
+  }
+  return 0;
+}
+
+void DallasTemperature::setResolution(uint8_t newResolution) {
+  DeviceAddress deviceAddress;
+
+  scanIfPending();
+  _bitResolution = constrain(newResolution, 9, 12);
+  for (uint8_t i = 0; i < _devices; i++) {
+    if (getAddress(deviceAddress, i)) setResolution(deviceAddress, _bitResolution, true);
+  }
+}
+
+bool DallasTemperature::setResolution(const uint8_t* deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation) {
+  ScratchPad scratchPad;
+
+  newResolution = constrain(newResolution, 9, 12);
+  if (!isConnected(deviceAddress, scratchPad)) return false;
+  if (deviceAddress[0] == 0x10) return true;
+
+  static const uint8_t configurations[4] = {TEMP_9_BIT, TEMP_10_BIT, TEMP_11_BIT, TEMP_12_BIT};
+  const uint8_t        configuration     = configurations[newResolution - 9];
+  if (scratchPad[CONFIGURATION] != configuration) {
+    scratchPad[CONFIGURATION] = configuration;
+    writeScratchPad(deviceAddress, scratchPad);
+  }
+
+  if (!skipGlobalBitResolutionCalculation) {
+    _bitResolution = newResolution;
+    DeviceAddress other;
+    for (uint8_t i = 0; i < _devices; i++) {
+      if (getAddress(other, i) && memcmp(other, deviceAddress, sizeof(DeviceAddress)) != 0) {
+        _bitResolution = max(_bitResolution, getResolution(other));
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * A read slot after Convert T: externally powered devices send 0 while converting.
+ */
+bool DallasTemperature::isConversionComplete() {
+  return _wire->read_bit() == 1;
+}
+
+int16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution) {
+  switch (bitResolution) {
+    case 9: return 94;
+    case 10: return 188;
+    case 11: return 375;
+    default: return 750;
+  }
+}
+
+/**
+ * Starts a conversion on all devices, blocks until it is done unless
+ * setWaitForConversion(false).
+ */
+void DallasTemperature::requestTemperatures() {
+  scanIfPending();
+
+  _wire->reset();
+  _wire->skip();
+  _wire->write(STARTCONVO, _parasite);
+
+  if (!_waitForConversion) return;
+  blockTillConversionComplete(_bitResolution);
+}
+
+bool DallasTemperature::requestTemperaturesByAddress(const uint8_t* deviceAddress) {
+  scanIfPending();
+
+  const uint8_t bitResolution = getResolution(deviceAddress);
+  if (bitResolution == 0) return false;
+
+  _wire->reset();
+  _wire->select(deviceAddress);
+  _wire->write(STARTCONVO, _parasite);
+
+  if (!_waitForConversion) return true;
+  blockTillConversionComplete(bitResolution);
+  return true;
+}
+
+bool DallasTemperature::requestTemperaturesByIndex(uint8_t index) {
+  DeviceAddress deviceAddress;
+  return getAddress(deviceAddress, index) && requestTemperaturesByAddress(deviceAddress);
+}
+
+/**
+ * Polls the bus if the devices can answer, else waits the datasheet time.
+ * The waiting time is accounted to the bus statistics.
+ */
+void DallasTemperature::blockTillConversionComplete(uint8_t bitResolution) {
+  const uint64_t start = hal::nowMicros();
+
+  if (_checkForConversion && !_parasite) {
+    const unsigned long begin = millis();
+    while (!isConversionComplete() && millis() - begin < (unsigned long)millisToWaitForConversion(bitResolution)) yield();
+  } else {
+    delay(millisToWaitForConversion(bitResolution));
+  }
+
+  hal::oneWireBus(_wire->getPin()).addWait(hal::nowMicros() - start);
+}
+
+/**
+ * @return temperature in 1/128 °C or DEVICE_DISCONNECTED_RAW
+ */
+int32_t DallasTemperature::getTemp(const uint8_t* deviceAddress) {
+  ScratchPad scratchPad;
+  if (!isConnected(deviceAddress, scratchPad)) return DEVICE_DISCONNECTED_RAW;
+
+  return (((int16_t)scratchPad[1]) << 11) | (((int16_t)scratchPad[0]) << 3);
+}
+
+float DallasTemperature::getTempC(const uint8_t* deviceAddress) {
+  return rawToCelsius(getTemp(deviceAddress));
+}
+
+float DallasTemperature::getTempF(const uint8_t* deviceAddress) {
+  return rawToFahrenheit(getTemp(deviceAddress));
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index) {
+  DeviceAddress deviceAddress;
+  if (!getAddress(deviceAddress, index)) return DEVICE_DISCONNECTED_C;
+  return getTempC(deviceAddress);
+}
+
+float DallasTemperature::getTempFByIndex(uint8_t index) {
+  DeviceAddress deviceAddress;
+  if (!getAddress(deviceAddress, index)) return DEVICE_DISCONNECTED_F;
+  return getTempF(deviceAddress);
+}
+
+float DallasTemperature::rawToCelsius(int32_t raw) {
+  if (raw <= DEVICE_DISCONNECTED_RAW) return DEVICE_DISCONNECTED_C;
+  return (float)raw * 0.0078125F;
+}
+
+float DallasTemperature::rawToFahrenheit(int32_t raw) {
+  if (raw <= DEVICE_DISCONNECTED_RAW) return DEVICE_DISCONNECTED_F;
+  return ((float)raw * 0.0140625F) + 32.0F;
+}
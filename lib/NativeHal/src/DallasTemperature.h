@@ -0,0 +1,74 @@
+/**
+ * Native stand-in for the DallasTemperature library.
+ *
+ * Same protocol and timing behaviour as the original on top of the OneWire
+ * stand-in: CRC checked scratchpad reads, blocking or polled conversions and
+ * parasite power detection. The bus scan of begin() is deferred to the first
+ * call that needs it, so devices attached by a host program before setup()
+ * are found although the nodes are constructed statically.
+ */
+#pragma once
+
+#include <OneWire.h>
+
+typedef uint8_t DeviceAddress[8];
+typedef uint8_t ScratchPad[9];
+
+#define DEVICE_DISCONNECTED_C -127
+#define DEVICE_DISCONNECTED_F -196.6
+#define DEVICE_DISCONNECTED_RAW -7040
+
+class DallasTemperature {
+public:
+  explicit DallasTemperature(OneWire* oneWire) : _wire(oneWire) {}
+
+  void    begin() { _scanPending = true; }
+  uint8_t getDeviceCount();
+  bool    isParasitePowerMode();
+
+  bool getAddress(uint8_t* deviceAddress, uint8_t index);
+  bool validAddress(const uint8_t* deviceAddress);
+  bool validFamily(const uint8_t* deviceAddress);
+  bool isConnected(const uint8_t* deviceAddress);
+  bool isConnected(const uint8_t* deviceAddress, uint8_t* scratchPad);
+  bool readScratchPad(const uint8_t* deviceAddress, uint8_t* scratchPad);
+  void writeScratchPad(const uint8_t* deviceAddress, const uint8_t* scratchPad);
+  bool readPowerSupply(const uint8_t* deviceAddress = nullptr);
+
+  uint8_t getResolution();
+  uint8_t getResolution(const uint8_t* deviceAddress);
+  void    setResolution(uint8_t newResolution);
+  bool    setResolution(const uint8_t* deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation = false);
+
+  void    setWaitForConversion(bool flag) { _waitForConversion = flag; }
+  bool    getWaitForConversion() { return _waitForConversion; }
+  void    setCheckForConversion(bool flag) { _checkForConversion = flag; }
+  bool    getCheckForConversion() { return _checkForConversion; }
+  bool    isConversionComplete();
+  int16_t millisToWaitForConversion(uint8_t bitResolution);
+
+  void    requestTemperatures();
+  bool    requestTemperaturesByAddress(const uint8_t* deviceAddress);
+  bool    requestTemperaturesByIndex(uint8_t index);
+  int32_t getTemp(const uint8_t* deviceAddress);
+  float   getTempC(const uint8_t* deviceAddress);
+  float   getTempF(const uint8_t* deviceAddress);
+  float   getTempCByIndex(uint8_t index);
+  float   getTempFByIndex(uint8_t index);
+
+  static float rawToCelsius(int32_t raw);
+  static float rawToFahrenheit(int32_t raw);
+
+private:
+  OneWire* _wire;
+  bool     _scanPending        = true;
+  bool     _waitForConversion  = true;
+  bool     _checkForConversion = true;
+  bool     _parasite           = false;
+  uint8_t  _bitResolution      = 9;
+  uint8_t  _devices            = 0;
+
+  void scan();
+  void scanIfPending();
+  void blockTillConversionComplete(uint8_t bitResolution);
+};
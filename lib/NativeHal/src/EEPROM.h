@@ -0,0 +1,41 @@
+/**
+ * Native stand-in for the ESP8266 EEPROM emulation, kept in memory.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+  void begin(size_t size) {
+    if (size > sizeof(_data)) size = sizeof(_data);
+    _size = size;
+  }
+  bool commit() {
+    _commits++;
+    return true;
+  }
+  void end() {}
+
+  template <typename T>
+  T& get(int address, T& t) {
+    memcpy(&t, _data + address, sizeof(T));
+    return t;
+  }
+  template <typename T>
+  const T& put(int address, const T& t) {
+    memcpy(_data + address, &t, sizeof(T));
+    return t;
+  }
+
+  uint8_t* getDataPtr() { return _data; }
+  size_t   length() const { return _size; }
+  uint32_t commitCount() const { return _commits; }
+
+private:
+  uint8_t  _data[4096] = {0};
+  size_t   _size       = 0;
+  uint32_t _commits    = 0;
+};
+
+extern EEPROMClass EEPROM;
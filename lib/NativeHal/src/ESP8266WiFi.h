@@ -0,0 +1,17 @@
+/**
+ * Native stand-in for the WiFi station, always connected.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "WiFiUdp.h"
+
+typedef enum { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+class ESP8266WiFiClass {
+public:
+  wl_status_t status();
+  int         hostByName(const char* hostName, IPAddress& result);
+};
+
+extern ESP8266WiFiClass WiFi;
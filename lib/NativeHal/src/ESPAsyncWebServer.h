@@ -0,0 +1,22 @@
+/**
+ * Native stand-in for ESPAsyncWebServer, there is no network to serve.
+ */
+#pragma once
+
+#include <LittleFS.h>
+
+class AsyncStaticWebHandler {
+public:
+  AsyncStaticWebHandler& setCacheControl(const char*) { return *this; }
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t) {}
+
+  void                   begin() {}
+  AsyncStaticWebHandler& serveStatic(const char*, fs::FS&, const char*, const char* = nullptr) { return _handler; }
+
+private:
+  AsyncStaticWebHandler _handler;
+};
@@ -0,0 +1,24 @@
+/**
+ * Native stand-in for the ESP8266 `ESP` object.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "WString.h"
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMaxFreeBlockSize();
+  uint8_t  getHeapFragmentation();
+  uint32_t getCycleCount();
+  uint32_t getChipId() { return 0x00C0FFEE; }
+  uint8_t  getCpuFreqMHz() { return 80; }
+  String   getResetReason();
+  void     restart();
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+};
+
+extern EspClass ESP;
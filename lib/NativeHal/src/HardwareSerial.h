@@ -0,0 +1,25 @@
+/**
+ * Native stand-in for the Arduino serial port. Output goes to stdout.
+ */
+#pragma once
+
+#include "Print.h"
+
+class HardwareSerial : public Print {
+public:
+  void   begin(unsigned long baud) { _baud = baud; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int    availableForWrite() override { return 128; }
+  void   flush() override;
+  int    available() { return 0; }
+  int    read() { return -1; }
+  explicit operator bool() const { return true; }
+
+  using Print::write;
+
+private:
+  unsigned long _baud = 0;
+};
+
+extern HardwareSerial Serial;
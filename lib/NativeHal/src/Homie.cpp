@@ -0,0 +1,150 @@
+/**
+ * Native implementation of the Homie stand-in.
+ */
+#include <Homie.hpp>
+
+HomieClass Homie;
+
+std::vector<HomieNode*>& HomieNode::nodes() {
+  static std::vector<HomieNode*> all;
+  return all;
+}
+
+std::vector<HomieInternals::IHomieSetting*>& HomieInternals::IHomieSetting::settings() {
+  static std::vector<IHomieSetting*> all;
+  return all;
+}
+
+HomieInternals::IHomieSetting* HomieInternals::IHomieSetting::find(const char* name) {
+  for (IHomieSetting* setting : settings()) {
+    if (strcmp(setting->getName(), name) == 0) return setting;
+  }
+  return nullptr;
+}
+
+size_t HomieInternals::Logger::write(uint8_t character) {
+  return (_loggingEnabled && _printer) ? _printer->write(character) : 0;
+}
+
+size_t HomieInternals::Logger::write(const uint8_t* buffer, size_t size) {
+  return (_loggingEnabled && _printer) ? _printer->write(buffer, size) : 0;
+}
+
+uint16_t HomieInternals::SendingPromise::send(const String& value) {
+  const uint16_t id = Homie.__publish(*_node, _property, value, _retained, _range);
+  _range            = {false, 0};
+  _retained         = true;
+  _qos              = 1;
+  return id;
+}
+
+HomieNode::HomieNode(const char* id, const char* name, const char* type, bool range, uint16_t lower, uint16_t upper,
+                     const HomieInternals::NodeInputHandler& nodeInputHandler)
+    : _id(id), _name(name), _type(type), _range(range), _lower(lower), _upper(upper), _inputHandler(nodeInputHandler) {
+  _sendingPromise._node = this;
+  nodes().push_back(this);
+}
+
+HomieNode::~HomieNode() {
+  for (HomieInternals::PropertyInterface* property : _properties) delete property;
+  nodes().erase(std::remove(nodes().begin(), nodes().end(), this), nodes().end());
+}
+
+HomieNode* HomieNode::find(const char* id) {
+  for (HomieNode* node : nodes()) {
+    if (strcmp(node->getId(), id) == 0) return node;
+  }
+  return nullptr;
+}
+
+HomieInternals::PropertyInterface& HomieNode::advertise(const char* id) {
+  HomieInternals::PropertyInterface* property = new HomieInternals::PropertyInterface();
+  property->id                                = id;
+  _properties.push_back(property);
+  return *property;
+}
+
+HomieInternals::SendingPromise& HomieNode::setProperty(const String& property) const {
+  _sendingPromise._property = property;
+  return _sendingPromise;
+}
+
+bool HomieNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+  return _inputHandler(range, property, value);
+}
+
+void HomieClass::__setFirmware(const char*, const char*) {}
+void HomieClass::__setBrand(const char*) {}
+
+HomieClass& HomieClass::setLoggingPrinter(Print* printer) {
+  _logger.setPrinter(printer);
+  return *this;
+}
+
+HomieClass& HomieClass::disableLogging() {
+  _logger.setLoggingEnabled(false);
+  return *this;
+}
+
+HomieClass& HomieClass::setSetupFunction(const OperationFunction& function) {
+  _setupFunction = function;
+  return *this;
+}
+
+HomieClass& HomieClass::setLoopFunction(const OperationFunction& function) {
+  _loopFunction = function;
+  return *this;
+}
+
+void HomieClass::setup() {
+  for (HomieNode* node : HomieNode::nodes()) node->setup();
+}
+
+void HomieClass::setConnected(bool connected) { _connected = connected; }
+
+HomieClass& HomieClass::setGlobalInputHandler(const GlobalInputHandler& handler) {
+  _globalInputHandler = handler;
+  return *this;
+}
+
+void HomieClass::loop() {
+  _published = 0;
+  if (!_connected) {
+    for (HomieNode* node : HomieNode::nodes()) {
+      if (node->runLoopDisconnected()) node->loop();
+    }
+    return;
+  }
+
+  if (!_setupDone) {
+    _setupDone = true;
+    if (_setupFunction) _setupFunction();
+  }
+  if (!_readyToOperate) {
+    _readyToOperate = true;
+    for (HomieNode* node : HomieNode::nodes()) node->onReadyToOperate();
+  }
+
+  if (_loopFunction) _loopFunction();
+  for (HomieNode* node : HomieNode::nodes()) node->loop();
+}
+
+bool HomieClass::injectInput(const char* nodeId, const char* property, const String& value, int rangeIndex) {
+  HomieNode* node = HomieNode::find(nodeId);
+  if (node == nullptr) return false;
+  HomieRange range = {rangeIndex >= 0, (uint16_t)(rangeIndex >= 0 ? rangeIndex : 0)};
+  if (_globalInputHandler && _globalInputHandler(*node, range, String(property), value)) return true;
+  return node->handleInput(range, String(property), value);
+}
+
+uint16_t HomieClass::__publish(const HomieNode& node, const String& property, const String& value, bool retained,
+                               const HomieRange& range) {
+  if (!_connected) return 0;
+  if (_publishLimit > 0 && _published >= _publishLimit) return 0;  // like a full buffer of the MQTT client
+  _published++;
+  String topic = String(node.getId()) + "/" + property;
+  if (range.isRange) topic = String(node.getId()) + "_" + String((unsigned int)range.index) + "/" + property;
+  if (_publishHook) _publishHook(topic.c_str(), value.c_str(), retained);
+  if (++_packetId == 0) _packetId = 1;
+  return _packetId;
+}
@@ -0,0 +1,6 @@
+/**
+ * Native stand-in for the Homie header.
+ */
+#pragma once
+
+#include "Homie.hpp"
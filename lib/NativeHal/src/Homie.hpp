@@ -0,0 +1,95 @@
+/**
+ * Native stand-in for the homie-esp8266 API.
+ *
+ * Mirrors the subset of the Homie interface that the pool controller uses.
+ * Publishes and logger output are routed through hooks so host tools can
+ * observe them; inbound messages are injected with `Homie.injectInput()`.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "HomieNode.hpp"
+#include "HomieSetting.hpp"
+#include "StreamingOperator.hpp"
+
+namespace HomieInternals {
+class Helpers {
+public:
+  static void byteArrayToHexString(const uint8_t* array, char* output, uint8_t length) {
+    for (uint8_t i = 0; i < length; i++) sprintf(&output[i * 2], "%02x", array[i]);
+  }
+  static void hexStringToByteArray(const char* hexStr, uint8_t* hexArray, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+      char hex[3] = {hexStr[i * 2], hexStr[i * 2 + 1], '\0'};
+      hexArray[i] = (uint8_t)strtol(hex, nullptr, 16);
+    }
+  }
+};
+
+class Logger : public Print {
+public:
+  void   setPrinter(Print* printer) { _printer = printer; }
+  void   setLoggingEnabled(bool enabled) { _loggingEnabled = enabled; }
+  size_t write(uint8_t character) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+
+  using Print::write;
+
+private:
+  Print* _printer        = &Serial;
+  bool   _loggingEnabled = true;
+};
+}  // namespace HomieInternals
+
+class HomieClass {
+public:
+  typedef std::function<void()>                                                         OperationFunction;
+  typedef std::function<void(const char* topic, const char* payload, bool retained)> PublishHook;
+  typedef std::function<bool(const HomieNode& node, const HomieRange& range, const String& property, const String& value)>
+      GlobalInputHandler;
+
+  void setup();
+  void loop();
+
+  void __setFirmware(const char* name, const char* version);
+  void __setBrand(const char* brand);
+
+  HomieClass& setLoggingPrinter(Print* printer);
+  HomieClass& disableLogging();
+  HomieClass& setSetupFunction(const OperationFunction& function);
+  HomieClass& setLoopFunction(const OperationFunction& function);
+  HomieClass& setGlobalInputHandler(const GlobalInputHandler& handler);
+  HomieClass& disableLedFeedback() { return *this; }
+
+  bool                     isConfigured() const { return true; }
+  bool                     isConnected() const { return _connected; }
+  HomieInternals::Logger& getLogger() { return _logger; }
+
+  // ---- native only ----
+  void setConnected(bool connected);
+  void setPublishHook(const PublishHook& hook) { _publishHook = hook; }
+  void setPublishLimit(uint16_t perLoop) { _publishLimit = perLoop; }  // publishes per loop() the client takes, 0: all
+  bool injectInput(const char* nodeId, const char* property, const String& value, int rangeIndex = -1);
+
+  uint16_t __publish(const HomieNode& node, const String& property, const String& value, bool retained, const HomieRange& range);
+
+private:
+  bool                   _connected      = true;
+  bool                   _setupDone      = false;
+  bool                   _readyToOperate = false;
+  uint16_t               _packetId       = 0;
+  uint16_t               _publishLimit   = 0;
+  uint16_t               _published      = 0;  // in this loop()
+  OperationFunction      _setupFunction;
+  OperationFunction      _loopFunction;
+  PublishHook            _publishHook;
+  GlobalInputHandler     _globalInputHandler;
+  HomieInternals::Logger _logger;
+};
+
+extern HomieClass Homie;
+
+#define Homie_setFirmware(name, version) Homie.__setFirmware(name, version)
+#define Homie_setBrand(brand) Homie.__setBrand(brand)
@@ -0,0 +1,140 @@
+/**
+ * Native stand-in for HomieNode and the property interface.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "HomieSetting.hpp"
+#include "StreamingOperator.hpp"
+
+struct HomieRange {
+  bool     isRange;
+  uint16_t index;
+};
+
+class HomieNode;
+class HomieClass;
+
+namespace HomieInternals {
+class PropertyInterface {
+public:
+  PropertyInterface& settable() {
+    _settable = true;
+    return *this;
+  }
+  PropertyInterface& setName(const char* name) {
+    _name = name;
+    return *this;
+  }
+  PropertyInterface& setUnit(const char* unit) {
+    _unit = unit;
+    return *this;
+  }
+  PropertyInterface& setDatatype(const char* datatype) {
+    _datatype = datatype;
+    return *this;
+  }
+  PropertyInterface& setFormat(const char* format) {
+    _format = format;
+    return *this;
+  }
+  PropertyInterface& setRetained(const bool retained = true) {
+    _retained = retained;
+    return *this;
+  }
+
+  String id;
+  String _name;
+  String _unit;
+  String _datatype;
+  String _format;
+  bool   _settable = false;
+  bool   _retained = true;
+};
+
+class SendingPromise {
+public:
+  SendingPromise& setQos(uint8_t qos) {
+    _qos = qos;
+    return *this;
+  }
+  SendingPromise& setRetained(bool retained) {
+    _retained = retained;
+    return *this;
+  }
+  SendingPromise& overwriteSetter(bool overwrite) {
+    _overwriteSetter = overwrite;
+    return *this;
+  }
+  SendingPromise& setRange(const HomieRange& range) {
+    _range = range;
+    return *this;
+  }
+  SendingPromise& setRange(uint16_t rangeIndex) {
+    _range = {true, rangeIndex};
+    return *this;
+  }
+  uint16_t send(const String& value);
+
+private:
+  friend class ::HomieNode;
+
+  const HomieNode* _node = nullptr;
+  String           _property;
+  uint8_t          _qos             = 1;
+  bool             _retained        = true;
+  bool             _overwriteSetter = false;
+  HomieRange       _range           = {false, 0};
+};
+
+typedef std::function<bool(const HomieRange& range, const String& property, const String& value)> NodeInputHandler;
+}  // namespace HomieInternals
+
+class HomieNode {
+  friend class HomieClass;
+
+public:
+  HomieNode(const char* id, const char* name, const char* type, bool range = false, uint16_t lower = 0, uint16_t upper = 0,
+            const HomieInternals::NodeInputHandler& nodeInputHandler = [](const HomieRange&, const String&, const String&) {
+              return false;
+            });
+  virtual ~HomieNode();
+
+  const char* getId() const { return _id; }
+  const char* getType() const { return _type; }
+  const char* getName() const { return _name; }
+  bool        isRange() const { return _range; }
+  uint16_t    getLower() const { return _lower; }
+  uint16_t    getUpper() const { return _upper; }
+
+  HomieInternals::PropertyInterface& advertise(const char* id);
+  HomieInternals::SendingPromise&    setProperty(const String& property) const;
+
+  void setRunLoopDisconnected(bool runLoopDisconnected) { _runLoopDisconnected = runLoopDisconnected; }
+  bool runLoopDisconnected() const { return _runLoopDisconnected; }
+
+  static std::vector<HomieNode*>& nodes();
+  static HomieNode*                     find(const char* id);
+  const std::vector<HomieInternals::PropertyInterface*>& properties() const { return _properties; }
+
+protected:
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void onReadyToOperate() {}
+  virtual bool handleInput(const HomieRange& range, const String& property, const String& value);
+
+private:
+  const char*                                     _id;
+  const char*                                     _name;
+  const char*                                     _type;
+  bool                                            _range;
+  uint16_t                                        _lower;
+  uint16_t                                        _upper;
+  bool                                            _runLoopDisconnected = false;
+  HomieInternals::NodeInputHandler                _inputHandler;
+  std::vector<HomieInternals::PropertyInterface*> _properties;
+  mutable HomieInternals::SendingPromise          _sendingPromise;
+
+};
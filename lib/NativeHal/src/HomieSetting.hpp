@@ -0,0 +1,80 @@
+/**
+ * Native stand-in for HomieSetting. Values come from the command line of
+ * the native build instead of config.json.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+namespace HomieInternals {
+class IHomieSetting {
+public:
+  IHomieSetting(const char* name, const char* description) : _name(name), _description(description) {}
+  virtual ~IHomieSetting() {}
+
+  const char* getName() const { return _name; }
+  const char* getDescription() const { return _description; }
+
+  /** Applies a value as if it came from config.json. */
+  virtual bool parse(const char* value) = 0;
+
+  static std::vector<IHomieSetting*>& settings();
+  static IHomieSetting*               find(const char* name);
+
+protected:
+  const char* _name;
+  const char* _description;
+};
+}  // namespace HomieInternals
+
+template <class T>
+class HomieSetting : public HomieInternals::IHomieSetting {
+public:
+  HomieSetting(const char* name, const char* description) : IHomieSetting(name, description), _value(), _provided(false) {
+    settings().push_back(this);
+  }
+
+  T    get() const { return _value; }
+  bool wasProvided() const { return _provided; }
+
+  HomieSetting<T>& setDefaultValue(T defaultValue) {
+    if (!_provided) _value = defaultValue;
+    return *this;
+  }
+  HomieSetting<T>& setValidator(const std::function<bool(T candidate)>& validator) {
+    _validator = validator;
+    return *this;
+  }
+
+  bool set(T value) {
+    if (_validator && !_validator(value)) return false;
+    _value    = value;
+    _provided = true;
+    return true;
+  }
+
+  bool parse(const char* value) override;
+
+private:
+  T                            _value;
+  bool                         _provided;
+  std::function<bool(T)>       _validator;
+};
+
+template <>
+inline bool HomieSetting<bool>::parse(const char* value) {
+  return set(strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+}
+template <>
+inline bool HomieSetting<long>::parse(const char* value) {
+  return set(strtol(value, nullptr, 10));
+}
+template <>
+inline bool HomieSetting<double>::parse(const char* value) {
+  return set(strtod(value, nullptr));
+}
+template <>
+inline bool HomieSetting<const char*>::parse(const char* value) {
+  return set(strdup(value));
+}
@@ -0,0 +1,63 @@
+/**
+ * Native stand-in for LittleFS on a host directory.
+ */
+#include <LittleFS.h>
+
+#include <sys/stat.h>
+
+fs::FS LittleFS;
+
+namespace fs {
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  return _file ? fwrite(buffer, 1, size, _file.get()) : 0;
+}
+
+int File::read() {
+  return _file ? fgetc(_file.get()) : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  return _file ? fread(buffer, 1, size, _file.get()) : 0;
+}
+
+bool File::seek(uint32_t position) {
+  return _file && fseek(_file.get(), position, SEEK_SET) == 0;
+}
+
+size_t File::size() const {
+  if (!_file) return 0;
+  struct stat info;
+  fflush(_file.get());
+  return fstat(fileno(_file.get()), &info) == 0 ? info.st_size : 0;
+}
+
+bool FS::begin() {
+  mkdir(hostPath("").c_str(), 0755);
+  return true;
+}
+
+bool FS::exists(const char* path) {
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char* path) {
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+File FS::open(const char* path, const char* mode) {
+  const std::string hostMode = std::string(mode) + "b";
+  return File(fopen(hostPath(path).c_str(), hostMode.c_str()));
+}
+
+std::string FS::hostPath(const char* path) {
+  const char* root = getenv("NATIVE_FS");
+  return std::string(root ? root : "littlefs") + path;
+}
+
+}  // namespace fs
@@ -0,0 +1,50 @@
+/**
+ * Native stand-in for LittleFS, the files live in the directory "littlefs"
+ * of the working directory or in $NATIVE_FS.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+namespace fs {
+
+class File {
+public:
+  File() {}
+  explicit File(FILE* file) : _file(file, fclose) {}
+
+  explicit operator bool() const { return _file != nullptr; }
+
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size);
+  int    read();
+  size_t read(uint8_t* buffer, size_t size);
+  bool   seek(uint32_t position);
+  size_t size() const;
+  void   close() { _file.reset(); }
+
+private:
+  std::shared_ptr<FILE> _file;
+};
+
+class FS {
+public:
+  bool begin();
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  /** mode "r", "w" or "a" */
+  File open(const char* path, const char* mode);
+
+private:
+  std::string hostPath(const char* path);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+extern fs::FS LittleFS;
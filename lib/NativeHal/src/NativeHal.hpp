@@ -0,0 +1,52 @@
+/**
+ * Control surface of the native hardware abstraction layer.
+ *
+ * The Arduino/Homie stand-ins of this library call into these hooks, so a
+ * host program can drive the virtual clock, observe pin writes and answer
+ * network requests without touching the sources under `src/`.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+namespace hal {
+
+/* ---- clock ---- */
+
+/** Switch between wall-clock time (default) and a manually advanced virtual clock. */
+void     setVirtualClock(bool enabled);
+bool     isVirtualClock();
+void     advanceMicros(uint64_t us);
+void     advanceMillis(uint64_t ms);
+uint64_t nowMicros();
+
+/* ---- gpio ---- */
+
+static const uint8_t NUM_PINS = 17;
+
+typedef std::function<void(uint8_t pin, uint8_t level)> PinWriteHook;
+
+uint8_t  pinMode(uint8_t pin);
+uint8_t  pinLevel(uint8_t pin);
+void     setInputLevel(uint8_t pin, uint8_t level);
+void     setPinWriteHook(const PinWriteHook& hook);
+uint32_t pinWriteCount(uint8_t pin);
+void     resetGpio();
+
+/** Applies a set/clear mask to the output latch in one step (GPOS/GPOC emulation). */
+void writeOutputMask(uint32_t setMask, uint32_t clearMask);
+
+/* ---- network ---- */
+
+/** Produces the reply to a UDP request; return false to drop the request. */
+typedef std::function<bool(uint16_t port, const std::vector<uint8_t>& request, std::vector<uint8_t>& reply)> UdpResponder;
+
+void setUdpResponder(const UdpResponder& responder);
+
+/** The NTP responder answers epoch + HAL clock instead of the host's wall clock, 0 switches back. */
+void setNtpEpoch(uint32_t epoch);
+bool ntpResponder(uint16_t port, const std::vector<uint8_t>& request, std::vector<uint8_t>& reply);
+
+}  // namespace hal
@@ -0,0 +1,92 @@
+/**
+ * Entry point of the native build: runs the sketch's setup() and loop().
+ *
+ *   program [--loops N] [--virtual-clock STEP_MS] [--set name=value]... [--ds18b20 PIN=CELSIUS]...
+ *           [--disconnect START:LOOPS]
+ *
+ * --loops stops after N passes of loop(), 0 (default) runs forever.
+ * --virtual-clock advances a virtual clock by STEP_MS per pass instead of
+ * using the wall clock, so hours of controller time run in seconds.
+ * --set provides a Homie setting as config.json would.
+ * --ds18b20 attaches a simulated sensor of constant temperature to the
+ * 1-Wire bus of a pin, see OneWireBus.hpp.
+ * --disconnect takes Homie offline for LOOPS passes from pass START on.
+ * Published messages are printed as "topic value" lines.
+ *
+ * Host programs with their own main() build with NATIVE_NO_MAIN.
+ */
+#ifndef NATIVE_NO_MAIN
+
+#include <Arduino.h>
+#include <Homie.hpp>
+#include <NativeHal.hpp>
+#include "OneWireBus.hpp"
+
+void setup();
+void loop();
+
+int main(int argc, char** argv) {
+  unsigned long loops  = 0;
+  unsigned long step   = 0;
+  uint64_t      serial = 1;
+
+  unsigned long disconnectStart = 0;
+  unsigned long disconnectLoops = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+      loops = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--virtual-clock") == 0 && i + 1 < argc) {
+      step = strtoul(argv[++i], nullptr, 10);
+      hal::setVirtualClock(true);
+    } else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+      char* name  = argv[++i];
+      char* value = strchr(name, '=');
+      if (value == nullptr) {
+        fprintf(stderr, "--set expects name=value: %s\n", name);
+        return 2;
+      }
+      *value++ = '\0';
+
+      HomieInternals::IHomieSetting* setting = HomieInternals::IHomieSetting::find(name);
+      if (setting == nullptr || !setting->parse(value)) {
+        fprintf(stderr, "invalid setting: %s=%s\n", name, value);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--ds18b20") == 0 && i + 1 < argc) {
+      char*         end;
+      const uint8_t pin = strtoul(argv[++i], &end, 10);
+      if (*end != '=' || pin >= hal::NUM_PINS) {
+        fprintf(stderr, "--ds18b20 expects PIN=CELSIUS: %s\n", argv[i]);
+        return 2;
+      }
+      hal::oneWireBus(pin).attach(new hal::Ds18b20(serial++, hal::waveform::constant(strtof(end + 1, nullptr))));
+    } else if (strcmp(argv[i], "--disconnect") == 0 && i + 1 < argc) {
+      char* end;
+      disconnectStart = strtoul(argv[++i], &end, 10);
+      if (*end != ':') {
+        fprintf(stderr, "--disconnect expects START:LOOPS: %s\n", argv[i]);
+        return 2;
+      }
+      disconnectLoops = strtoul(end + 1, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--loops N] [--virtual-clock STEP_MS] [--set name=value]... [--ds18b20 PIN=CELSIUS]... [--disconnect START:LOOPS]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  Homie.setPublishHook([](const char* topic, const char* value, bool retained) {
+    printf("%s %s%s\n", topic, value, retained ? " (retained)" : "");
+  });
+
+  setup();
+  for (unsigned long i = 0; loops == 0 || i < loops; i++) {
+    if (disconnectLoops > 0) Homie.setConnected(i < disconnectStart || i >= disconnectStart + disconnectLoops);
+    loop();
+    if (step > 0) hal::advanceMillis(step);
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Native stand-ins for WiFi, DNS, UDP and TimeLib. There is no network: a request
+ * sent over UDP is answered in process by the responder set in the HAL, by
+ * default an NTP server running on the host clock.
+ */
+#include <ESP8266WiFi.h>
+#include <lwip/dns.h>
+#include <TimeLib.h>
+#include <NativeHal.hpp>
+
+#include <chrono>
+#include <vector>
+
+ESP8266WiFiClass WiFi;
+
+wl_status_t ESP8266WiFiClass::status() { return WL_CONNECTED; }
+int         ESP8266WiFiClass::hostByName(const char*, IPAddress& result) {
+  result = IPAddress(0x7F000001);
+  return 1;
+}
+
+err_t dns_gethostbyname(const char*, ip_addr_t* addr, dns_found_callback, void*) {
+  addr->addr = 0x7F000001;
+  return ERR_OK;
+}
+
+namespace {
+uint16_t         udpPort = 0;
+std::vector<uint8_t> udpRequest;
+std::vector<uint8_t> udpReply;
+size_t           udpReplyPos = 0;
+hal::UdpResponder udpResponder = hal::ntpResponder;
+uint32_t         ntpEpoch     = 0;
+}  // namespace
+
+namespace hal {
+
+void setUdpResponder(const UdpResponder& responder) { udpResponder = responder; }
+void setNtpEpoch(uint32_t epoch) { ntpEpoch = epoch; }
+
+/**
+ * Answers NTP requests with the host's wall clock or the HAL clock from the set epoch.
+ */
+bool ntpResponder(uint16_t port, const std::vector<uint8_t>& request, std::vector<uint8_t>& reply) {
+  if (port != 123 || request.size() < 48) return false;
+  const uint64_t us = ntpEpoch ? ntpEpoch * 1000000ULL + nowMicros()
+                               : std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  const uint32_t seconds  = (uint32_t)(us / 1000000ULL + 2208988800ULL);
+  const uint32_t fraction = (uint32_t)(((us % 1000000ULL) << 32) / 1000000ULL);
+  reply.assign(48, 0);
+  reply[0] = 0x24;  // LI 0, version 4, mode server
+  reply[1] = 2;     // stratum
+  for (int i = 0; i < 4; i++) {
+    reply[40 + i] = (uint8_t)(seconds >> (24 - 8 * i));
+    reply[44 + i] = (uint8_t)(fraction >> (24 - 8 * i));
+  }
+  return true;
+}
+
+}  // namespace hal
+
+uint8_t WiFiUDP::begin(uint16_t) { return 1; }
+void    WiFiUDP::stop() {}
+int     WiFiUDP::beginPacket(const char*, uint16_t port) { return beginPacket(IPAddress(), port); }
+int     WiFiUDP::beginPacket(IPAddress, uint16_t port) {
+  udpPort = port;
+  udpRequest.clear();
+  return 1;
+}
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+  udpRequest.insert(udpRequest.end(), buffer, buffer + size);
+  return size;
+}
+int WiFiUDP::endPacket() {
+  std::vector<uint8_t> reply;
+  if (udpResponder && udpResponder(udpPort, udpRequest, reply)) {
+    udpReply    = reply;
+    udpReplyPos = 0;
+  }
+  return 1;
+}
+int WiFiUDP::parsePacket() {
+  if (udpReply.empty()) return 0;
+  if (udpReplyPos > 0) {
+    udpReply.clear();
+    return 0;
+  }
+  return (int)udpReply.size();
+}
+int WiFiUDP::read(uint8_t* buffer, size_t len) {
+  size_t n = std::min(len, udpReply.size() - udpReplyPos);
+  memcpy(buffer, udpReply.data() + udpReplyPos, n);
+  udpReplyPos += n;
+  return (int)n;
+}
+int WiFiUDP::available() { return (int)(udpReply.size() - udpReplyPos); }
+
+namespace {
+getExternalTime syncProvider = nullptr;
+time_t          baseTime     = 0;
+unsigned long   baseMillis   = 0;
+}  // namespace
+
+time_t now() {
+  if (syncProvider) {
+    time_t t = syncProvider();
+    if (t != 0) setTime(t);
+  }
+  return baseTime + (millis() - baseMillis) / 1000;
+}
+
+void setTime(time_t t) {
+  baseTime   = t;
+  baseMillis = millis();
+}
+
+void setSyncProvider(getExternalTime getTimeFunction) { syncProvider = getTimeFunction; }
+void setSyncInterval(time_t) {}
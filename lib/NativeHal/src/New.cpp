@@ -0,0 +1,38 @@
+/**
+ * With HEAP_TRACKING, new and delete go through malloc and free like on the
+ * device, so the malloc wrappers of HeapTracker see the allocations of
+ * String and new. The host's operator new calls malloc from inside the C++
+ * runtime, where the linker doesn't wrap it.
+ */
+#ifdef HEAP_TRACKING
+
+#include <cstdlib>
+#include <new>
+
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+#endif
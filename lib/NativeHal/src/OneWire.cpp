@@ -0,0 +1,168 @@
+/**
+ * Native stand-in for the OneWire library.
+ *
+ * The ROM search is the Maxim application note 187 algorithm of the
+ * original library, run against the simulated devices bit by bit.
+ */
+#include <OneWire.h>
+#include "OneWireBus.hpp"
+
+void OneWire::begin(uint8_t pin) {
+  _pin = pin;
+  reset_search();
+}
+
+uint8_t OneWire::reset() {
+  return hal::oneWireBus(_pin).reset();
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+  write(0x55);
+  for (uint8_t i = 0; i < 8; i++) write(rom[i]);
+}
+
+void OneWire::skip() {
+  write(0xCC);
+}
+
+/**
+ * LSB first. With power the bus stays driven high afterwards, for parasite
+ * powered devices, until the next operation or depower().
+ */
+void OneWire::write(uint8_t v, uint8_t power) {
+  for (uint8_t mask = 0x01; mask; mask <<= 1) write_bit((v & mask) ? 1 : 0);
+  if (!power) depower();
+}
+
+void OneWire::write_bytes(const uint8_t* buf, uint16_t count, bool power) {
+  for (uint16_t i = 0; i < count; i++) write(buf[i]);
+  if (!power) depower();
+}
+
+uint8_t OneWire::read() {
+  uint8_t value = 0;
+  for (uint8_t mask = 0x01; mask; mask <<= 1) {
+    if (read_bit()) value |= mask;
+  }
+  return value;
+}
+
+void OneWire::read_bytes(uint8_t* buf, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) buf[i] = read();
+}
+
+void OneWire::write_bit(uint8_t v) {
+  hal::oneWireBus(_pin).writeBit(v);
+}
+
+uint8_t OneWire::read_bit() {
+  return hal::oneWireBus(_pin).readBit();
+}
+
+void OneWire::depower() {
+  hal::oneWireBus(_pin).setPower(false);
+}
+
+void OneWire::reset_search() {
+  _lastDiscrepancy       = 0;
+  _lastFamilyDiscrepancy = 0;
+  _lastDevice            = false;
+  memset(_rom, 0, sizeof(_rom));
+}
+
+/**
+ * The next search() finds devices of the given family first.
+ */
+void OneWire::target_search(uint8_t family_code) {
+  memset(_rom, 0, sizeof(_rom));
+  _rom[0]                = family_code;
+  _lastDiscrepancy       = 64;
+  _lastFamilyDiscrepancy = 0;
+  _lastDevice            = false;
+}
+
+/**
+ * @return true with the next address in newAddr, false when all devices were found
+ */
+bool OneWire::search(uint8_t* newAddr, bool search_mode) {
+  uint8_t bitNumber  = 1;
+  uint8_t lastZero   = 0;
+  uint8_t byteNumber = 0;
+  uint8_t byteMask   = 1;
+  bool    found      = false;
+
+  if (!_lastDevice) {
+    if (!reset()) {
+      reset_search();
+      return false;
+    }
+
+    write(search_mode ? 0xF0 : 0xEC);
+
+    do {
+      const uint8_t bit        = read_bit();
+      const uint8_t complement = read_bit();
+      uint8_t       direction;
+
+      // no device left in the search
+      if (bit == 1 && complement == 1) break;
+
+      if (bit != complement) {
+        direction = bit;
+      } else {
+        // discrepancy: take the same path as last time before it, 1 at it, 0 after it
+        if (bitNumber < _lastDiscrepancy) {
+          direction = (_rom[byteNumber] & byteMask) ? 1 : 0;
+        } else {
+          direction = (bitNumber == _lastDiscrepancy) ? 1 : 0;
+        }
+        if (direction == 0) {
+          lastZero = bitNumber;
+          if (lastZero < 9) _lastFamilyDiscrepancy = lastZero;
+        }
+      }
+
+      if (direction) _rom[byteNumber] |= byteMask;
+      else _rom[byteNumber] &= ~byteMask;
+      write_bit(direction);
+
+      bitNumber++;
+      byteMask <<= 1;
+      if (byteMask == 0) {
+        byteNumber++;
+        byteMask = 1;
+      }
+    } while (byteNumber < 8);
+
+    if (bitNumber == 65) {
+      _lastDiscrepancy = lastZero;
+      if (_lastDiscrepancy == 0) _lastDevice = true;
+      found = true;
+    }
+  }
+
+  if (!found || _rom[0] == 0) {
+    reset_search();
+    return false;
+  }
+
+  memcpy(newAddr, _rom, sizeof(_rom));
+  return true;
+}
+
+/**
+ * Dallas/Maxim CRC8, polynomial x^8 + x^5 + x^4 + 1.
+ */
+uint8_t OneWire::crc8(const uint8_t* addr, uint8_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    uint8_t inbyte = *addr++;
+    for (uint8_t i = 8; i; i--) {
+      const uint8_t mix = (crc ^ inbyte) & 0x01;
+      crc >>= 1;
+      if (mix) crc ^= 0x8C;
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,41 @@
+/**
+ * Native stand-in for the OneWire library, driving the simulated bus of its
+ * pin, see OneWireBus.hpp.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class OneWire {
+public:
+  OneWire() {}
+  explicit OneWire(uint8_t pin) { begin(pin); }
+
+  void    begin(uint8_t pin);
+  uint8_t getPin() const { return _pin; }
+
+  uint8_t reset();
+  void    select(const uint8_t rom[8]);
+  void    skip();
+  void    write(uint8_t v, uint8_t power = 0);
+  void    write_bytes(const uint8_t* buf, uint16_t count, bool power = 0);
+  uint8_t read();
+  void    read_bytes(uint8_t* buf, uint16_t count);
+  void    write_bit(uint8_t v);
+  uint8_t read_bit();
+  void    depower();
+
+  void reset_search();
+  void target_search(uint8_t family_code);
+  bool search(uint8_t* newAddr, bool search_mode = true);
+
+  static uint8_t crc8(const uint8_t* addr, uint8_t len);
+
+private:
+  uint8_t _pin = 0;
+
+  uint8_t _rom[8];
+  uint8_t _lastDiscrepancy       = 0;
+  uint8_t _lastFamilyDiscrepancy = 0;
+  bool    _lastDevice            = false;
+};
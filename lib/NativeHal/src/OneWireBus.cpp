@@ -0,0 +1,408 @@
+/**
+ * Simulated 1-Wire bus with DS18B20 sensors.
+ */
+#include "OneWireBus.hpp"
+#include <Arduino.h>
+#include <NativeHal.hpp>
+#include <OneWire.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace hal {
+
+namespace {
+const uint8_t CMD_SEARCH_ROM    = 0xF0;
+const uint8_t CMD_ALARM_SEARCH  = 0xEC;
+const uint8_t CMD_READ_ROM      = 0x33;
+const uint8_t CMD_MATCH_ROM     = 0x55;
+const uint8_t CMD_SKIP_ROM      = 0xCC;
+const uint8_t CMD_CONVERT       = 0x44;
+const uint8_t CMD_READ_SCRATCH  = 0xBE;
+const uint8_t CMD_WRITE_SCRATCH = 0x4E;
+const uint8_t CMD_COPY_SCRATCH  = 0x48;
+const uint8_t CMD_RECALL        = 0xB8;
+const uint8_t CMD_READ_POWER    = 0xB4;
+
+const int16_t POWER_ON_RAW = 0x0550;  // 85 °C
+
+uint8_t bitOf(const uint8_t* bytes, uint8_t index) { return (bytes[index / 8] >> (index % 8)) & 1; }
+}  // namespace
+
+/* ---- waveforms ---- */
+
+namespace waveform {
+
+Waveform constant(float celsius) {
+  return [celsius](double) { return celsius; };
+}
+
+Waveform sine(float mean, float amplitude, double period) {
+  return [mean, amplitude, period](double seconds) { return mean + amplitude * (float)std::sin(2 * M_PI * seconds / period); };
+}
+
+Waveform ramp(float start, float perHour) {
+  return [start, perHour](double seconds) { return start + perHour * (float)(seconds / 3600); };
+}
+
+Waveform step(float before, float after, double at) {
+  return [before, after, at](double seconds) { return seconds < at ? before : after; };
+}
+
+}  // namespace waveform
+
+/* ---- device ---- */
+
+Ds18b20::Ds18b20(uint64_t serial, const Waveform& temperature) : _temperature(temperature) {
+  _address[0] = FAMILY;
+  for (uint8_t i = 1; i < 7; i++) {
+    _address[i] = (uint8_t)serial;
+    serial >>= 8;
+  }
+  _address[7] = OneWire::crc8(_address, 7);
+  _random     = OneWire::crc8(_address, 8) + 1;
+  powerOn();
+}
+
+Ds18b20::Ds18b20(const char* address, const Waveform& temperature) : _temperature(temperature) {
+  for (uint8_t i = 0; i < 8; i++) {
+    unsigned value = 0;
+    sscanf(address + 2 * i, "%2x", &value);
+    _address[i] = (uint8_t)value;
+  }
+  _random = OneWire::crc8(_address, 8) + 1;
+  powerOn();
+}
+
+uint8_t Ds18b20::getResolution() const {
+  return 9 + ((_scratchpad[4] >> 5) & 3);
+}
+
+uint32_t Ds18b20::conversionMicros(uint8_t resolution) {
+  return 750000UL >> (12 - constrain(resolution, 9, 12));
+}
+
+/**
+ * State after power up or a brown out: 85 °C and the EEPROM settings.
+ */
+void Ds18b20::powerOn() {
+  _scratchpad[0] = POWER_ON_RAW & 0xFF;
+  _scratchpad[1] = POWER_ON_RAW >> 8;
+  memcpy(&_scratchpad[2], _eeprom, sizeof(_eeprom));
+  _scratchpad[5] = 0xFF;
+  _scratchpad[6] = 0x0C;
+  _scratchpad[7] = 0x10;
+  seal();
+
+  _state      = IDLE;
+  _converting = false;
+}
+
+/**
+ * @return true if the device answers the reset with a presence pulse
+ */
+bool Ds18b20::reset(uint64_t now) {
+  busActivity(now);
+
+  _present = _connected;
+  if (_present && chance(_dropoutRate)) {
+    _present = false;
+    _dropouts++;
+  }
+
+  _state = _present ? ROM_COMMAND : DESELECTED;
+  _bit   = 0;
+  _phase = 0;
+  memset(_shift, 0, sizeof(_shift));
+  return _present;
+}
+
+/**
+ * The bus is driven low for a slot or the strong pull-up ends: a parasite
+ * powered conversion still running loses its supply.
+ */
+void Ds18b20::busActivity(uint64_t now) {
+  if (!_converting) return;
+
+  if (now >= _convertEnd) {
+    finishConversion();
+  } else if (_parasite) {
+    _brownouts++;
+    powerOn();
+  }
+}
+
+/**
+ *
+ */
+void Ds18b20::startConversion(uint64_t now) {
+  _converting = true;
+  _convertEnd = now + (uint64_t)(conversionMicros(getResolution()) * _conversionFactor);
+  _conversions++;
+}
+
+/**
+ * Stores the temperature at the end of the conversion, the undefined low bits
+ * of a lower resolution are cleared.
+ */
+void Ds18b20::finishConversion() {
+  const float celsius = _temperature(_convertEnd / 1e6);
+  long        raw     = lroundf(constrain(celsius, -55.0F, 125.0F) * 16);
+  raw &= ~((1L << (12 - getResolution())) - 1);
+
+  _scratchpad[0] = raw & 0xFF;
+  _scratchpad[1] = (raw >> 8) & 0xFF;
+  seal();
+  _converting = false;
+}
+
+/**
+ *
+ */
+uint8_t Ds18b20::readSlot(uint64_t now) {
+  busActivity(now);
+
+  uint8_t bit = 1;
+  switch (_state) {
+    case READ_ROM:
+      bit = bitOf(_address, _bit++);
+      if (_bit == 64) _state = FUNCTION;
+      break;
+
+    case SEARCH_ROM:
+      if (_phase < 2) {
+        bit = bitOf(_address, _bit) ^ _phase;
+        _phase++;
+      }
+      break;
+
+    case READ_SCRATCHPAD:
+      if (_bit < 72) bit = shiftBit(_bit++);
+      break;
+
+    case READ_POWER:
+      bit = _parasite ? 0 : 1;
+      break;
+
+    case CONVERTING:
+      bit = (_converting && !_parasite) ? 0 : 1;
+      break;
+
+    default:
+      break;
+  }
+  return bit;
+}
+
+/**
+ *
+ */
+void Ds18b20::writeSlot(uint8_t bit, uint64_t now) {
+  busActivity(now);
+
+  switch (_state) {
+    case ROM_COMMAND:
+    case FUNCTION:
+      if (bit) _command |= 1 << _bit;
+      else _command &= ~(1 << _bit);
+      if (++_bit < 8) break;
+
+      _bit = 0;
+      if (_state == FUNCTION) {
+        command(_command, now);
+      } else if (_command == CMD_MATCH_ROM) {
+        _state = MATCH_ROM;
+      } else if (_command == CMD_SKIP_ROM) {
+        _state = FUNCTION;
+      } else if (_command == CMD_READ_ROM) {
+        _state = READ_ROM;
+      } else if (_command == CMD_SEARCH_ROM || (_command == CMD_ALARM_SEARCH && isAlarm())) {
+        _state = SEARCH_ROM;
+        _phase = 0;
+      } else {
+        _state = DESELECTED;
+      }
+      break;
+
+    case MATCH_ROM:
+      if (bit != bitOf(_address, _bit++)) {
+        _state = DESELECTED;
+      } else if (_bit == 64) {
+        _state = FUNCTION;
+        _bit   = 0;
+      }
+      break;
+
+    case SEARCH_ROM:
+      if (_phase != 2) break;
+      if (bit != bitOf(_address, _bit++)) {
+        _state = DESELECTED;
+      } else if (_bit == 64) {
+        _state = FUNCTION;
+        _bit   = 0;
+      }
+      _phase = 0;
+      break;
+
+    case WRITE_SCRATCHPAD:
+      if (_bit >= 24) break;
+      if (bit) _shift[_bit / 8] |= 1 << (_bit % 8);
+      if (++_bit % 8 == 0) {
+        // TH, TL and configuration, whose fixed bits read back as ones
+        const uint8_t index = 2 + (_bit / 8) - 1;
+        _scratchpad[index]  = (index == 4) ? ((_shift[2] & 0x60) | 0x1F) : _shift[index - 2];
+        seal();
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * Executes a function command.
+ */
+void Ds18b20::command(uint8_t command, uint64_t now) {
+  memset(_shift, 0, sizeof(_shift));
+  _bit = 0;
+
+  switch (command) {
+    case CMD_CONVERT:
+      startConversion(now);
+      _state = CONVERTING;
+      break;
+
+    case CMD_READ_SCRATCH:
+      memcpy(_shift, _scratchpad, sizeof(_scratchpad));
+      if (chance(_crcErrorRate)) {
+        const uint8_t bit = _random % 72;
+        _shift[bit / 8] ^= 1 << (bit % 8);
+        _crcErrors++;
+      }
+      _state = READ_SCRATCHPAD;
+      break;
+
+    case CMD_WRITE_SCRATCH:
+      _state = WRITE_SCRATCHPAD;
+      break;
+
+    case CMD_COPY_SCRATCH:
+      memcpy(_eeprom, &_scratchpad[2], sizeof(_eeprom));
+      _state = IDLE;
+      break;
+
+    case CMD_RECALL:
+      memcpy(&_scratchpad[2], _eeprom, sizeof(_eeprom));
+      seal();
+      _state = IDLE;
+      break;
+
+    case CMD_READ_POWER:
+      _state = READ_POWER;
+      break;
+
+    default:
+      _state = IDLE;
+      break;
+  }
+}
+
+/**
+ *
+ */
+void Ds18b20::seal() {
+  _scratchpad[8] = OneWire::crc8(_scratchpad, 8);
+}
+
+/**
+ * xorshift32, reproducible per device.
+ */
+bool Ds18b20::chance(float rate) {
+  if (rate <= 0.0F) return false;
+
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  return _random < rate * 4294967295.0F;
+}
+
+/**
+ * Alarm condition of the alarm search: T <= TL or T >= TH, whole degrees.
+ */
+bool Ds18b20::isAlarm() const {
+  const int8_t celsius = (int8_t)((int16_t)(_scratchpad[1] << 8 | _scratchpad[0]) >> 4);
+  return celsius <= (int8_t)_scratchpad[3] || celsius >= (int8_t)_scratchpad[2];
+}
+
+/* ---- bus ---- */
+
+void OneWireBus::attach(Ds18b20* device) {
+  if (std::find(_devices.begin(), _devices.end(), device) == _devices.end()) _devices.push_back(device);
+}
+
+void OneWireBus::detach(Ds18b20* device) {
+  _devices.erase(std::remove(_devices.begin(), _devices.end(), device), _devices.end());
+}
+
+void OneWireBus::clear() {
+  _devices.clear();
+  resetStats();
+}
+
+/**
+ * Takes the time of a slot on the HAL clock.
+ * @return time at the start of the slot
+ */
+uint64_t OneWireBus::slot(uint16_t us) {
+  const uint64_t now = nowMicros();
+  advanceMicros(us);
+  _stats.busMicros += us;
+  return now;
+}
+
+uint8_t OneWireBus::reset() {
+  const uint64_t now     = slot(RESET_MICROS);
+  bool           present = false;
+  for (Ds18b20* device : _devices) present |= device->reset(now);
+
+  _stats.resets++;
+  if (!present) _stats.noPresence++;
+  return present ? 1 : 0;
+}
+
+void OneWireBus::writeBit(uint8_t bit) {
+  const uint64_t now = slot(SLOT_MICROS);
+  for (Ds18b20* device : _devices) device->writeSlot(bit & 1, now);
+  _stats.slots++;
+}
+
+/**
+ * Open drain: any device sending a 0 pulls the bus low.
+ */
+uint8_t OneWireBus::readBit() {
+  const uint64_t now = slot(SLOT_MICROS);
+  uint8_t        bit = 1;
+  for (Ds18b20* device : _devices) bit &= device->readSlot(now);
+  _stats.slots++;
+  return bit;
+}
+
+void OneWireBus::setPower(bool power) {
+  if (power) return;
+
+  const uint64_t now = nowMicros();
+  for (Ds18b20* device : _devices) device->busActivity(now);
+}
+
+void OneWireBus::addWait(uint64_t us) {
+  _stats.waitMicros += us;
+  if (us > _stats.maxWaitMicros) _stats.maxWaitMicros = us;
+}
+
+OneWireBus& oneWireBus(uint8_t pin) {
+  static OneWireBus buses[NUM_PINS];
+  return buses[pin < NUM_PINS ? pin : 0];
+}
+
+}  // namespace hal
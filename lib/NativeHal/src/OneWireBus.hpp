@@ -0,0 +1,156 @@
+/**
+ * Simulated 1-Wire bus with DS18B20 sensors.
+ *
+ * The OneWire stand-in drives the bus one time slot at a time, the devices
+ * answer bit by bit like the real ones: ROM search with wired-AND
+ * collisions, MATCH/SKIP/READ ROM, Convert T, scratchpad read/write/copy and
+ * Read Power Supply. Every slot takes its datasheet time on the HAL clock,
+ * conversions take 94/188/375/750 ms by resolution.
+ *
+ * Faults: a device can drop out of single transactions or off the bus, its
+ * scratchpad can arrive with a flipped bit, and a parasite powered device
+ * browns out when the strong pull-up is missing or released before the
+ * conversion is done, leaving its power-on 85 °C in the scratchpad.
+ *
+ *   hal::Ds18b20 suction(0x01, hal::waveform::sine(26.0, 1.5, 86400));
+ *   suction.setCrcErrorRate(0.01);
+ *   hal::oneWireBus(PIN_DS_POOL).attach(&suction);
+ */
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+namespace hal {
+
+/** Temperature in °C at the given number of seconds since boot. */
+typedef std::function<float(double seconds)> Waveform;
+
+namespace waveform {
+Waveform constant(float celsius);
+Waveform sine(float mean, float amplitude, double period);
+Waveform ramp(float start, float perHour);
+Waveform step(float before, float after, double at);
+}  // namespace waveform
+
+class Ds18b20 {
+  friend class OneWireBus;
+
+public:
+  static const uint8_t FAMILY = 0x28;
+
+  /** Address of family 0x28 with the given 48 bit serial number and a valid CRC. */
+  explicit Ds18b20(uint64_t serial, const Waveform& temperature = waveform::constant(25.0F));
+  /** Address as hex string like "28f957453c19013a", taken as is, CRC included. */
+  explicit Ds18b20(const char* address, const Waveform& temperature = waveform::constant(25.0F));
+
+  const uint8_t* getAddress() const { return _address; }
+
+  void setTemperature(const Waveform& temperature) { _temperature = temperature; }
+  void setParasite(bool parasite) { _parasite = parasite; }
+  void setConnected(bool connected) { _connected = connected; }
+  /** Probability that the device misses a transaction, 0..1. */
+  void setDropoutRate(float rate) { _dropoutRate = rate; }
+  /** Probability that a scratchpad read carries a flipped bit, 0..1. */
+  void setCrcErrorRate(float rate) { _crcErrorRate = rate; }
+  /** Conversion time as a fraction of the datasheet maximum, > 1 for a slow device. */
+  void setConversionFactor(float factor) { _conversionFactor = factor; }
+  void setSeed(uint32_t seed) { _random = seed ? seed : 1; }
+
+  uint8_t  getResolution() const;
+  uint32_t getConversions() const { return _conversions; }
+  uint32_t getBrownouts() const { return _brownouts; }
+  uint32_t getDropouts() const { return _dropouts; }
+  uint32_t getCrcErrors() const { return _crcErrors; }
+
+  static uint32_t conversionMicros(uint8_t resolution);
+
+private:
+  enum State { IDLE, ROM_COMMAND, MATCH_ROM, READ_ROM, SEARCH_ROM, FUNCTION, READ_SCRATCHPAD, WRITE_SCRATCHPAD, READ_POWER, CONVERTING, DESELECTED };
+
+  uint8_t  _address[8];
+  Waveform _temperature;
+  bool     _parasite         = false;
+  bool     _connected        = true;
+  float    _dropoutRate      = 0.0F;
+  float    _crcErrorRate     = 0.0F;
+  float    _conversionFactor = 1.0F;
+  uint32_t _random;
+
+  uint8_t _scratchpad[9];
+  uint8_t _eeprom[3] = {0x4B, 0x46, 0x7F};  // TH, TL, configuration
+
+  // protocol state of the current transaction
+  State   _state   = IDLE;
+  bool    _present = false;
+  uint8_t _shift[9];
+  uint8_t _bit     = 0;
+  uint8_t _phase   = 0;  // of a search step: bit, complement, direction
+  uint8_t _command = 0;
+
+  // conversion in progress
+  bool     _converting = false;
+  uint64_t _convertEnd = 0;
+
+  uint32_t _conversions = 0;
+  uint32_t _brownouts   = 0;
+  uint32_t _dropouts    = 0;
+  uint32_t _crcErrors   = 0;
+
+  void    powerOn();
+  bool    reset(uint64_t now);
+  uint8_t readSlot(uint64_t now);
+  void    writeSlot(uint8_t bit, uint64_t now);
+  void    busActivity(uint64_t now);
+  void    finishConversion();
+  void    startConversion(uint64_t now);
+  void    command(uint8_t command, uint64_t now);
+  void    seal();
+  bool    chance(float rate);
+  bool    isAlarm() const;
+  uint8_t shiftBit(uint8_t index) const { return (_shift[index / 8] >> (index % 8)) & 1; }
+};
+
+class OneWireBus {
+
+public:
+  static const uint16_t RESET_MICROS = 960;  // reset pulse and presence detect
+  static const uint16_t SLOT_MICROS  = 65;   // one read or write time slot
+
+  struct Stats {
+    uint32_t resets;
+    uint32_t noPresence;   // resets without a device answering
+    uint32_t slots;
+    uint64_t busMicros;    // time spent in resets and slots
+    uint64_t waitMicros;   // time spent waiting for conversions
+    uint64_t maxWaitMicros;
+  };
+
+  void attach(Ds18b20* device);
+  void detach(Ds18b20* device);
+  void clear();
+
+  const std::vector<Ds18b20*>& getDevices() const { return _devices; }
+  const Stats&                 getStats() const { return _stats; }
+  void                         resetStats() { _stats = Stats(); }
+
+  // primitives of the OneWire stand-in
+  uint8_t reset();
+  void    writeBit(uint8_t bit);
+  uint8_t readBit();
+  /** false releases the strong pull-up, parasite powered conversions still running fail. */
+  void    setPower(bool power);
+  void    addWait(uint64_t us);
+
+private:
+  std::vector<Ds18b20*> _devices;
+  Stats                 _stats = Stats();
+
+  uint64_t slot(uint16_t us);
+};
+
+/** Bus of the given pin. */
+OneWireBus& oneWireBus(uint8_t pin);
+
+}  // namespace hal
@@ -0,0 +1,209 @@
+/**
+ * Entry point of the native plant build: runs RuleAuto and RuleBoost with
+ * their relay nodes against the thermal model of ThermalPlant.hpp, on the
+ * virtual clock, and reports per scenario.
+ *
+ *   program [--scenario NAME] [--days N] [--pool-max F] [--solar-min F] [--hysteresis K]
+ *           [--interval S] [--weather FILE.csv]
+ *
+ * Without --scenario all built-in scenarios run. Temperatures are in °F like
+ * the sensor readings and settings of the controller. One JSON object per
+ * scenario and line:
+ *
+ *   {"scenario":"sunny","mode":"auto","days":30,"poolPumpHours":210.0,"solarPumpHours":1.3,
+ *    "poolPumpCycles":30,"solarPumpCycles":121,"solarKWh":38.7,"poolEndF":86.0,"poolMaxF":87.1,
+ *    "trackingErrorF":9.3,"overshootF":11.6,"wallMs":57}
+ *
+ * trackingErrorF is the RMS of the distance of the pool to the max. pool
+ * temperature while the pool pump may run, overshootF the highest excess above it.
+ *
+ * The rules don't switch the heater, so it is never driven: the plant steps
+ * with the heater off and its parameters have no effect.
+ */
+#ifdef NATIVE_PLANT
+
+#include <Arduino.h>
+#include <NativeHal.hpp>
+#include <chrono>
+#include <cmath>
+#include "ThermalPlant.hpp"
+#include "RelayModuleNode.hpp"
+#include "RuleAuto.hpp"
+#include "RuleBoost.hpp"
+#include "TimeClientHelper.hpp"
+
+namespace {
+
+const uint32_t START_EPOCH = 1751328000;  // 2025-07-01 00:00 UTC, the time zone stays UTC
+const uint16_t STEP        = 5;           // in s, plant integration
+
+RelayModuleNode poolPumpNode("pool-pump", "Pool Pump", 12);
+RelayModuleNode solarPumpNode("solar-pump", "Solar Pump", 14);
+
+RuleAuto  autoRule(&solarPumpNode, &poolPumpNode);
+RuleBoost boostRule(&solarPumpNode, &poolPumpNode);
+
+struct Scenario {
+  const char*        name;
+  const char*        mode;
+  unsigned           days;
+  float              poolStart;  // °C
+  hal::WeatherSource weather;
+};
+
+struct Settings {
+  float         poolMax    = 75.5F;  // defaults of the controller
+  float         solarMin   = 100.0F;
+  float         hysteresis = 1.0F;
+  unsigned long interval   = 30;     // loop-interval
+  unsigned      days       = 0;      // 0: the scenario's own
+};
+
+float toFahrenheit(float celsius) {
+  // DS18B20 resolution of 1/16 °C first
+  return roundf(celsius * 16) / 16 * 1.8F + 32;
+}
+
+/**
+ * Continues the virtual clock to the next midnight, so the scenarios share
+ * one timeline and the NTP clock stays in sync.
+ */
+void startOfNextDay() {
+  const uint64_t day = 86400ULL * 1000000ULL;
+  hal::advanceMicros(day - hal::nowMicros() % day);
+}
+
+void run(const Scenario& scenario, const Settings& settings) {
+  const auto wallStart = std::chrono::steady_clock::now();
+
+  Rule* rule = (strcmp(scenario.mode, "boost") == 0) ? static_cast<Rule*>(&boostRule) : static_cast<Rule*>(&autoRule);
+  rule->setPoolMaxTemperatur(settings.poolMax);
+  rule->setSolarMinTemperature(settings.solarMin);
+  rule->setTemperaturHysteresis(settings.hysteresis);
+  rule->setTimerSetting({10, 30, 17, 30});
+
+  hal::ThermalPlant plant;
+  plant.reset(scenario.poolStart);
+
+  // boost leaves the pool pump to the user, who switched it on
+  solarPumpNode.setSwitch(false);
+  poolPumpNode.setSwitch(rule == &boostRule);
+
+  const unsigned days     = settings.days ? settings.days : scenario.days;
+  const uint64_t duration = days * 86400ULL;
+  startOfNextDay();
+
+  bool     poolOn = poolPumpNode.getSwitch(), solarOn = solarPumpNode.getSwitch();
+  uint32_t poolSteps = 0, solarSteps = 0, poolCycles = 0, solarCycles = 0;
+  double   squaredError = 0, overshoot = 0, maxPool = -1000;
+  uint32_t errorSteps   = 0;
+
+  for (uint64_t t = 0; t < duration; t += STEP) {
+    timeClientLoop();
+
+    const hal::Weather weather = scenario.weather(t);
+    if (t % settings.interval == 0 && isTimeValid()) {
+      rule->setPoolTemperatur(toFahrenheit(plant.getPoolTemperature()));
+      rule->setSolarTemperatur(toFahrenheit(plant.getCollectorTemperature()));
+      rule->loop();
+    }
+
+    const bool pool  = poolPumpNode.getSwitch();
+    const bool solar = solarPumpNode.getSwitch();
+    if (pool && !poolOn) poolCycles++;
+    if (solar && !solarOn) solarCycles++;
+    poolOn  = pool;
+    solarOn = solar;
+    poolSteps += pool;
+    solarSteps += solar;
+
+    plant.step(STEP, weather, pool, solar, false);
+
+    const double poolF = plant.getPoolTemperature() * 1.8 + 32;
+    maxPool            = std::max(maxPool, poolF);
+    overshoot          = std::max(overshoot, poolF - settings.poolMax);
+    if (pool) {
+      squaredError += (poolF - settings.poolMax) * (poolF - settings.poolMax);
+      errorSteps++;
+    }
+
+    hal::advanceMillis(STEP * 1000UL);
+  }
+
+  const long wallMs = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wallStart).count();
+  printf("{\"scenario\":\"%s\",\"mode\":\"%s\",\"days\":%u,\"poolPumpHours\":%.1f,\"solarPumpHours\":%.1f,"
+         "\"poolPumpCycles\":%u,\"solarPumpCycles\":%u,\"solarKWh\":%.1f,\"poolEndF\":%.1f,\"poolMaxF\":%.1f,"
+         "\"trackingErrorF\":%.1f,\"overshootF\":%.1f,\"wallMs\":%ld}\n",
+         scenario.name, scenario.mode, days, poolSteps * STEP / 3600.0, solarSteps * STEP / 3600.0, poolCycles, solarCycles,
+         plant.getSolarEnergy(), plant.getPoolTemperature() * 1.8 + 32, maxPool,
+         errorSteps ? std::sqrt(squaredError / errorSteps) : 0.0, std::max(overshoot, 0.0), wallMs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<Scenario> scenarios = {
+      {"sunny", "auto", 30, 22.0F, hal::weather::synthetic(24.0F, 6.0F, 850.0F, 6.0F, 20.5F)},
+      {"cloudy", "auto", 30, 22.0F, hal::weather::synthetic(19.0F, 4.0F, 700.0F, 6.5F, 20.0F, 0.7F, 7)},
+      {"heatwave", "auto", 14, 26.0F, hal::weather::synthetic(31.0F, 7.0F, 950.0F, 5.5F, 21.0F)},
+      {"sunny", "boost", 30, 22.0F, hal::weather::synthetic(24.0F, 6.0F, 850.0F, 6.0F, 20.5F)},
+      {"spring", "boost", 30, 15.0F, hal::weather::synthetic(14.0F, 6.0F, 650.0F, 7.0F, 19.0F, 0.4F, 3)},
+  };
+
+  Settings    settings;
+  const char* only    = nullptr;
+  const char* weather = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--scenario") == 0 && hasValue) {
+      only = argv[++i];
+    } else if (strcmp(argv[i], "--days") == 0 && hasValue) {
+      settings.days = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--pool-max") == 0 && hasValue) {
+      settings.poolMax = strtof(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--solar-min") == 0 && hasValue) {
+      settings.solarMin = strtof(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--hysteresis") == 0 && hasValue) {
+      settings.hysteresis = strtof(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--interval") == 0 && hasValue) {
+      settings.interval = max(1UL, strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--weather") == 0 && hasValue) {
+      weather = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--scenario NAME] [--days N] [--pool-max F] [--solar-min F] [--hysteresis K] [--interval S] "
+              "[--weather FILE.csv]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  if (weather != nullptr) {
+    hal::WeatherSource source = hal::weather::recorded(weather);
+    if (!source) {
+      fprintf(stderr, "can't read weather: %s\n", weather);
+      return 2;
+    }
+    scenarios = {{"recorded", "auto", 30, 22.0F, source}, {"recorded", "boost", 30, 22.0F, source}};
+  }
+
+  hal::setVirtualClock(true);
+  hal::setNtpEpoch(START_EPOCH);
+  RelayModuleNode::restoreAll();
+  timeClientSetup();
+
+  bool found = false;
+  for (const Scenario& scenario : scenarios) {
+    if (only != nullptr && strcmp(only, scenario.name) != 0 && strcmp(only, scenario.mode) != 0) continue;
+    run(scenario, settings);
+    found = true;
+  }
+  if (!found) {
+    fprintf(stderr, "no scenario %s\n", only);
+    return 2;
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * Native stand-in for the Arduino Print class.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "WString.h"
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  virtual int  availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char    buf[256];
+    va_list arg;
+    va_start(arg, format);
+    int len = vsnprintf(buf, sizeof(buf), format, arg);
+    va_end(arg);
+    if (len < 0) return 0;
+    return write((const uint8_t*)buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+  }
+
+  size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(int n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(unsigned int n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(long n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(unsigned long n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(long long n, int base = 10) { return print(String((long)n, (unsigned char)base)); }
+  size_t print(unsigned long long n, int base = 10) { return print(String((unsigned long)n, (unsigned char)base)); }
+  size_t print(double n, int digits = 2) { return print(String(n, (unsigned char)digits)); }
+  size_t print(bool b) { return print((int)b); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    size_t n = print(value);
+    return n + println();
+  }
+};
@@ -0,0 +1,23 @@
+/**
+ * Native stand-in for the RelayModule library.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class RelayModule {
+public:
+  RelayModule(int pin, boolean invert = false) : _pin(pin), _onSignal(invert ? LOW : HIGH), _offSignal(invert ? HIGH : LOW) {
+    pinMode(_pin, OUTPUT);
+  }
+  void    on() { digitalWrite(_pin, _onSignal); }
+  void    off() { digitalWrite(_pin, _offSignal); }
+  void    toggle() { isOn() ? off() : on(); }
+  boolean isOn() { return digitalRead(_pin) == _onSignal; }
+  boolean isOff() { return !isOn(); }
+
+private:
+  int     _pin;
+  uint8_t _onSignal;
+  uint8_t _offSignal;
+};
@@ -0,0 +1,377 @@
+/**
+ * Entry point of the native replay build: runs the sketch's setup() and
+ * loop() against a trace recorded in the field, see src/TraceRecorder.hpp.
+ *
+ *   program [--segment N] [--step MS] [--tolerance MS] [--decisions FILE] [--set name=value]...
+ *           [--list] TRACE...
+ *
+ * The trace files are read in the given order, trace.old before trace.bin.
+ * A segment is one recording from start() on, or from the start of a new
+ * file, which begins with the snapshot again; --list prints them, the last
+ * one is replayed by default. The replay runs on the virtual clock from
+ * boot: the NTP clock answers the recorded time, the sensors of the trace
+ * sit on their 1-Wire buses and take each recorded reading at its time,
+ * the commands go through handleInput() at theirs, and loop() runs every
+ * --step ms (default 100) in between.
+ *
+ * The relay transitions of the replay are the decisions of this build.
+ * They are compared with the recorded ones, pin by pin in order; a
+ * transition to another state or more than --tolerance ms (default 2000)
+ * away diverges and is printed to stderr. --decisions writes them as
+ * "millis pin state" lines, for diffing two builds against each other.
+ *
+ * Each event is timed on the wall clock, applying it and the loop() pass
+ * after it. The summary is one JSON line:
+ *
+ *   {"segment":0,"firmware":"2.0.0","records":4180,"simulatedS":43200,"wallMs":310,"speedup":139355,
+ *    "decisions":{"recorded":12,"replayed":12,"diverged":0},
+ *    "events":{"sensor":{"count":3600,"meanUs":21.4,"maxUs":160},"input":{..},"state":{..}}}
+ *
+ * Exit status 1 if a decision diverged.
+ */
+#ifdef NATIVE_REPLAY
+
+#include <Arduino.h>
+#include <Homie.hpp>
+#include <NativeHal.hpp>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include "OneWireBus.hpp"
+#include "TraceRecorder.hpp"
+
+void setup();
+void loop();
+
+namespace {
+
+struct Record {
+  uint32_t             millis;
+  uint8_t              type;
+  std::vector<uint8_t> payload;
+};
+
+struct Segment {
+  std::vector<Record> records;
+  std::string         firmware;
+};
+
+struct Decision {
+  uint32_t millis;
+  uint8_t  pin;
+  bool     state;
+};
+
+struct Sensor {
+  std::unique_ptr<hal::Ds18b20> device;
+  float                         celsius;
+};
+
+struct EventStats {
+  uint32_t count = 0;
+  double   sumUs = 0;
+  double   maxUs = 0;
+};
+
+const float DISCONNECTED_F = -196.6F;
+
+/**
+ * Appends the records of a trace file, a new segment starts with a boot
+ * (millis going back), a start() or a new file (STATE after other records,
+ * with the TIME record before it).
+ */
+bool readTrace(const char* path, std::vector<Segment>& segments) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) return false;
+
+  uint32_t magic;
+  uint16_t version;
+  uint8_t  length;
+  char     firmware[33] = {0};
+  if (fread(&magic, 4, 1, file) != 1 || magic != TraceRecorder::MAGIC || fread(&version, 2, 1, file) != 1
+      || version != TraceRecorder::VERSION || fread(&length, 1, 1, file) != 1 || fread(firmware, 1, min(length, (uint8_t)32), file) != min(length, (uint8_t)32)) {
+    fclose(file);
+    return false;
+  }
+
+  uint8_t header[6];
+  while (fread(header, sizeof(header), 1, file) == 1) {
+    Record record;
+    memcpy(&record.millis, header, 4);
+    record.type = header[4];
+    record.payload.resize(header[5]);
+    if (fread(record.payload.data(), 1, header[5], file) != header[5]) break;  // cut by a reset while writing
+
+    const Record* last = (segments.empty() || segments.back().records.empty()) ? nullptr : &segments.back().records.back();
+    if (segments.empty() || (last != nullptr && (record.millis < last->millis
+                                                 || (record.type == TraceRecorder::TYPE_STATE && last->type != TraceRecorder::TYPE_STATE
+                                                     && last->type != TraceRecorder::TYPE_TIME)))) {
+      segments.push_back(Segment());
+    } else if (record.type == TraceRecorder::TYPE_STATE && last->type == TraceRecorder::TYPE_TIME && segments.back().records.size() > 1
+               && segments.back().records.end()[-2].type != TraceRecorder::TYPE_STATE) {
+      // the TIME record of a start() with a valid clock, or of a new file, opens the segment
+      const Record time = *last;
+      segments.back().records.pop_back();
+      segments.push_back(Segment());
+      segments.back().records.push_back(time);
+    }
+    segments.back().firmware = firmware;
+    segments.back().records.push_back(record);
+  }
+  fclose(file);
+  return true;
+}
+
+std::string addressOf(const uint8_t* address) {
+  char hex[17];
+  for (uint8_t i = 0; i < 8; i++) sprintf(hex + 2 * i, "%02x", address[i]);
+  return hex;
+}
+
+/**
+ * INPUT and STATE: range, node, property, value.
+ */
+bool applyCommand(const Record& record) {
+  const std::vector<uint8_t>& p = record.payload;
+  if (p.size() < 3) return false;
+
+  const int   range = (p[0] == 0xFF) ? -1 : p[0];
+  size_t      i     = 1;
+  std::string node((const char*)&p[i + 1], min((size_t)p[i], p.size() - i - 1));
+  i += 1 + node.size();
+  if (i >= p.size()) return false;
+  std::string property((const char*)&p[i + 1], min((size_t)p[i], p.size() - i - 1));
+  i += 1 + property.size();
+  std::string value((const char*)p.data() + i, p.size() - i);
+
+  return Homie.injectInput(node.c_str(), property.c_str(), String(value.c_str()), range);
+}
+
+/**
+ * Pairs the transitions of each pin in order.
+ * @return number of diverged decisions
+ */
+uint32_t compare(const std::vector<Decision>& recorded, const std::vector<Decision>& replayed, uint32_t tolerance) {
+  std::map<uint8_t, std::vector<Decision>> byPin[2];
+  for (const Decision& decision : recorded) byPin[0][decision.pin].push_back(decision);
+  for (const Decision& decision : replayed) byPin[1][decision.pin].push_back(decision);
+  for (const auto& pin : byPin[1]) byPin[0][pin.first];
+
+  uint32_t diverged = 0;
+  for (const auto& pin : byPin[0]) {
+    const std::vector<Decision>& a = pin.second;
+    const std::vector<Decision>& b = byPin[1][pin.first];
+    for (size_t i = 0; i < max(a.size(), b.size()); i++) {
+      if (i >= b.size()) {
+        fprintf(stderr, "pin %u: recorded %s at %u ms, not replayed\n", pin.first, a[i].state ? "on" : "off", a[i].millis);
+      } else if (i >= a.size()) {
+        fprintf(stderr, "pin %u: replayed %s at %u ms, not recorded\n", pin.first, b[i].state ? "on" : "off", b[i].millis);
+      } else if (a[i].state != b[i].state || (uint32_t)abs((long)a[i].millis - (long)b[i].millis) > tolerance) {
+        fprintf(stderr, "pin %u: recorded %s at %u ms, replayed %s at %u ms\n", pin.first, a[i].state ? "on" : "off", a[i].millis,
+                b[i].state ? "on" : "off", b[i].millis);
+      } else {
+        continue;
+      }
+      diverged++;
+    }
+  }
+  return diverged;
+}
+
+void printStats(const char* name, const EventStats& stats, bool last) {
+  printf("\"%s\":{\"count\":%u,\"meanUs\":%.1f,\"maxUs\":%.0f}%s", name, stats.count, stats.count ? stats.sumUs / stats.count : 0.0,
+         stats.maxUs, last ? "" : ",");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned long segmentIndex = (unsigned long)-1;
+  unsigned long step         = 100;
+  unsigned long tolerance    = 2000;
+  const char*   decisionPath = nullptr;
+  bool          list         = false;
+
+  std::vector<Segment> segments;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--segment") == 0 && hasValue) {
+      segmentIndex = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--step") == 0 && hasValue) {
+      step = max(1UL, strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+      tolerance = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--decisions") == 0 && hasValue) {
+      decisionPath = argv[++i];
+    } else if (strcmp(argv[i], "--set") == 0 && hasValue) {
+      char* name  = argv[++i];
+      char* value = strchr(name, '=');
+      if (value == nullptr) {
+        fprintf(stderr, "--set expects name=value: %s\n", name);
+        return 2;
+      }
+      *value++ = '\0';
+
+      HomieInternals::IHomieSetting* setting = HomieInternals::IHomieSetting::find(name);
+      if (setting == nullptr || !setting->parse(value)) {
+        fprintf(stderr, "invalid setting: %s=%s\n", name, value);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--list") == 0) {
+      list = true;
+    } else if (argv[i][0] != '-') {
+      if (!readTrace(argv[i], segments)) {
+        fprintf(stderr, "can't read trace: %s\n", argv[i]);
+        return 2;
+      }
+    } else {
+      fprintf(stderr,
+              "usage: %s [--segment N] [--step MS] [--tolerance MS] [--decisions FILE] [--set name=value]... [--list] TRACE...\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  if (segments.empty()) {
+    fprintf(stderr, "no records\n");
+    return 2;
+  }
+  if (list) {
+    for (size_t i = 0; i < segments.size(); i++) {
+      const std::vector<Record>& records = segments[i].records;
+      uint32_t                   utc     = 0;
+      for (const Record& record : records) {
+        if (record.type == TraceRecorder::TYPE_TIME && record.payload.size() == 4) memcpy(&utc, record.payload.data(), 4);
+      }
+      printf("%zu: firmware %s, %zu records, %u..%u ms, UTC %u\n", i, segments[i].firmware.c_str(), records.size(),
+             records.front().millis, records.back().millis, utc);
+    }
+    return 0;
+  }
+  if (segmentIndex == (unsigned long)-1) segmentIndex = segments.size() - 1;
+  if (segmentIndex >= segments.size()) {
+    fprintf(stderr, "no segment %lu\n", segmentIndex);
+    return 2;
+  }
+  const Segment& segment = segments[segmentIndex];
+
+  // the clock and the sensors of the segment before the sketch boots
+  hal::setVirtualClock(true);
+  std::map<std::string, Sensor> sensors;
+  for (const Record& record : segment.records) {
+    if (record.type == TraceRecorder::TYPE_TIME && record.payload.size() == 4) {
+      uint32_t utc;
+      memcpy(&utc, record.payload.data(), 4);
+      hal::setNtpEpoch(utc - record.millis / 1000);
+    } else if (record.type == TraceRecorder::TYPE_SENSOR && record.payload.size() == 11) {
+      const uint8_t     pin = record.payload[0];
+      const std::string key = std::to_string(pin) + "/" + addressOf(&record.payload[1]);
+      if (sensors.count(key) > 0 || pin >= hal::NUM_PINS) continue;
+
+      int16_t raw;
+      memcpy(&raw, &record.payload[9], 2);
+      Sensor& sensor = sensors[key];
+      sensor.celsius = (raw / 100.0F - 32) / 1.8F;
+      sensor.device.reset(new hal::Ds18b20(addressOf(&record.payload[1]).c_str(), [&sensor](double) { return sensor.celsius; }));
+      hal::oneWireBus(pin).attach(sensor.device.get());
+    }
+  }
+
+  std::vector<Decision> recorded, replayed;
+  bool                  deciding = false;
+  uint8_t               levels[hal::NUM_PINS];
+  memset(levels, 0xFF, sizeof(levels));
+  hal::setPinWriteHook([&](uint8_t pin, uint8_t level) {
+    if (pin >= hal::NUM_PINS || levels[pin] == level) return;
+    levels[pin] = level;
+    // relay modules switch on LOW
+    if (deciding) replayed.push_back({(uint32_t)millis(), pin, level == LOW});
+  });
+  Homie.setPublishHook([](const char*, const char*, bool) {});
+
+  setup();
+  loop();
+  hal::advanceMillis(segment.records.front().millis - min((uint32_t)millis(), segment.records.front().millis));
+
+  EventStats stats[TraceRecorder::TYPE_RELAY + 1];
+  const auto wallStart = std::chrono::steady_clock::now();
+
+  for (const Record& record : segment.records) {
+    while (millis() < record.millis) {
+      loop();
+      hal::advanceMillis(min((unsigned long)(record.millis - millis()), step));
+    }
+
+    // the snapshot of the segment start isn't a decision
+    deciding = record.type != TraceRecorder::TYPE_STATE;
+
+    const auto start = std::chrono::steady_clock::now();
+    switch (record.type) {
+      case TraceRecorder::TYPE_SENSOR: {
+        Sensor& sensor = sensors[std::to_string(record.payload[0]) + "/" + addressOf(&record.payload[1])];
+        int16_t raw;
+        memcpy(&raw, &record.payload[9], 2);
+        const float fahrenheit = raw / 100.0F;
+        sensor.device->setConnected(fabsf(fahrenheit - DISCONNECTED_F) > 0.01F);
+        sensor.celsius = (fahrenheit - 32) / 1.8F;
+        break;
+      }
+      case TraceRecorder::TYPE_STATE:
+      case TraceRecorder::TYPE_INPUT:
+        if (!applyCommand(record)) fprintf(stderr, "%u ms: command not handled\n", record.millis);
+        break;
+      case TraceRecorder::TYPE_RELAY:
+        if (record.payload.size() == 2) recorded.push_back({record.millis, record.payload[0], record.payload[1] != 0});
+        break;
+      default:
+        break;
+    }
+    loop();
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    if (record.type <= TraceRecorder::TYPE_RELAY) {
+      EventStats& event = stats[record.type];
+      event.count++;
+      event.sumUs += us;
+      event.maxUs = std::max(event.maxUs, us);
+    }
+  }
+
+  // decisions still pending at the end of the trace
+  deciding = true;
+  const uint32_t end = segment.records.back().millis + tolerance;
+  while (millis() < end) {
+    loop();
+    hal::advanceMillis(step);
+  }
+
+  const double wallMs    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+  const double simulated = (segment.records.back().millis - segment.records.front().millis) / 1000.0;
+
+  if (decisionPath != nullptr) {
+    FILE* file = fopen(decisionPath, "w");
+    if (file == nullptr) {
+      fprintf(stderr, "can't write decisions: %s\n", decisionPath);
+      return 2;
+    }
+    for (const Decision& decision : replayed) fprintf(file, "%u %u %u\n", decision.millis, decision.pin, decision.state);
+    fclose(file);
+  }
+
+  const uint32_t diverged = compare(recorded, replayed, tolerance);
+  printf("{\"segment\":%lu,\"firmware\":\"%s\",\"records\":%zu,\"simulatedS\":%.0f,\"wallMs\":%.0f,\"speedup\":%.0f,"
+         "\"decisions\":{\"recorded\":%zu,\"replayed\":%zu,\"diverged\":%u},\"events\":{",
+         segmentIndex, segment.firmware.c_str(), segment.records.size(), simulated, wallMs, wallMs > 0 ? simulated * 1000 / wallMs : 0.0,
+         recorded.size(), replayed.size(), diverged);
+  printStats("time", stats[TraceRecorder::TYPE_TIME], false);
+  printStats("state", stats[TraceRecorder::TYPE_STATE], false);
+  printStats("sensor", stats[TraceRecorder::TYPE_SENSOR], false);
+  printStats("input", stats[TraceRecorder::TYPE_INPUT], false);
+  printStats("relay", stats[TraceRecorder::TYPE_RELAY], true);
+  printf("}}\n");
+  return diverged > 0 ? 1 : 0;
+}
+
+#endif
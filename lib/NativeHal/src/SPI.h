@@ -0,0 +1,4 @@
+/**
+ * Native stand-in for the SPI header, nothing of it is used.
+ */
+#pragma once
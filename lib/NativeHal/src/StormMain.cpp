@@ -0,0 +1,355 @@
+/**
+ * Entry point of the native storm build: floods the sketch's handleInput()
+ * paths with MQTT commands at rising rates and finds where it starts to
+ * delay or drop work.
+ *
+ *   program [--rate R] [--duration S] [--mix mode:1,switch:4,timer:1,log:1] [--cpu-scale F]
+ *           [--min-pass US] [--queue N] [--publish-limit N] [--max-latency MS] [--seed N] [--set name=value]...
+ *
+ * Commands arrive as a Poisson stream of R per second (default: a sweep of
+ * rates from 1 to 2000) for S seconds of controller time each (default 60),
+ * drawn by the weights of --mix:
+ *
+ *   mode    operation-mode/mode auto|manu
+ *   switch  pool-lights/switch true|false
+ *   timer   operation-mode/timer-start-h 9|10
+ *   log     Log/Level DEBUG
+ *
+ * The controller is modelled as one CPU on the virtual clock: a pass of
+ * loop() or a command takes its time on the host times --cpu-scale
+ * (default 20, about the speed of a PC to the 80 MHz ESP8266; the
+ * benchmarks of both calibrate it), plus the virtual time it waited for
+ * the sensors, and a pass at least --min-pass µs (default 500). As on the
+ * device the commands are handled between two passes of loop(), all that
+ * arrived meanwhile. --queue limits the commands waiting, like the queue
+ * of the broker, beyond it they are dropped; 0 (default) doesn't limit.
+ * --publish-limit lets the MQTT client take N publishes per pass, the rest
+ * waits in the publish queue (PublishQueue.hpp); 0 (default) takes all.
+ *
+ * One JSON line per rate:
+ *
+ *   {"rate":200,"commands":11987,"sustained":199.8,"dropped":0,"backlog":0,"p50Ms":0.6,"p90Ms":1.1,"p99Ms":9.8,
+ *    "maxMs":752.4,"maxLatenessMs":3,"logDropped":0,"serialDropped":12,"publishMaxDepth":6,"publishCoalesced":0,
+ *    "publishDropped":0,"allocsPerCommand":6.1,"heapGrowth":0}
+ *
+ * Latency runs from the arrival to the end of handleInput(), lateness is
+ * that of the scheduler tasks. logDropped and serialDropped count the log
+ * records lost by the Log node and the serial log, the publish counts are
+ * those of the publish queue. allocsPerCommand counts
+ * with HEAP_TRACKING, heapGrowth is the growth of the host heap in bytes.
+ * The last line names the lowest rates with a p99 over --max-latency ms
+ * (default 1000) or less than 95 % of the commands handled, with commands
+ * or publishes dropped, and with log records lost, null if none of the
+ * rates did:
+ *
+ *   {"delayingAt":1000,"droppingAt":500,"losingLogsAt":2}
+ */
+#ifdef NATIVE_STORM
+
+#include <Arduino.h>
+#include <Homie.hpp>
+#include <NativeHal.hpp>
+#include <malloc.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include "HeapTracker.hpp"
+#include "LoggerNode.hpp"
+#include "OneWireBus.hpp"
+#include "PublishQueue.hpp"
+#include "Scheduler.hpp"
+#include "SerialLogBuffer.hpp"
+
+void setup();
+void loop();
+
+extern LoggerNode LN;
+
+namespace {
+
+enum Kind { MODE, SWITCH, TIMER, LOG, KINDS };
+
+const char* const cKindNames[KINDS] = {"mode", "switch", "timer", "log"};
+
+struct Command {
+  uint64_t arrival;  // in µs on the virtual clock
+  Kind     kind;
+};
+
+struct Options {
+  double   cpuScale   = 20.0;
+  uint32_t minPass    = 500;   // in µs
+  size_t   queue      = 0;
+  double   maxLatency = 1000;  // in ms
+  uint32_t duration   = 60;    // in s
+  uint32_t weights[KINDS] = {1, 4, 1, 1};
+};
+
+struct Result {
+  bool delaying;
+  bool dropping;
+  bool losingLogs;
+};
+
+uint32_t randomState;
+
+/** Spreads the seed over all bits: from a small state xorshift32 draws near 0 for a while. */
+void seed(uint32_t value) {
+  value ^= value >> 16;
+  value *= 0x85EBCA6BUL;
+  value ^= value >> 13;
+  value *= 0xC2B2AE35UL;
+  value ^= value >> 16;
+  randomState = value != 0 ? value : 1;
+}
+
+/** Uniform in (0, 1], xorshift32. */
+double uniform() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (randomState + 1.0) / 4294967296.0;
+}
+
+/** Time to the next arrival in µs, exponential. */
+uint64_t interval(double rate) {
+  return (uint64_t)(-std::log(uniform()) / rate * 1e6);
+}
+
+Kind drawKind(const Options& options) {
+  uint32_t total = 0;
+  for (uint32_t weight : options.weights) total += weight;
+
+  uint32_t pick = (uint32_t)(uniform() * total);
+  for (uint8_t kind = 0; kind < KINDS; kind++) {
+    if (pick < options.weights[kind]) return (Kind)kind;
+    pick -= options.weights[kind];
+  }
+  return SWITCH;
+}
+
+/**
+ * @return host time in µs
+ */
+double inject(Kind kind, uint32_t sequence, uint32_t& allocations) {
+#ifdef HEAP_TRACKING
+  // around the command only, the diagnostics node resets the counters once a minute
+  const uint32_t allocationsBefore = HeapTracker::getAllocations();
+#endif
+  const bool  odd   = sequence & 1;
+  const auto  start = std::chrono::steady_clock::now();
+  switch (kind) {
+    case MODE:
+      Homie.injectInput("operation-mode", "mode", odd ? "auto" : "manu");
+      break;
+    case SWITCH:
+      Homie.injectInput("pool-lights", "switch", odd ? "true" : "false");
+      break;
+    case TIMER:
+      Homie.injectInput("operation-mode", "timer-start-h", odd ? "9" : "10");
+      break;
+    default:
+      Homie.injectInput("Log", "Level", "DEBUG");
+      break;
+  }
+#ifdef HEAP_TRACKING
+  allocations += HeapTracker::getAllocations() - allocationsBefore;
+#endif
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(std::vector<double>& values, double p) {
+  if (values.empty()) return 0;
+  const size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+Result run(FILE* out, double rate, const Options& options) {
+  std::deque<Command> waiting;
+  std::vector<double> latencies;  // in ms
+  uint32_t            arrived = 0, dropped = 0, sequence = 0, maxLateness = 0, allocations = 0;
+
+  const uint32_t logDropped    = LN.getDropped();
+  const uint32_t serialDropped = serialLog.getDropped();
+  const size_t heap = mallinfo2().uordblks;
+  const uint32_t publishCoalesced = publishQueue.getCoalesced();
+  const uint32_t publishDropped   = publishQueue.getDropped();
+  uint8_t        publishMaxDepth  = 0;
+  publishQueue.resetMaxDepth();
+
+  const uint64_t start = hal::nowMicros();
+  const uint64_t end   = start + options.duration * 1000000ULL;
+  uint64_t       next  = start + interval(rate);
+
+  while (hal::nowMicros() < end) {
+    // a pass of the loop
+    const uint64_t passStart = hal::nowMicros();
+    const auto     wallStart = std::chrono::steady_clock::now();
+    loop();
+    const double   wall   = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+    const uint64_t waited = hal::nowMicros() - passStart;
+    hal::advanceMicros(std::max<uint64_t>((uint64_t)(wall * options.cpuScale), waited < options.minPass ? options.minPass - waited : 0));
+    maxLateness     = std::max(maxLateness, scheduler.getMaxLateness());
+    publishMaxDepth = std::max(publishMaxDepth, publishQueue.getMaxDepth());  // the diagnostics node resets it
+
+    // then the commands that arrived meanwhile, and while handling them
+    for (;;) {
+      while (next <= hal::nowMicros() && next < end) {
+        arrived++;
+        if (options.queue > 0 && waiting.size() >= options.queue) {
+          dropped++;
+        } else {
+          waiting.push_back({next, drawKind(options)});
+        }
+        next += interval(rate);
+      }
+      if (waiting.empty()) break;
+
+      const Command command = waiting.front();
+      waiting.pop_front();
+      hal::advanceMicros((uint64_t)(inject(command.kind, sequence++, allocations) * options.cpuScale));
+      latencies.push_back((hal::nowMicros() - command.arrival) / 1000.0);
+      publishMaxDepth = std::max(publishMaxDepth, publishQueue.getMaxDepth());
+    }
+  }
+
+  const double seconds = (hal::nowMicros() - start) / 1e6;
+  const size_t backlog = waiting.size();
+  const double p99     = percentile(latencies, 0.99);
+  const double maxMs   = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+
+  Result result;
+  result.delaying = p99 > options.maxLatency || latencies.size() < 0.95 * arrived;
+  result.dropping   = dropped > 0 || publishQueue.getDropped() != publishDropped;
+  result.losingLogs = LN.getDropped() != logDropped || serialLog.getDropped() != serialDropped;
+
+  fprintf(out,
+          "{\"rate\":%g,\"commands\":%zu,\"sustained\":%.1f,\"dropped\":%u,\"backlog\":%zu,\"p50Ms\":%.1f,\"p90Ms\":%.1f,\"p99Ms\":%.1f,"
+          "\"maxMs\":%.1f,\"maxLatenessMs\":%u,\"logDropped\":%u,\"serialDropped\":%u,\"publishMaxDepth\":%u,\"publishCoalesced\":%u,"
+          "\"publishDropped\":%u,",
+          rate, latencies.size(), latencies.size() / seconds, dropped, backlog, percentile(latencies, 0.5), percentile(latencies, 0.9), p99,
+          maxMs, maxLateness, LN.getDropped() - logDropped, serialLog.getDropped() - serialDropped, publishMaxDepth,
+          publishQueue.getCoalesced() - publishCoalesced, publishQueue.getDropped() - publishDropped);
+#ifdef HEAP_TRACKING
+  fprintf(out, "\"allocsPerCommand\":%.1f,", latencies.empty() ? 0.0 : (double)allocations / latencies.size());
+#else
+  fprintf(out, "\"allocsPerCommand\":null,");
+#endif
+  fprintf(out, "\"heapGrowth\":%ld}\n", (long)mallinfo2().uordblks - (long)heap);
+  fflush(out);
+  return result;
+}
+
+bool parseMix(char* mix, Options& options) {
+  for (char* item = strtok(mix, ","); item != nullptr; item = strtok(nullptr, ",")) {
+    char* weight = strchr(item, ':');
+    if (weight == nullptr) return false;
+    *weight++ = '\0';
+
+    uint8_t kind = 0;
+    while (kind < KINDS && strcmp(item, cKindNames[kind]) != 0) kind++;
+    if (kind == KINDS) return false;
+    options.weights[kind] = strtoul(weight, nullptr, 10);
+  }
+  uint32_t total = 0;
+  for (uint32_t weight : options.weights) total += weight;
+  return total > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options             options;
+  std::vector<double> rates = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000};
+  seed(1);
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--rate") == 0 && hasValue) {
+      rates = {std::max(0.01, strtod(argv[++i], nullptr))};
+    } else if (strcmp(argv[i], "--duration") == 0 && hasValue) {
+      options.duration = std::max(1UL, strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--mix") == 0 && hasValue) {
+      if (!parseMix(argv[++i], options)) {
+        fprintf(stderr, "--mix expects kind:weight,... with the kinds mode, switch, timer, log\n");
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--cpu-scale") == 0 && hasValue) {
+      options.cpuScale = strtod(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--min-pass") == 0 && hasValue) {
+      options.minPass = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--queue") == 0 && hasValue) {
+      options.queue = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--publish-limit") == 0 && hasValue) {
+      Homie.setPublishLimit(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--max-latency") == 0 && hasValue) {
+      options.maxLatency = strtod(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--set") == 0 && hasValue) {
+      char* name  = argv[++i];
+      char* value = strchr(name, '=');
+      HomieInternals::IHomieSetting* setting = nullptr;
+      if (value != nullptr) {
+        *value++ = '\0';
+        setting  = HomieInternals::IHomieSetting::find(name);
+      }
+      if (setting == nullptr || !setting->parse(value)) {
+        fprintf(stderr, "invalid setting: %s\n", name);
+        return 2;
+      }
+    } else {
+      fprintf(stderr,
+              "usage: %s [--rate R] [--duration S] [--mix mode:1,switch:4,timer:1,log:1] [--cpu-scale F] [--min-pass US] [--queue N] "
+              "[--publish-limit N] [--max-latency MS] [--seed N] [--set name=value]...\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  // the results keep stdout, the serial port of the firmware goes to /dev/null
+  fflush(stdout);
+  FILE* out = fdopen(dup(fileno(stdout)), "w");
+  if (out == nullptr || freopen("/dev/null", "w", stdout) == nullptr) {
+    perror("stdout");
+    return 1;
+  }
+
+  // the sensors of the controller, read every interval as in the field
+  hal::Ds18b20 solar(1, hal::waveform::constant(40.0F));
+  hal::Ds18b20 suction(2, hal::waveform::constant(25.0F));
+  hal::Ds18b20 ret(3, hal::waveform::constant(26.0F));
+  hal::oneWireBus(0).attach(&solar);
+  hal::oneWireBus(2).attach(&suction);
+  hal::oneWireBus(2).attach(&ret);
+
+  hal::setVirtualClock(true);
+  Homie.setPublishHook([](const char*, const char*, bool) {});
+  setup();
+  // settle: the setup handler, the first measurements
+  for (int i = 0; i < 2000; i++) {
+    loop();
+    hal::advanceMillis(10);
+  }
+
+  double delayingAt = 0, droppingAt = 0, losingLogsAt = 0;
+  for (double rate : rates) {
+    const Result result = run(out, rate, options);
+    if (result.delaying && delayingAt == 0) delayingAt = rate;
+    if (result.dropping && droppingAt == 0) droppingAt = rate;
+    if (result.losingLogs && losingLogsAt == 0) losingLogsAt = rate;
+    if (delayingAt > 0 && droppingAt > 0) break;
+  }
+  char delaying[16] = "null", dropping[16] = "null", losingLogs[16] = "null";
+  if (delayingAt > 0) snprintf(delaying, sizeof(delaying), "%g", delayingAt);
+  if (droppingAt > 0) snprintf(dropping, sizeof(dropping), "%g", droppingAt);
+  if (losingLogsAt > 0) snprintf(losingLogs, sizeof(losingLogs), "%g", losingLogsAt);
+  fprintf(out, "{\"delayingAt\":%s,\"droppingAt\":%s,\"losingLogsAt\":%s}\n", delaying, dropping, losingLogs);
+  fclose(out);
+  return 0;
+}
+
+#endif
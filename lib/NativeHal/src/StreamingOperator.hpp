@@ -0,0 +1,19 @@
+/**
+ * Native stand-in for the Homie logger stream operators.
+ */
+#pragma once
+
+#include "Print.h"
+
+template <class T>
+inline Print& operator<<(Print& stream, T arg) {
+  stream.print(arg);
+  return stream;
+}
+
+enum _EEndLineCode { endl };
+
+inline Print& operator<<(Print& stream, _EEndLineCode) {
+  stream.println();
+  return stream;
+}
@@ -0,0 +1,147 @@
+/**
+ * Lumped thermal model of the pool installation.
+ */
+#include "ThermalPlant.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+namespace hal {
+
+namespace {
+const float WATER_HEAT = 4186.0F;  // J/kgK
+}  // namespace
+
+/* ---- weather ---- */
+
+namespace weather {
+
+WeatherSource synthetic(float airMean, float airSwing, float peakIrradiance, float sunrise, float sunset, float clouds, uint32_t seed) {
+  return [=](double seconds) {
+    const double hour = std::fmod(seconds / 3600, 24);
+
+    Weather weather;
+    weather.air = airMean + airSwing * (float)std::cos(2 * M_PI * (hour - 15) / 24);
+
+    weather.irradiance = 0.0F;
+    if (hour > sunrise && hour < sunset) {
+      weather.irradiance = peakIrradiance * (float)std::sin(M_PI * (hour - sunrise) / (sunset - sunrise));
+
+      // the same cut for every sample of an hour
+      uint32_t h = seed ^ ((uint32_t)(seconds / 3600) * 2654435761U);
+      h ^= h >> 15;
+      h *= 2246822519U;
+      h ^= h >> 13;
+      weather.irradiance *= 1.0F - clouds * (float)(h % 1000) / 1000.0F;
+    }
+    return weather;
+  };
+}
+
+WeatherSource recorded(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) return WeatherSource();
+
+  struct Sample {
+    double  hour;
+    Weather weather;
+  };
+  std::vector<Sample> samples;
+
+  char line[128];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    Sample sample;
+    if (sscanf(line, "%lf,%f,%f", &sample.hour, &sample.weather.air, &sample.weather.irradiance) == 3) {
+      samples.push_back(sample);
+    }
+  }
+  fclose(file);
+  if (samples.empty()) return WeatherSource();
+
+  return [samples](double seconds) {
+    const double span = samples.back().hour;
+    const double hour = (span > 0) ? std::fmod(seconds / 3600, span) : 0;
+
+    size_t i = 0;
+    while (i + 1 < samples.size() && samples[i + 1].hour <= hour) i++;
+    if (i + 1 == samples.size()) return samples[i].weather;
+
+    const Sample& a = samples[i];
+    const Sample& b = samples[i + 1];
+    const float   f = (float)((hour - a.hour) / (b.hour - a.hour));
+
+    Weather weather;
+    weather.air        = a.weather.air + f * (b.weather.air - a.weather.air);
+    weather.irradiance = a.weather.irradiance + f * (b.weather.irradiance - a.weather.irradiance);
+    return weather;
+  };
+}
+
+}  // namespace weather
+
+/* ---- plant ---- */
+
+/**
+ * A 50 m³ outdoor pool with 20 m² of unglazed collectors and an 11 kW heater.
+ */
+ThermalPlant::Parameters ThermalPlant::defaults() {
+  Parameters p;
+  p.poolVolume          = 50.0F;
+  p.poolArea            = 32.0F;
+  p.poolLoss            = 35.0F;  // evaporation and night sky included
+  p.poolAbsorptance     = 0.6F;
+  p.collectorArea       = 20.0F;
+  p.collectorEfficiency = 0.85F;
+  p.collectorLoss       = 15.0F;
+  p.collectorCapacity   = 20.0F * 6.0F * WATER_HEAT;  // 6 l of water per m²
+  p.pipeCapacity        = 40.0F * WATER_HEAT;         // 40 l in the pipes
+  p.pipeLoss            = 15.0F;
+  p.solarFlow           = 0.5F;
+  p.heaterPower         = 11000.0F;
+  return p;
+}
+
+ThermalPlant::ThermalPlant(const Parameters& parameters) : _p(parameters) {
+  reset(20.0F);
+}
+
+void ThermalPlant::reset(float temperature) {
+  _pool         = temperature;
+  _collector    = temperature;
+  _pipe         = temperature;
+  _solarEnergy  = 0;
+  _heaterEnergy = 0;
+}
+
+/**
+ * Explicit Euler, stable for dt well below the smallest time constant, the
+ * pipe's: pipeCapacity / (solarFlow * 4186) = 80 s with the defaults.
+ */
+void ThermalPlant::step(float dt, const Weather& weather, bool poolPump, bool solarPump, bool heater) {
+  const float poolCapacity = _p.poolVolume * 1000.0F * WATER_HEAT;
+
+  // collector: sun in, losses out, flow out to the pipe
+  const float flow      = solarPump ? _p.solarFlow * WATER_HEAT : 0.0F;  // W/K
+  const float collector = _p.collectorEfficiency * weather.irradiance * _p.collectorArea
+                        - _p.collectorLoss * _p.collectorArea * (_collector - weather.air)
+                        - flow * (_collector - _pool);
+
+  // pipe: the collector outlet pushes its water out into the pool
+  const float pipe  = flow * (_collector - _pipe) - _p.pipeLoss * (_pipe - weather.air);
+  const float solar = flow * (_pipe - _pool);
+
+  // pool: surface gains and losses, collector loop, heater with circulation
+  const float heating = (heater && poolPump) ? _p.heaterPower : 0.0F;
+  const float pool    = _p.poolAbsorptance * weather.irradiance * _p.poolArea
+                     - _p.poolLoss * _p.poolArea * (_pool - weather.air)
+                     + solar + heating;
+
+  _collector += collector * dt / _p.collectorCapacity;
+  _pipe += pipe * dt / _p.pipeCapacity;
+  _pool += pool * dt / poolCapacity;
+
+  _solarEnergy += solar * dt;
+  _heaterEnergy += heating * dt;
+}
+
+}  // namespace hal
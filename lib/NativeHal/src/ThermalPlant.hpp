@@ -0,0 +1,92 @@
+/**
+ * Lumped thermal model of the pool, the solar collector, the heater and the
+ * collector piping, for running the rules against simulated weather.
+ *
+ * Four heat capacities at one temperature each:
+ *
+ *   pool       gains sun on its surface, loses to the air, takes the heat of
+ *              the collector loop and the heater
+ *   collector  gains sun, loses to the air, passes its heat to the water
+ *              flowing through it
+ *   pipe       water between collector and pool, cools to the air when idle
+ *   heater     adds its power to the pool while the pool pump runs
+ *
+ * step() integrates with the relay states given by the caller; the
+ * temperatures are what the sensors of the controller would read.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+/** Air temperature in °C and global irradiance in W/m² at a time. */
+struct Weather {
+  float air;
+  float irradiance;
+};
+
+typedef std::function<Weather(double seconds)> WeatherSource;
+
+namespace weather {
+/**
+ * Clear days between sunrise and sunset (local hours) with a half sine of
+ * the irradiance, the air temperature peaks at 15:00. clouds 0..1 cuts the
+ * irradiance by a random amount per hour, reproducible by seed.
+ */
+WeatherSource synthetic(float airMean, float airSwing, float peakIrradiance, float sunrise, float sunset, float clouds = 0.0F, uint32_t seed = 1);
+/**
+ * Recorded weather, CSV lines "hour,air,irradiance" with hours since the
+ * start, interpolated linearly and repeated after the last line.
+ * @return empty function if the file can't be read
+ */
+WeatherSource recorded(const char* path);
+}  // namespace weather
+
+class ThermalPlant {
+
+public:
+  struct Parameters {
+    float poolVolume;          // m³
+    float poolArea;            // m², surface
+    float poolLoss;            // W/m²K, convection and evaporation
+    float poolAbsorptance;     // share of the sun on the surface kept
+    float collectorArea;       // m²
+    float collectorEfficiency; // optical
+    float collectorLoss;       // W/m²K
+    float collectorCapacity;   // J/K
+    float pipeCapacity;        // J/K
+    float pipeLoss;            // W/K
+    float solarFlow;           // kg/s through the collector
+    float heaterPower;         // W
+  };
+
+  static Parameters defaults();
+
+  explicit ThermalPlant(const Parameters& parameters = defaults());
+
+  /** All parts at the given temperature. */
+  void reset(float temperature);
+  /** Advances by dt seconds with the given relay states. */
+  void step(float dt, const Weather& weather, bool poolPump, bool solarPump, bool heater);
+
+  float getPoolTemperature() const { return _pool; }
+  float getCollectorTemperature() const { return _collector; }
+  float getPipeTemperature() const { return _pipe; }
+  /** Energy into the pool in kWh since reset, by source. */
+  double getSolarEnergy() const { return _solarEnergy / 3.6e6; }
+  double getHeaterEnergy() const { return _heaterEnergy / 3.6e6; }
+
+private:
+  Parameters _p;
+  float      _pool      = 20.0F;
+  float      _collector = 20.0F;
+  float      _pipe      = 20.0F;
+  double     _solarEnergy  = 0;
+  double     _heaterEnergy = 0;
+};
+
+}  // namespace hal
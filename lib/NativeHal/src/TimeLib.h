@@ -0,0 +1,13 @@
+/**
+ * Native stand-in for the Time library, see Network.cpp.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+typedef time_t (*getExternalTime)();
+
+time_t now();
+void   setTime(time_t t);
+void   setSyncProvider(getExternalTime getTimeFunction);
+void   setSyncInterval(time_t interval);
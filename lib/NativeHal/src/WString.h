@@ -0,0 +1,142 @@
+/**
+ * Native stand-in for the Arduino String class.
+ */
+#pragma once
+
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+public:
+  String(const char* cstr = "") : _s(cstr ? cstr : "") {}
+  String(const __FlashStringHelper* str) : _s(reinterpret_cast<const char*>(str)) {}
+  String(const std::string& s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(unsigned char value, unsigned char base = 10) { fromUnsigned(value, base); }
+  String(int value, unsigned char base = 10) { fromSigned(value, base); }
+  String(unsigned int value, unsigned char base = 10) { fromUnsigned(value, base); }
+  String(long value, unsigned char base = 10) { fromSigned(value, base); }
+  String(unsigned long value, unsigned char base = 10) { fromUnsigned(value, base); }
+  String(float value, unsigned char decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+  String(double value, unsigned char decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+
+  unsigned int length() const { return _s.length(); }
+  const char*  c_str() const { return _s.c_str(); }
+  bool         reserve(unsigned int size) {
+    _s.reserve(size);
+    return true;
+  }
+
+  bool concat(const String& str) {
+    _s += str._s;
+    return true;
+  }
+  bool concat(const char* cstr) {
+    _s += cstr;
+    return true;
+  }
+  bool concat(char c) {
+    _s += c;
+    return true;
+  }
+  bool concat(int num) { return concat(String(num)); }
+  bool concat(unsigned long num) { return concat(String(num)); }
+  bool concat(float num) { return concat(String(num)); }
+
+  String& operator+=(const String& rhs) {
+    concat(rhs);
+    return *this;
+  }
+  String& operator+=(const char* rhs) {
+    concat(rhs);
+    return *this;
+  }
+  String& operator+=(char rhs) {
+    concat(rhs);
+    return *this;
+  }
+
+  friend String operator+(const String& lhs, const String& rhs) { return String(lhs._s + rhs._s); }
+  friend String operator+(const String& lhs, const char* rhs) { return String(lhs._s + rhs); }
+  friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs._s); }
+
+  bool equals(const String& s) const { return _s == s._s; }
+  bool equals(const char* cstr) const { return _s == cstr; }
+  bool equalsIgnoreCase(const String& s) const {
+    if (_s.length() != s._s.length()) return false;
+    for (size_t i = 0; i < _s.length(); i++) {
+      if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i])) return false;
+    }
+    return true;
+  }
+  bool operator==(const String& rhs) const { return equals(rhs); }
+  bool operator==(const char* cstr) const { return equals(cstr); }
+  bool operator!=(const String& rhs) const { return !equals(rhs); }
+  bool operator!=(const char* cstr) const { return !equals(cstr); }
+  bool operator<(const String& rhs) const { return _s < rhs._s; }
+
+  char operator[](unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const {
+    size_t p = _s.find(ch, fromIndex);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  int indexOf(const String& str, unsigned int fromIndex = 0) const {
+    size_t p = _s.find(str._s, fromIndex);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  bool   startsWith(const String& prefix) const { return _s.compare(0, prefix._s.length(), prefix._s) == 0; }
+  bool   endsWith(const String& suffix) const {
+    return _s.length() >= suffix._s.length() && _s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0;
+  }
+  String substring(unsigned int beginIndex) const { return beginIndex < _s.length() ? String(_s.substr(beginIndex)) : String(); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex >= _s.length() || endIndex <= beginIndex) return String();
+    return String(_s.substr(beginIndex, endIndex - beginIndex));
+  }
+  void trim() {
+    size_t b = _s.find_first_not_of(" \t\r\n");
+    size_t e = _s.find_last_not_of(" \t\r\n");
+    _s       = (b == std::string::npos) ? std::string() : _s.substr(b, e - b + 1);
+  }
+  void toLowerCase() {
+    for (auto& c : _s) c = (char)tolower((unsigned char)c);
+  }
+  void toUpperCase() {
+    for (auto& c : _s) c = (char)toupper((unsigned char)c);
+  }
+
+  long   toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+  float  toFloat() const { return (float)strtod(_s.c_str(), nullptr); }
+  double toDouble() const { return strtod(_s.c_str(), nullptr); }
+
+private:
+  std::string _s;
+
+  void fromUnsigned(unsigned long value, unsigned char base) {
+    char buf[8 * sizeof(long) + 1];
+    char* p = buf + sizeof(buf) - 1;
+    *p      = '\0';
+    do {
+      unsigned digit = value % base;
+      *--p           = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+      value /= base;
+    } while (value);
+    _s = p;
+  }
+  void fromSigned(long value, unsigned char base) {
+    if (value < 0 && base == 10) {
+      fromUnsigned((unsigned long)(-value), base);
+      _s.insert(0, 1, '-');
+    } else {
+      fromUnsigned((unsigned long)value, base);
+    }
+  }
+  void fromDouble(double value, unsigned char decimalPlaces) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+    _s = buf;
+  }
+};
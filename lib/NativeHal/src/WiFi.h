@@ -0,0 +1,6 @@
+/**
+ * Native stand-in for the ESP32 WiFi header.
+ */
+#pragma once
+
+#include "ESP8266WiFi.h"
@@ -0,0 +1,29 @@
+/**
+ * Native stand-in for the UDP socket, see Network.cpp.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  IPAddress(uint32_t address = 0) : _address(address) {}
+  operator uint32_t() const { return _address; }
+
+private:
+  uint32_t _address;
+};
+
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t port);
+  void    stop();
+  int     beginPacket(const char* host, uint16_t port);
+  int     beginPacket(IPAddress ip, uint16_t port);
+  size_t  write(const uint8_t* buffer, size_t size);
+  int     endPacket();
+  int     parsePacket();
+  int     read(uint8_t* buffer, size_t len);
+  int     available();
+  void    flush() {}
+};
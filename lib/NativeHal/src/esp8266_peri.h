@@ -0,0 +1,25 @@
+/**
+ * Native stand-in for the ESP8266 GPIO set/clear registers.
+ */
+#pragma once
+
+#include <NativeHal.hpp>
+
+class GpioMaskRegister {
+public:
+  explicit GpioMaskRegister(bool set) : _set(set) {}
+  GpioMaskRegister& operator=(uint32_t mask) {
+    if (_set) {
+      hal::writeOutputMask(mask, 0);
+    } else {
+      hal::writeOutputMask(0, mask);
+    }
+    return *this;
+  }
+
+private:
+  bool _set;
+};
+
+extern GpioMaskRegister GPOS;
+extern GpioMaskRegister GPOC;
@@ -0,0 +1,23 @@
+/**
+ * Native stand-in for the lwIP resolver, IPv4 only. Every name resolves to
+ * the host right away, like a hit in the resolver's cache.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+enum { ERR_OK = 0, ERR_INPROGRESS = -5, ERR_ARG = -16 };
+
+struct ip4_addr_t {
+  uint32_t addr;
+};
+typedef ip4_addr_t ip_addr_t;
+
+#define ip_2_ip4(ipaddr)      (ipaddr)
+#define ip4_addr_get_u32(src) ((src)->addr)
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
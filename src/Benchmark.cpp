@@ -0,0 +1,151 @@
+/**
+ * Microbenchmarks of the control hot paths.
+ */
+
+#include "Benchmark.hpp"
+
+#ifdef BENCHMARK
+
+#include "HeapTracker.hpp"
+#include "RuleAuto.hpp"
+#include "RuleTimer.hpp"
+#include "TimeClientHelper.hpp"
+
+const char* Benchmarks::_firmwareVersion = "";
+
+static const char* const cLevels[] = {"DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL"};
+static const char* const cModes[]  = {"manu", "auto", "boost", "timer"};
+
+static const HomieRange cNoRange = {false, 0};
+
+/**
+ * Runs all benchmarks, which takes about a second per benchmark.
+ */
+void Benchmarks::run(Print& out, const char* firmwareVersion, const Fixture& fixture) {
+  _firmwareVersion = firmwareVersion;
+
+  const String mode    = fixture.mode->getMode();
+  const float  poolMax = fixture.mode->getPoolMaxTemperature();
+
+  boolean relayStates[RelayStateStore::MAX_RELAYS];
+  saveRelays(relayStates);
+  RelayModuleNode::_outputBlocked = true;
+
+  // the rule of each mode through the node, as the node's measure() does
+  for (const char* name : cModes) {
+    fixture.mode->setMode(name);
+    if (fixture.mode->getRule() == NULL) continue;  // before Homie's setup handler added the rules
+
+    char benchmark[16];
+    snprintf(benchmark, sizeof(benchmark), "rule-%s", name);
+    measure(out, benchmark, [](const Fixture& f) { f.mode->getRule()->loop(); }, fixture);
+
+    if (strcmp(name, "auto") == 0) {
+      measure(out, "pool-timer-auto", [](const Fixture& f) { static_cast<RuleAuto*>(f.mode->getRule())->checkPoolPumpTimer(); }, fixture);
+    } else if (strcmp(name, "timer") == 0) {
+      measure(out, "pool-timer-timer", [](const Fixture& f) { static_cast<RuleTimer*>(f.mode->getRule())->checkPoolPumpTimer(); }, fixture);
+    }
+    restoreRelays(relayStates);  // each rule starts from the same states
+  }
+  fixture.mode->setMode(mode);
+
+  measure(out, "node-message-state", [](const Fixture& f) { f.temperature->prepareNodeMessage(0, "OK", 0.0F); }, fixture);
+  measure(out, "node-message-temperature", [](const Fixture& f) { f.temperature->prepareNodeMessage(0, NULL, 72.5F); }, fixture);
+
+  measure(out, "logger-log", [](const Fixture& f) { f.logger->log(__PRETTY_FUNCTION__, LoggerNode::INFO, "benchmark"); }, fixture);
+
+  // the parsers with the values in effect, so nothing changes
+  measure(out, "input-mode", [](const Fixture& f) { f.mode->handleInput(cNoRange, "mode", f.mode->getMode()); }, fixture);
+  measure(out, "input-pool-max-temp", [](const Fixture& f) {
+    f.mode->handleInput(cNoRange, "pool-max-temp", String(f.mode->getPoolMaxTemperature()));
+  }, fixture);
+  measure(out, "input-switch", [](const Fixture& f) { f.relay->handleInput(cNoRange, "switch", f.relay->getSwitch() ? "true" : "false"); }, fixture);
+  measure(out, "input-log-level", [](const Fixture& f) { f.logger->handleInput(cNoRange, "Level", cLevels[LoggerNode::getLoglevel()]); }, fixture);
+  fixture.mode->setPoolMaxTemperatur(poolMax);
+
+  measure(out, "formatted-time", [](const Fixture& f) { getFormattedTime(getLocalEpoch()); }, fixture);
+
+  restoreRelays(relayStates);
+  RelayModuleNode::_outputBlocked = false;
+}
+
+/**
+ *
+ */
+void Benchmarks::saveRelays(boolean* states) {
+  for (uint8_t i = 0; i < RelayModuleNode::_relayCount; i++) {
+    states[i] = RelayModuleNode::_relays[i]->getSwitch();
+  }
+}
+
+/**
+ * Puts back the states, the pins and the store never left them.
+ */
+void Benchmarks::restoreRelays(const boolean* states) {
+  for (uint8_t i = 0; i < RelayModuleNode::_relayCount; i++) {
+    RelayModuleNode::_relays[i]->_state = states[i];
+  }
+}
+
+/**
+ * Doubles the batch until it takes a quarter of BATCH_MICROS, then runs
+ * BATCHES batches of four times that size.
+ */
+void Benchmarks::measure(Print& out, const char* name, Function function, const Fixture& fixture) {
+  function(fixture);  // warm up: first time allocations, caches
+
+  uint32_t batch = 1;
+  for (;;) {
+    const uint32_t start = micros();
+    for (uint32_t i = 0; i < batch; i++) function(fixture);
+    if (micros() - start >= BATCH_MICROS / 4 || batch >= 0x100000) break;
+    batch *= 2;
+    yield();
+  }
+  batch *= 4;
+
+  uint32_t allocations, bytes;
+  readAllocations(allocations, bytes);
+
+  uint64_t total = 0;
+  uint32_t best  = UINT32_MAX;
+  for (uint8_t b = 0; b < BATCHES; b++) {
+    const uint32_t start = micros();
+    for (uint32_t i = 0; i < batch; i++) function(fixture);
+    const uint32_t elapsed = micros() - start;
+
+    total += elapsed;
+    best = min(best, elapsed);
+    yield();  // the watchdog
+  }
+
+  uint32_t allocationsAfter, bytesAfter;
+  readAllocations(allocationsAfter, bytesAfter);
+
+  const uint32_t calls = batch * BATCHES;
+  char           line[256];
+  int            length = snprintf(line, sizeof(line), "{\"benchmark\":\"%s\",\"firmware\":\"%s\",\"calls\":%u,\"nsPerCall\":%u,\"minNsPerCall\":%u,",
+                                   name, _firmwareVersion, calls, (uint32_t)(total * 1000 / calls), (uint32_t)(best * 1000ULL / batch));
+#ifdef HEAP_TRACKING
+  snprintf(line + length, sizeof(line) - length, "\"allocsPerCall\":%.2f,\"bytesPerCall\":%.1f}", (float)(allocationsAfter - allocations) / calls,
+           (float)(bytesAfter - bytes) / calls);
+#else
+  snprintf(line + length, sizeof(line) - length, "\"allocsPerCall\":null,\"bytesPerCall\":null}");
+#endif
+  out.println(line);
+}
+
+/**
+ *
+ */
+void Benchmarks::readAllocations(uint32_t& count, uint32_t& bytes) {
+#ifdef HEAP_TRACKING
+  count = HeapTracker::getAllocations();
+  bytes = HeapTracker::getBytes();
+#else
+  count = 0;
+  bytes = 0;
+#endif
+}
+
+#endif
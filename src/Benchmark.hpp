@@ -0,0 +1,57 @@
+/**
+ * Microbenchmarks of the control hot paths, enabled by the build flag BENCHMARK.
+ *
+ * run() calls each path in batches of a calibrated size and prints one JSON
+ * line per benchmark:
+ *
+ *   {"benchmark":"rule-auto","firmware":"2.0.0","calls":5120,"nsPerCall":8731,"minNsPerCall":8650,
+ *    "allocsPerCall":3.00,"bytesPerCall":61.0}
+ *
+ * nsPerCall is the mean over all batches, minNsPerCall the fastest batch.
+ * The allocations are counted with HEAP_TRACKING and are null without it.
+ * The paths run on the nodes of the firmware with their current settings,
+ * the changed settings are restored. The relay output is blocked for the
+ * whole run: setSwitch() changes only the state the rules see, no pin,
+ * flash store, trace or MQTT message, and the states are put back after
+ * each rule. The DEBUG log output of the paths is part of their cost, as in
+ * the firmware.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef BENCHMARK
+
+#include "DallasTemperatureNode.hpp"
+#include "LoggerNode.hpp"
+#include "OperationModeNode.hpp"
+#include "RelayModuleNode.hpp"
+
+class Benchmarks {
+
+public:
+  struct Fixture {
+    OperationModeNode*     mode;
+    RelayModuleNode*       relay;
+    DallasTemperatureNode* temperature;
+    LoggerNode*            logger;
+  };
+
+  static const uint8_t  BATCHES      = 5;
+  static const uint32_t BATCH_MICROS = 40000;
+
+  static void run(Print& out, const char* firmwareVersion, const Fixture& fixture);
+
+private:
+  typedef void (*Function)(const Fixture& fixture);
+
+  static void measure(Print& out, const char* name, Function function, const Fixture& fixture);
+  static void saveRelays(boolean* states);
+  static void restoreRelays(const boolean* states);
+  static void readAllocations(uint32_t& count, uint32_t& bytes);
+
+  static const char* _firmwareVersion;
+};
+
+#endif
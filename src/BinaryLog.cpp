@@ -0,0 +1,182 @@
+/**
+ * Deferred-format binary log.
+ */
+
+#include "BinaryLog.hpp"
+#include "CrashLog.hpp"
+
+BinaryLog binaryLog;
+
+#define LOG_FORMAT(id, format) static const char cFormat_##id[] PROGMEM = format;
+#include "LogFormats.def"
+#undef LOG_FORMAT
+
+#define LOG_FORMAT(id, format) static const char cName_##id[] PROGMEM = #id;
+#include "LogFormats.def"
+#undef LOG_FORMAT
+
+static const char* const cFormats[] PROGMEM = {
+#define LOG_FORMAT(id, format) cFormat_##id,
+#include "LogFormats.def"
+#undef LOG_FORMAT
+};
+
+static const char* const cNames[] PROGMEM = {
+#define LOG_FORMAT(id, format) cName_##id,
+#include "LogFormats.def"
+#undef LOG_FORMAT
+};
+
+/**
+ * Appends a record, the oldest records are dropped (and counted) to make room.
+ * Records from INFO up are also kept in the crash log.
+ */
+void BinaryLog::write(uint8_t level, uint16_t id, const uint32_t* args, uint8_t argc) {
+  const uint32_t words      = 2 + argc;
+  const uint32_t time       = millis();
+  const uint32_t descriptor = id | ((uint32_t)level << 16) | ((uint32_t)argc << 24);
+
+  if (level >= CrashLog::MIN_LEVEL) {
+    crashLog.record(time, descriptor, args, argc);
+  }
+
+  while (RING_WORDS - (_head - _tail) < words) {
+    const uint8_t oldArgc = _ring[(_tail + 1) % RING_WORDS] >> 24;
+    _tail += 2 + oldArgc;
+    _dropped++;
+  }
+
+  _ring[_head++ % RING_WORDS] = time;
+  _ring[_head++ % RING_WORDS] = descriptor;
+  for (uint8_t i = 0; i < argc; i++) {
+    _ring[_head++ % RING_WORDS] = args[i];
+  }
+}
+
+/**
+ * Takes the oldest record out of the ring.
+ */
+bool BinaryLog::read(Record& record) {
+  if (isEmpty()) {
+    return false;
+  }
+
+  record.time               = _ring[_tail++ % RING_WORDS];
+  const uint32_t descriptor = _ring[_tail++ % RING_WORDS];
+  record.id                 = descriptor & 0xFFFF;
+  record.level              = (descriptor >> 16) & 0xFF;
+  record.argc               = descriptor >> 24;
+  for (uint8_t i = 0; i < record.argc; i++) {
+    record.args[i] = _ring[_tail++ % RING_WORDS];
+  }
+
+  return true;
+}
+
+/**
+ * Formats a record with its table entry. Supports the conversions listed in
+ * LogFormats.def, length modifiers are accepted and ignored.
+ */
+size_t BinaryLog::format(char* buffer, size_t size, const Record& record) {
+  char fmt[96];
+  if (record.id >= LogFormat::COUNT) {
+    return snprintf(buffer, size, "unknown log format %u", record.id);
+  }
+  strncpy_P(fmt, (const char*)pgm_read_ptr(&cFormats[record.id]), sizeof(fmt) - 1);
+  fmt[sizeof(fmt) - 1] = '\0';
+
+  size_t      pos = 0;
+  uint8_t     arg = 0;
+  const char* p   = fmt;
+
+  while (*p && pos + 1 < size) {
+    if (*p != '%') {
+      buffer[pos++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      buffer[pos++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // copy flags, width and precision, drop length modifiers
+    char   spec[16];
+    size_t len    = 0;
+    spec[len++]   = *p++;
+    while (*p && strchr("-+ #0123456789.", *p) && len < sizeof(spec) - 3) spec[len++] = *p++;
+    while (*p && strchr("hlzjt", *p)) p++;
+    const char conversion = *p ? *p++ : 'd';
+
+    const uint32_t value = (arg < record.argc) ? record.args[arg] : 0;
+    const bool     known = arg++ < record.argc;
+    int            written;
+
+    if (!known) {
+      written = snprintf(buffer + pos, size - pos, "?");
+    } else if (strchr("feEgG", conversion)) {
+      float f;
+      memcpy(&f, &value, sizeof(f));
+      spec[len++] = conversion;
+      spec[len]   = '\0';
+      written     = snprintf(buffer + pos, size - pos, spec, (double)f);
+    } else if (conversion == 'd' || conversion == 'i') {
+      spec[len++] = 'l';
+      spec[len++] = 'd';
+      spec[len]   = '\0';
+      written     = snprintf(buffer + pos, size - pos, spec, (long)(int32_t)value);
+    } else if (conversion == 'c') {
+      spec[len++] = 'c';
+      spec[len]   = '\0';
+      written     = snprintf(buffer + pos, size - pos, spec, (int)value);
+    } else {
+      spec[len++] = 'l';
+      spec[len++] = strchr("xXo", conversion) ? conversion : 'u';
+      spec[len]   = '\0';
+      written     = snprintf(buffer + pos, size - pos, spec, (unsigned long)value);
+    }
+
+    if (written > 0) {
+      pos += ((size_t)written < size - pos) ? (size_t)written : size - pos - 1;
+    }
+  }
+
+  buffer[pos] = '\0';
+  return pos;
+}
+
+/**
+ * Writes the wire format of a record as hex, for tools/logdecode.py.
+ */
+size_t BinaryLog::toHex(char* buffer, size_t size, const Record& record) {
+  static const char cDigits[] = "0123456789abcdef";
+
+  uint32_t words[2 + MAX_ARGS];
+  words[0] = record.time;
+  words[1] = record.id | ((uint32_t)record.level << 16) | ((uint32_t)record.argc << 24);
+  memcpy(&words[2], record.args, record.argc * sizeof(uint32_t));
+
+  size_t pos = 0;
+  for (uint8_t w = 0; w < 2 + record.argc; w++) {
+    for (uint8_t b = 0; b < 4 && pos + 2 < size; b++) {
+      const uint8_t byte = (words[w] >> (8 * b)) & 0xFF;
+      buffer[pos++]      = cDigits[byte >> 4];
+      buffer[pos++]      = cDigits[byte & 0x0F];
+    }
+  }
+
+  buffer[pos] = '\0';
+  return pos;
+}
+
+/**
+ *
+ */
+void BinaryLog::getName(uint16_t id, char* buffer, size_t size) {
+  if (id >= LogFormat::COUNT) {
+    snprintf(buffer, size, "LOG_%u", id);
+    return;
+  }
+  strncpy_P(buffer, (const char*)pgm_read_ptr(&cNames[id]), size - 1);
+  buffer[size - 1] = '\0';
+}
@@ -0,0 +1,80 @@
+/**
+ * Deferred-format binary log.
+ *
+ * A call site stores only the time, level, format id and the raw 32 bit
+ * arguments into a word ring; no formatting, no strings. The text is made
+ * later from the format table (LogFormats.def): by format() on the device
+ * when draining, or by tools/logdecode.py from the hex wire format.
+ *
+ *   LOGB_DEBUG(DALLAS_TEMPERATURE, _temperature, _pin, i);
+ *
+ * Wire format, little endian 32 bit words:
+ *   time [ms] | id (16) level (8) argc (8) | argc arguments
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace LogFormat {
+
+enum Id : uint16_t {
+#define LOG_FORMAT(id, format) id,
+#include "LogFormats.def"
+#undef LOG_FORMAT
+  COUNT
+};
+
+}  // namespace LogFormat
+
+class BinaryLog {
+
+public:
+  static const uint8_t MAX_ARGS   = 6;
+  static const size_t  RING_WORDS = 128;  // power of two
+
+  struct Record {
+    uint32_t time;
+    uint16_t id;
+    uint8_t  level;
+    uint8_t  argc;
+    uint32_t args[MAX_ARGS];
+  };
+
+  template <typename... Args>
+  void record(const uint8_t level, const uint16_t id, const Args... args) {
+    static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+    const uint32_t values[sizeof...(Args) + 1] = {pack(args)..., 0};
+    write(level, id, values, sizeof...(Args));
+  }
+
+  bool     read(Record& record);
+  bool     isEmpty() const { return _head == _tail; }
+  uint32_t getDropped() const { return _dropped; }
+
+  static size_t format(char* buffer, size_t size, const Record& record);
+  static size_t toHex(char* buffer, size_t size, const Record& record);
+  static void   getName(uint16_t id, char* buffer, size_t size);
+
+private:
+  uint32_t _ring[RING_WORDS];
+  // running word counters, the ring index is counter % RING_WORDS
+  uint32_t _head    = 0;
+  uint32_t _tail    = 0;
+  uint32_t _dropped = 0;
+
+  void write(uint8_t level, uint16_t id, const uint32_t* args, uint8_t argc);
+
+  template <typename T>
+  static uint32_t pack(const T value) {
+    return (uint32_t)value;
+  }
+  static uint32_t pack(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+  static uint32_t pack(const double value) { return pack((float)value); }
+};
+
+extern BinaryLog binaryLog;
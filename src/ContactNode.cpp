@@ -7,6 +7,8 @@
  */
 
 #include "ContactNode.hpp"
+#include "Log.hpp"
+#include "PublishQueue.hpp"
 
 ContactNode::ContactNode(const char *id,
                          const char *name,
@@ -44,7 +46,7 @@ bool ContactNode::debouncePin(void)
     _stateChangeHandled = false;
     _lastInputState = inputState;
 #ifdef DEBUG
-    Homie.getLogger() << "State Changed to " << inputState << endl;
+    LOG_INFO << "State Changed to " << inputState << endl;
 #endif
   }
   else
@@ -53,7 +55,7 @@ bool ContactNode::debouncePin(void)
     if (dt >= DEBOUNCE_TIME && !_stateChangeHandled)
     {
 #ifdef DEBUG
-      Homie.getLogger() << "State Stable for " << dt << "ms" << endl;
+      LOGB_DEBUG(CONTACT_STABLE, _contactPin, dt);
 #endif
       _stateChangeHandled = true;
       return true;
@@ -64,17 +66,14 @@ bool ContactNode::debouncePin(void)
 
 void ContactNode::handleStateChange(bool open)
 {
-  if (Homie.isConnected())
-  {
-    setProperty("open").send(open ? "true" : "false");
-  }
+  publishQueue.send(*this, "open", open ? "true" : "false", PublishQueue::SENSOR);
   if (_contactCallback)
   {
     _contactCallback(open);
   }
 
   printCaption();
-  Homie.getLogger() << cIndent << "is " << (open ? "open" : "closed") << endl;
+  LOG_DEBUG << cIndent << "is " << (open ? "open" : "closed") << endl;
 }
 
 void ContactNode::onChange(TContactCallback contactCallback)
@@ -82,20 +81,25 @@ void ContactNode::onChange(TContactCallback contactCallback)
   _contactCallback = contactCallback;
 }
 
-void ContactNode::loop()
+void ContactNode::setMeasurementInterval(unsigned long interval)
+{
+  _measurementInterval = interval;
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
+}
+
+// Called by the scheduler every measurement interval, also while Homie is disconnected.
+void ContactNode::measure()
 {
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-    _lastMeasurement = millis();
-    if (_contactPin > DEFAULTPIN)
+  PROFILE_SCOPE(_measureStats);
+  if (_contactPin > DEFAULTPIN)
+  {
+    if (debouncePin() && (_lastSentState != _lastInputState))
     {
-      if (debouncePin() && (_lastSentState != _lastInputState))
-      {
-        handleStateChange(_lastInputState == HIGH);
-        _lastSentState = _lastInputState;
-      }
+      handleStateChange(_lastInputState == HIGH);
+      _lastSentState = _lastInputState;
     }
-    Homie.getLogger() << F("〽 Contact Status: ") << getId() << F(" switch: ") << (_lastSentState ? "open" : "closed") << endl;
   }
+  LOG_DEBUG << F("〽 Contact Status: ") << getId() << F(" switch: ") << (_lastSentState ? "open" : "closed") << endl;
 }
 
 void ContactNode::setupPin()
@@ -113,4 +117,7 @@ void ContactNode::setup()
   {
     setupPin();
   }
+
+  _measureTask.setRunDisconnected(true);  // changes go into the history while offline
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
 }
@@ -10,6 +10,8 @@
 
 #include <Homie.hpp>
 #include "SensorNode.hpp"
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
 
 #define DEFAULTPIN -1
 #define DEBOUNCE_TIME 200
@@ -20,7 +22,7 @@ public:
   typedef std::function<void(bool)> TContactCallback;
   ContactNode(const char *id, const char *name, const int contactPin = DEFAULTPIN, TContactCallback contactCallback = NULL, const unsigned long measurementInterval = MEASUREMENT_INTERVAL);
   void onChange(TContactCallback contactCallback);
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
 
 private:
@@ -28,7 +30,6 @@ private:
 //  const unsigned long MIN_INTERVAL         = 60;  // in seconds
   static const unsigned long MEASUREMENT_INTERVAL = 300;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
   int _contactPin;
   TContactCallback _contactCallback;
 
@@ -38,14 +39,20 @@ private:
   bool _stateChangeHandled = false;
   unsigned long _stateChangedTime = 0;
 
+  Scheduler::Task _measureTask{getId(), [](void *node) { static_cast<ContactNode *>(node)->measure(); }, this};
+
+  void measure();
   bool debouncePin(void);
   void handleStateChange(bool open);
 
 protected:
   int getContactPin();
-  virtual void loop() override;
   virtual void setup() override;
   virtual void setupPin();
   virtual byte readPin();
 
+
+#ifdef LOOP_PROFILING
+  LoopStats _measureStats{getId(), "measure"};
+#endif
 };
@@ -0,0 +1,144 @@
+/**
+ * Diagnostic ring that survives resets.
+ */
+
+#include "CrashLog.hpp"
+#include "BinaryLog.hpp"
+#include "Crc32.hpp"
+
+CrashLog crashLog;
+
+#ifdef ESP32
+// survives software and watchdog resets, garbage after power on (caught by the checks)
+RTC_NOINIT_ATTR static uint32_t rtcWords[CrashLog::WORDS];
+#endif
+
+static const char* const cPhaseNames[CrashLog::PHASE_COUNT] = {"boot", "time-client", "homie", "relays", "log", "scheduler", "publish"};
+
+/**
+ * Takes over the records of the previous boot and starts an empty ring.
+ */
+void CrashLog::begin() {
+  uint32_t header[HEADER_WORDS];
+  readWords(0, header, HEADER_WORDS);
+
+  _reportCount = 0;
+  _reportPhase = PHASE_COUNT;
+
+  if (header[0] == MAGIC) {
+    if (isChecked(header[2]) && (header[2] & 0xFFFF) < PHASE_COUNT) {
+      _reportPhase = header[2] & 0xFFFF;
+    }
+
+    const uint32_t position = header[1] & 0xFFFF;
+    const uint32_t next     = position & ~RING_FULL;
+    if (isChecked(header[1]) && next < SLOTS) {
+      // a full ring starts at the next slot, the oldest record
+      const uint32_t count = (position & RING_FULL) ? SLOTS : next;
+      const uint32_t first = (position & RING_FULL) ? next : 0;
+
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t* slot = _report[_reportCount];
+        readWords(HEADER_WORDS + ((first + i) % SLOTS) * SLOT_WORDS, slot, SLOT_WORDS);
+
+        if (slot[SLOT_WORDS - 1] == Crc32::compute(reinterpret_cast<const uint8_t*>(slot), (SLOT_WORDS - 1) * sizeof(uint32_t))) {
+          _reportCount++;
+        }
+      }
+    }
+  }
+
+  _head = 0;
+  header[0] = MAGIC;
+  header[1] = check(0);
+  header[2] = check(PHASE_BOOT);
+  writeWords(0, header, HEADER_WORDS);
+}
+
+/**
+ * Writes a binary log record through to RTC memory.
+ */
+void CrashLog::record(uint32_t time, uint32_t descriptor, const uint32_t* args, uint8_t argc) {
+  uint32_t slot[SLOT_WORDS];
+
+  if (argc > SLOT_ARGS) argc = SLOT_ARGS;
+  slot[0] = time;
+  slot[1] = (descriptor & 0x00FFFFFF) | ((uint32_t)argc << 24);
+  for (uint8_t i = 0; i < SLOT_ARGS; i++) {
+    slot[2 + i] = (i < argc) ? args[i] : 0;
+  }
+  slot[SLOT_WORDS - 1] = Crc32::compute(reinterpret_cast<const uint8_t*>(slot), (SLOT_WORDS - 1) * sizeof(uint32_t));
+
+  writeWords(HEADER_WORDS + (_head % SLOTS) * SLOT_WORDS, slot, SLOT_WORDS);
+  _head++;
+
+  // the 16 bits of a checked word don't hold the count, only the ring position
+  const uint32_t position = check((_head % SLOTS) | (_head >= SLOTS ? RING_FULL : 0));
+  writeWords(1, &position, 1);
+}
+
+/**
+ * Marks the part of the main loop running now.
+ */
+void CrashLog::setPhase(Phase phase) {
+  const uint32_t word = check(phase);
+  writeWords(2, &word, 1);
+}
+
+/**
+ *
+ */
+const char* CrashLog::getReportPhase() const {
+  return (_reportPhase < PHASE_COUNT) ? cPhaseNames[_reportPhase] : "unknown";
+}
+
+/**
+ * Writes the records of the previous boot in the wire format of BinaryLog.
+ */
+size_t CrashLog::reportToHex(char* buffer, size_t size) const {
+  size_t pos = 0;
+  buffer[0]  = '\0';
+
+  for (uint8_t i = 0; i < _reportCount; i++) {
+    BinaryLog::Record record;
+    record.time  = _report[i][0];
+    record.id    = _report[i][1] & 0xFFFF;
+    record.level = (_report[i][1] >> 16) & 0xFF;
+    record.argc  = _report[i][1] >> 24;
+    memcpy(record.args, &_report[i][2], record.argc * sizeof(uint32_t));
+
+    pos += BinaryLog::toHex(buffer + pos, size - pos, record);
+  }
+
+  return pos;
+}
+
+/**
+ *
+ */
+void CrashLog::clearReport() {
+  _reportCount = 0;
+  _reportPhase = PHASE_COUNT;
+}
+
+/**
+ *
+ */
+void CrashLog::readWords(uint32_t offset, uint32_t* data, size_t count) {
+#ifdef ESP32
+  memcpy(data, &rtcWords[offset], count * sizeof(uint32_t));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryRead(RTC_OFFSET + offset, data, count * sizeof(uint32_t));
+#endif
+}
+
+/**
+ *
+ */
+void CrashLog::writeWords(uint32_t offset, const uint32_t* data, size_t count) {
+#ifdef ESP32
+  memcpy(&rtcWords[offset], data, count * sizeof(uint32_t));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryWrite(RTC_OFFSET + offset, const_cast<uint32_t*>(data), count * sizeof(uint32_t));
+#endif
+}
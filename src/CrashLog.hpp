@@ -0,0 +1,68 @@
+/**
+ * Diagnostic ring that survives resets.
+ *
+ * The last SLOTS binary log records (INFO and up) and the current main loop
+ * phase are written through to RTC memory as they happen, each record with
+ * its own CRC. On the next boot begin() takes them over, so after a
+ * watchdog reset or an exception the Log node can publish what the
+ * controller did last and in which phase of the loop it stopped.
+ *
+ * A record costs one RTC memory write of 6 words, a phase marker one word.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#ifdef ESP32
+#include <esp_attr.h>
+#endif
+
+class CrashLog {
+
+public:
+  static const uint8_t SLOTS     = 14;
+  static const uint8_t SLOT_ARGS = 3;  // further arguments are not kept
+  static const uint8_t MIN_LEVEL = 1;  // LoggerNode::INFO
+
+  static const uint8_t SLOT_WORDS   = 3 + SLOT_ARGS;  // time, descriptor, args, crc
+  static const uint8_t HEADER_WORDS = 3;              // magic, ring position, phase
+  static const uint8_t WORDS        = HEADER_WORDS + SLOTS * SLOT_WORDS;
+
+  enum Phase : uint8_t { PHASE_BOOT, PHASE_TIME_CLIENT, PHASE_HOMIE, PHASE_RELAYS, PHASE_LOG, PHASE_SCHEDULER, PHASE_PUBLISH, PHASE_COUNT };
+
+  void begin();
+  void record(uint32_t time, uint32_t descriptor, const uint32_t* args, uint8_t argc);
+  void setPhase(Phase phase);
+
+  // previous boot, valid after begin()
+  bool        hasReport() const { return _reportCount > 0 || _reportPhase < PHASE_COUNT; }
+  uint8_t     getReportCount() const { return _reportCount; }
+  const char* getReportPhase() const;
+  size_t      reportToHex(char* buffer, size_t size) const;
+  void        clearReport();
+
+private:
+  static const uint32_t MAGIC = 0x43524C47;  // "CRLG"
+  // in 4-byte blocks, behind the relay states of RelayStateStore (32..35)
+  static const uint32_t RTC_OFFSET = 36;
+#ifdef ESP8266
+  static_assert(RTC_OFFSET + WORDS <= 128, "crash log exceeds the 512 bytes of RTC user memory");
+#endif
+
+  static const uint32_t RING_FULL = 0x100;  // in the ring position word, with the next slot below
+
+  uint32_t _head = 0;  // records written in this boot
+
+  // report of the previous boot, oldest first
+  uint32_t _report[SLOTS][SLOT_WORDS];
+  uint8_t  _reportCount = 0;
+  uint8_t  _reportPhase = PHASE_COUNT;
+
+  static uint32_t check(uint32_t value) { return (value & 0xFFFF) | (~value << 16); }
+  static bool     isChecked(uint32_t word) { return (word >> 16) == (~word & 0xFFFF); }
+
+  void readWords(uint32_t offset, uint32_t* data, size_t count);
+  void writeWords(uint32_t offset, const uint32_t* data, size_t count);
+};
+
+extern CrashLog crashLog;
@@ -0,0 +1,29 @@
+/**
+ * CRC-32 (IEEE 802.3), bitwise: the records checked with it are a few bytes only.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace Crc32 {
+
+/**
+ * Continues the CRC of the data before, 0 to start.
+ */
+inline uint32_t update(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+  while (length--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+inline uint32_t compute(const uint8_t* data, size_t length) {
+  return update(0, data, length);
+}
+
+}  // namespace Crc32
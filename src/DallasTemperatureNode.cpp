@@ -17,6 +17,9 @@
  *
  */
 #include "DallasTemperatureNode.hpp"
+#include "Log.hpp"
+#include "PublishQueue.hpp"
+#include "TraceRecorder.hpp"
 
 DallasTemperatureNode::DallasTemperatureNode(pDallasProperties request, const char* id, const char* name, const char* nType,
                                              const uint8_t pin, const int measurementInterval)
@@ -33,9 +36,14 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
     : HomieNode(id, name, nType, range, lower, upper) {
   _pin                 = pin;
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = 0;
+  _taskInterval        = _measurementInterval;
+  _nodeRuns            = UINT16_MAX - 1;
   _rangeCount          = 1 + (upper - lower);
 
+  for (uint8_t i = 0; i < DALLAS_MAX_ENTRIES; i++) {
+    _schedules[i] = {0, 0, NULL, UINT16_MAX - 1};
+  }
+
   oneWire = new OneWire(_pin);
   sensor  = new DallasTemperature(oneWire);
 
@@ -51,6 +59,7 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
   */
   void DallasTemperatureNode::setup() {
       initializeSensors();
+    _measureTask.setRunDisconnected(true);  // readings go into the history while offline
   
     if(isRange()) {
       advertise(cHomieNodeState).setName(cHomieNodeStateName).setDatatype(cHomieNodeStateType).setFormat(cHomieNodeStateFormat);
@@ -72,6 +81,8 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
       advertise(cHomieNodeState).setName(cHomieNodeStateName).setDatatype(cHomieNodeStateType).setFormat(cHomieNodeStateFormat);
       advertise(cTemperature).setName(cTemperatureName).setDatatype("string");
     }
+
+    reschedule();
 }
 
 /**
@@ -98,15 +109,15 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
     }
 
     // report parasite power requirements
-    Homie.getLogger() << cIndent 
-                      << F("Parasite power is: ") << sensor->isParasitePowerMode() 
-                      << endl;
+    LOG_DEBUG << cIndent 
+              << F("Parasite power is: ") << sensor->isParasitePowerMode() 
+              << endl;
 
     if (numberOfDevices > 0) {
-      Homie.getLogger() << cIndent 
-                        << numberOfDevices 
-                        << F(" devices found on PIN ") << _pin 
-                        << endl;
+      LOG_INFO << cIndent 
+               << numberOfDevices 
+               << F(" devices found on PIN ") << _pin 
+               << endl;
       
       for (uint8_t i = 0; i < numberOfDevices; i++) {
         // Load the address list sequence
@@ -120,149 +131,275 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
           HomieInternals::Helpers::hexStringToByteArray(requestedProperties->entries[i].deviceAddressStr, requestedProperties->entries[i].deviceAddress, sizeof(DeviceAddress));
           HomieInternals::Helpers::hexStringToByteArray(requestedProperties->entries[i].deviceAddressStr, deviceAddress[i], sizeof(DeviceAddress));
 
-          Homie.getLogger() << cIndent 
-                          << F("PIN ") << _pin << F(": ") 
-                          << F("Device ") << i 
-                          << F(" using address ") << requestedProperties->entries[i].deviceAddressStr
-                          << ", Property Name: " << requestedProperties->entries[i].property
-                          << ", PropertyState Name: " << requestedProperties->entries[i].propertyState
-                          << endl;
+          LOG_INFO << cIndent 
+                 << F("PIN ") << _pin << F(": ") 
+                 << F("Device ") << i 
+                 << F(" using address ") << requestedProperties->entries[i].deviceAddressStr
+                 << ", Property Name: " << requestedProperties->entries[i].property
+                 << ", PropertyState Name: " << requestedProperties->entries[i].propertyState
+                 << endl;
         } else {            
           sensor->getAddress(deviceAddress[i], i);
           HomieInternals::Helpers::byteArrayToHexString(deviceAddress[i], chMessageBuffer, sizeof(DeviceAddress));
-          Homie.getLogger() << cIndent 
-                            << F("PIN ") << _pin << F(": ") 
-                            << F("Device ") << i 
-                            << F(" using address ") << chMessageBuffer 
-                            << endl;
+          LOG_INFO << cIndent 
+                   << F("PIN ") << _pin << F(": ") 
+                   << F("Device ") << i 
+                   << F(" using address ") << chMessageBuffer 
+                   << endl;
         }
       }
     }
   }
 
   /**
-   * Called by Homie when homie is connected and in run mode
+   * Called by the scheduler every measurement interval, also while Homie is disconnected
   */
-  void DallasTemperatureNode::loop() {
-    if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-      _lastMeasurement = millis();
-      HomieRange sensorRange = {true, 0};
-      DeviceAddress *workingAddress;
-
-      if (numberOfDevices > 0) {
-        Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;        
-        // call sensors.requestTemperatures() to issue a global temperature
-        // request to all devices on the bus
-        sensor->requestTemperatures();  // Send the command to get temperature readings
-        for (uint8_t i = 0; i < numberOfDevices; i++) {
-
-          if (NULL != requestedProperties) {
-            workingAddress = &requestedProperties->entries[i].deviceAddress;
-          } else {
-            workingAddress = &deviceAddress[i];
-          }
+  void DallasTemperatureNode::measure() {
+    PROFILE_SCOPE(_measureStats);
 
-          if ( sensor->validAddress(*workingAddress) ) {  // make sure we have an address
-            sensorRange.index = i;
-            _temperature = sensor->getTempF(*workingAddress);  // According to request
+    // the task runs at the shortest interval, find the readings due in this run
+    const bool nodeDue = isDue(_nodeRuns, _measurementInterval);
+    bool       entryDue[DALLAS_MAX_ENTRIES];
+    bool       anyDue = nodeDue;
+    const uint8_t entryCount = (NULL != requestedProperties) ? min(requestedProperties->entryCount, (uint8_t)DALLAS_MAX_ENTRIES) : 0;
+    for (uint8_t i = 0; i < entryCount; i++) {
+      EntrySchedule& schedule = _schedules[i];
+      unsigned long  interval = (schedule.interval > 0) ? schedule.interval : _measurementInterval;
+      if (schedule.relay != NULL && schedule.activeInterval > 0 && schedule.relay->getSwitch()) {
+        interval = schedule.activeInterval;
+      }
+      entryDue[i] = isDue(schedule.runs, interval);
+      anyDue |= entryDue[i];
+    }
+    if (!anyDue) return;
 
-            if ((_temperature > 184.0) || (DEVICE_DISCONNECTED_F == _temperature))
-            {
-              HomieInternals::Helpers::byteArrayToHexString(*workingAddress, chMessageBuffer, sizeof(DeviceAddress));
-              Homie.getLogger() << cIndent 
-                                << F("✖ Error reading sensor") 
-                                << chMessageBuffer 
-                                << ". Request count: " << i
-                                << ", value read=" << _temperature << endl;
-              if (isRange())
-              {
-                setProperty(cHomieNodeState)
-                    .setRange(sensorRange)
-                    .setRetained(true)
-                    .send(cHomieNodeState_Error);
-              } else if (NULL != requestedProperties) {
-                setProperty(requestedProperties->entries[i].propertyState)
-                    .setRetained(true)
-                    .send(cHomieNodeState_Error);
-              } else {
-                setProperty(cHomieNodeState)
-                    .setRetained(true)
-                    .send(prepareNodeMessage(sensorRange.index, cHomieNodeState_Error, 0.0F));
-              }
-            }
-            else
+    HomieRange sensorRange = {true, 0};
+    DeviceAddress *workingAddress;
+
+    if (numberOfDevices > 0) {
+      LOG_DEBUG << F("〽 Sending Temperature: ") << getId() << endl;        
+      // call sensors.requestTemperatures() to issue a global temperature
+      // request to all devices on the bus
+      sensor->requestTemperatures();  // Send the command to get temperature readings
+      for (uint8_t i = 0; i < numberOfDevices; i++) {
+        if (!((i < entryCount) ? entryDue[i] : nodeDue)) continue;
+
+        if (NULL != requestedProperties) {
+          workingAddress = &requestedProperties->entries[i].deviceAddress;
+        } else {
+          workingAddress = &deviceAddress[i];
+        }
+
+        if ( sensor->validAddress(*workingAddress) ) {  // make sure we have an address
+          sensorRange.index = i;
+          _temperature = sensor->getTempF(*workingAddress);  // According to request
+          traceRecorder.sensor(_pin, *workingAddress, _temperature);
+
+          if ((_temperature > 184.0) || ((float)DEVICE_DISCONNECTED_F == _temperature))  // the library returns it as float
+          {
+            LOGB_WARNING(DALLAS_READ_ERROR, _pin, i, _temperature);
+            if (isRange())
             {
-              HomieInternals::Helpers::byteArrayToHexString(*workingAddress, chMessageBuffer, sizeof(DeviceAddress));
-              Homie.getLogger() << cIndent 
-                                << F("Temperature=") 
-                                << _temperature 
-                                << " for address=" 
-                                << chMessageBuffer 
-                                << endl;
-
-              if (isRange()) {
-                setProperty(cHomieNodeState)
-                    .setRange(sensorRange)
-                    .setRetained(true)
-                    .send(cHomieNodeState_OK);
-                setProperty(cTemperature)
-                    .setRange(sensorRange)
-                    .setRetained(true)
-                    .send(String(_temperature));
-              } else if (NULL != requestedProperties) {
-                setProperty(requestedProperties->entries[i].property)
-                    .setRetained(true)
-                    .send(String(_temperature));
-                setProperty(requestedProperties->entries[i].propertyState)
-                    .setRetained(true)
-                    .send(cHomieNodeState_OK);
-              } else {
-                setProperty(cHomieNodeState)
-                    .setRetained(true)
-                    .send(prepareNodeMessage(sensorRange.index, cHomieNodeState_OK, 0.0F));
-                setProperty(cTemperature)
-                    .setRetained(true)
-                    .send(prepareNodeMessage(sensorRange.index, NULL, _temperature));
-              }
+              publishQueue.send(*this, cHomieNodeState, cHomieNodeState_Error, PublishQueue::SENSOR, sensorRange);
+            } else if (NULL != requestedProperties) {
+              publishQueue.send(*this, requestedProperties->entries[i].propertyState, cHomieNodeState_Error, PublishQueue::SENSOR);
+            } else {
+              publishQueue.sendKeyed(*this, cHomieNodeState, sensorRange.index, prepareNodeMessage(sensorRange.index, cHomieNodeState_Error, 0.0F), PublishQueue::SENSOR);
             }
-          } else { // if address is invalid
-            HomieInternals::Helpers::byteArrayToHexString(*workingAddress, chMessageBuffer, sizeof(DeviceAddress));
-            Homie.getLogger() << cIndent 
-                              << F("✖ Error reading sensor") 
-                              << chMessageBuffer 
-                              << ". Request count: " << i
-                              << ", Invalid Address!" 
-                              << endl;
+          }
+          else
+          {
+            LOGB_DEBUG(DALLAS_TEMPERATURE, _temperature, _pin, i);
+
             if (isRange()) {
-              setProperty(cHomieNodeState)
-                  .setRange(sensorRange)
-                  .setRetained(true)
-                  .send(cHomieNodeState_Address);
-              } else if (NULL != requestedProperties) {
-                setProperty(requestedProperties->entries[i].propertyState)
-                    .setRetained(true)
-                    .send(cHomieNodeState_Address);
-              } else {
-                setProperty(cHomieNodeState)
-                    .setRetained(true)
-                    .send(prepareNodeMessage(sensorRange.index, cHomieNodeState_Address, 0.0F));
-              }
+              publishQueue.send(*this, cHomieNodeState, cHomieNodeState_OK, PublishQueue::SENSOR, sensorRange);
+              publishQueue.send(*this, cTemperature, String(_temperature), PublishQueue::SENSOR, sensorRange);
+            } else if (NULL != requestedProperties) {
+              publishQueue.send(*this, requestedProperties->entries[i].property, String(_temperature), PublishQueue::SENSOR);
+              publishQueue.send(*this, requestedProperties->entries[i].propertyState, cHomieNodeState_OK, PublishQueue::SENSOR);
+            } else {
+              // one topic for all sensors with the index in the message: each sensor keeps its latest value
+              publishQueue.sendKeyed(*this, cHomieNodeState, sensorRange.index, prepareNodeMessage(sensorRange.index, cHomieNodeState_OK, 0.0F), PublishQueue::SENSOR);
+              publishQueue.sendKeyed(*this, cTemperature, sensorRange.index, prepareNodeMessage(sensorRange.index, NULL, _temperature), PublishQueue::SENSOR);
+            }
           }
-        } // loop end
-      } else { // Node Failure with no devices
-        Homie.getLogger() << F("No Sensor found!") << endl;
-        setProperty("$state").send("alert");
-        
-        //re-init
-        initializeSensors();
+        } else { // if address is invalid
+          HomieInternals::Helpers::byteArrayToHexString(*workingAddress, chMessageBuffer, sizeof(DeviceAddress));
+          LOG_WARNING << cIndent 
+                      << F("✖ Error reading sensor") 
+                      << chMessageBuffer 
+                      << ". Request count: " << i
+                      << ", Invalid Address!" 
+                      << endl;
+          if (isRange()) {
+            publishQueue.send(*this, cHomieNodeState, cHomieNodeState_Address, PublishQueue::SENSOR, sensorRange);
+            } else if (NULL != requestedProperties) {
+              publishQueue.send(*this, requestedProperties->entries[i].propertyState, cHomieNodeState_Address, PublishQueue::SENSOR);
+            } else {
+              publishQueue.sendKeyed(*this, cHomieNodeState, sensorRange.index, prepareNodeMessage(sensorRange.index, cHomieNodeState_Address, 0.0F), PublishQueue::SENSOR);
+            }
+        }
+      } // loop end
+    } else if (nodeDue) { // Node Failure with no devices
+      LOG_WARNING << F("No Sensor found!") << endl;
+      publishQueue.send(*this, "$state", "alert", PublishQueue::SENSOR);
+      
+      //re-init, the device count of the library only changes with a new search
+      sensor->begin();
+      initializeSensors();
+    }
+  }
+
+ /**
+  *
+ */
+  void DallasTemperatureNode::setMeasurementInterval(unsigned long interval) {
+    _measurementInterval = interval;
+    reschedule();
+  }
+
+ /**
+  * Own interval of a sensor entry in s, activeInterval applies while the bound relay is on.
+  * 0 falls back to the measurement interval of the node.
+ */
+  bool DallasTemperatureNode::setEntryInterval(const char* property, unsigned long interval, unsigned long activeInterval) {
+    const int i = findEntry(property, strlen(property));
+    if (i < 0) return false;
+
+    _schedules[i].interval       = interval;
+    _schedules[i].activeInterval = activeInterval;
+    reschedule();
+    return true;
+  }
+
+ /**
+  * Takes "property:seconds[/seconds while the relay is on],...", e.g. "tempSucPool:60,tempRetHeater:30/5".
+ */
+  bool DallasTemperatureNode::setEntryIntervals(const char* intervals) {
+    return parseIntervals(intervals, this);
+  }
+
+ /**
+  *
+ */
+  bool DallasTemperatureNode::isValidIntervals(const char* intervals) {
+    return parseIntervals(intervals, NULL);
+  }
+
+ /**
+  * The relay switches the entry to its active interval.
+ */
+  bool DallasTemperatureNode::bindRelay(const char* property, RelayModuleNode* relay) {
+    const int i = findEntry(property, strlen(property));
+    if (i < 0) return false;
+
+    _schedules[i].relay = relay;
+    reschedule();
+    return true;
+  }
+
+ /**
+  * The task runs at the shortest interval of the node and its entries, all
+  * sensors are read in the first run.
+ */
+  void DallasTemperatureNode::reschedule() {
+    _taskInterval = _measurementInterval;
+    for (uint8_t i = 0; i < DALLAS_MAX_ENTRIES; i++) {
+      const EntrySchedule& schedule = _schedules[i];
+      if (schedule.interval > 0 && schedule.interval < _taskInterval) _taskInterval = schedule.interval;
+      if (schedule.relay != NULL && schedule.activeInterval > 0 && schedule.activeInterval < _taskInterval) {
+        _taskInterval = schedule.activeInterval;
       }
     }
+    if (_taskInterval < MIN_ENTRY_INTERVAL) _taskInterval = MIN_ENTRY_INTERVAL;
+
+    _nodeRuns = UINT16_MAX - 1;
+    for (uint8_t i = 0; i < DALLAS_MAX_ENTRIES; i++) {
+      _schedules[i].runs = UINT16_MAX - 1;
+    }
+
+    scheduler.every(_measureTask, _taskInterval * 1000UL);
+  }
+
+ /**
+  * @return true every interval / task interval runs, rounded
+ */
+  bool DallasTemperatureNode::isDue(uint16_t& runs, unsigned long interval) {
+    unsigned long every = (interval + _taskInterval / 2) / _taskInterval;
+    if (every == 0) every = 1;
+
+    if (runs < UINT16_MAX) runs++;
+    if (runs < every) return false;
+
+    runs = 0;
+    return true;
+  }
+
+ /**
+  * @return index of the entry with the given property name or -1
+ */
+  int DallasTemperatureNode::findEntry(const char* property, size_t length) const {
+    if (NULL == requestedProperties) return -1;
+
+    for (uint8_t i = 0; i < requestedProperties->entryCount && i < DALLAS_MAX_ENTRIES; i++) {
+      const char* name = requestedProperties->entries[i].property;
+      if (strncmp(name, property, length) == 0 && name[length] == '\0') return i;
+    }
+    return -1;
+  }
+
+ /**
+  * Checks the syntax and, with a node, applies the intervals to its entries.
+ */
+  bool DallasTemperatureNode::parseIntervals(const char* intervals, DallasTemperatureNode* node) {
+    if (intervals == NULL) return false;
+
+    bool        valid = true;
+    const char* p     = intervals;
+    while (*p != '\0') {
+      const char* name = p;
+      while (*p != ':' && *p != ',' && *p != '\0') p++;
+      if (*p != ':' || p == name) return false;
+      const size_t length = p - name;
+
+      p++;
+      if (!isdigit(*p)) return false;
+      char*         end;
+      unsigned long interval       = strtoul(p, &end, 10);
+      unsigned long activeInterval = 0;
+      p = end;
+      if (*p == '/') {
+        p++;
+        if (!isdigit(*p)) return false;
+        activeInterval = strtoul(p, &end, 10);
+        p = end;
+      }
+      if (*p == ',') {
+        p++;
+      } else if (*p != '\0') {
+        return false;
+      }
+
+      if (node != NULL) {
+        const int i = node->findEntry(name, length);
+        if (i < 0) {
+          LOG_WARNING << F("✖ unknown sensor in intervals: ") << String(name).substring(0, length) << endl;
+          valid = false;
+          continue;
+        }
+        node->_schedules[i].interval       = interval;
+        node->_schedules[i].activeInterval = activeInterval;
+      }
+    }
+
+    if (node != NULL) node->reschedule();
+    return valid;
   }
 
  /**
   *
  */
-  void DallasTemperatureNode::printCaption() { Homie.getLogger() << cCaption << endl; }
+  void DallasTemperatureNode::printCaption() { LOG_DEBUG << cCaption << endl; }
 
  /**
   *
@@ -297,7 +434,7 @@ DallasTemperatureNode::DallasTemperatureNode(const char* id, const char* name, c
                address2String(deviceAddress[idx]).c_str(), stateValue);
     }
 
-    Homie.getLogger() << "Payload=" << chMessageBuffer << endl;
+    LOG_DEBUG << "Payload=" << chMessageBuffer << endl;
 
     return String(chMessageBuffer);
   }
@@ -8,6 +8,9 @@
 #include <Homie.hpp>
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include "LoopProfiler.hpp"
+#include "RelayModuleNode.hpp"
+#include "Scheduler.hpp"
 
 // Configurable Request
 typedef struct __attribute__((packed)) _entry {
@@ -20,13 +23,16 @@ typedef struct __attribute__((packed)) _entry {
   DeviceAddress deviceAddress;
 } DallasPropertyEntry, *pDallasPropertyEntry;
 
+#define DALLAS_MAX_ENTRIES 8
+
 typedef struct __attribute__((packed)) _container {
   uint8_t entryCount;
-  DallasPropertyEntry entries[8];
+  DallasPropertyEntry entries[DALLAS_MAX_ENTRIES];
 } DallasProperties, *pDallasProperties;
 
 
 class DallasTemperatureNode : public HomieNode {
+  friend class Benchmarks;
 
 public:
   DallasTemperatureNode(const char* id, const char* name, const char* nType, const uint8_t pin, const int measurementInterval,
@@ -36,13 +42,18 @@ public:
                         const int measurementInterval);
 
   uint8_t       getPin() const { return _pin; }
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
   float         getTemperature() const { return _temperature; }
 
+  bool setEntryInterval(const char* property, unsigned long interval, unsigned long activeInterval = 0);
+  bool setEntryIntervals(const char* intervals);
+  bool bindRelay(const char* property, RelayModuleNode* relay);
+
+  static bool isValidIntervals(const char* intervals);
+
 protected:
   void setup() override;
-  void loop() override;
   
 private:
   // Total number of Sensors
@@ -51,6 +62,7 @@ private:
   // suggested rate is 1/60Hz (1m)
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
+  static const int MIN_ENTRY_INTERVAL   = 1;  // in seconds, a conversion takes up to 750 ms
 
   const char* cCaption = "• DallasTemperature sensor:";
   const char* cIndent  = "  ◦ ";
@@ -82,7 +94,7 @@ private:
 
   uint8_t       _pin;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
+  unsigned long _taskInterval;  // in s, the shortest of all intervals
   int           _rangeCount;
   float         _temperature = NAN;
   char          chMessageBuffer[256];
@@ -91,8 +103,35 @@ private:
   DallasTemperature* sensor;
   uint8_t            numberOfDevices;  // Number of temperature devices found
 
+  /*
+   * Interval of an entry, counted in runs of the task. The shorter interval
+   * applies while the bound relay is on, e.g. the heater return sensor while
+   * the heater runs.
+   */
+  struct EntrySchedule {
+    unsigned long    interval;        // in s, 0 = measurement interval of the node
+    unsigned long    activeInterval;  // in s while the relay is on, 0 = interval
+    RelayModuleNode* relay;
+    uint16_t         runs;            // since the last reading
+  };
+
+  EntrySchedule _schedules[DALLAS_MAX_ENTRIES];
+  uint16_t      _nodeRuns;
+
+  Scheduler::Task _measureTask{getId(), [](void* node) { static_cast<DallasTemperatureNode*>(node)->measure(); }, this};
+
+  void   measure();
+  void   reschedule();
+  int    findEntry(const char* property, size_t length) const;
+  bool   isDue(uint16_t& runs, unsigned long interval);
+
+  static bool parseIntervals(const char* intervals, DallasTemperatureNode* node);
   void   initializeSensors();
   void   printCaption();
   String address2String(const DeviceAddress deviceAddress);
   String prepareNodeMessage(uint8_t idx, const char* stateValue, float tempValue);
+
+#ifdef LOOP_PROFILING
+  LoopStats _measureStats{getId(), "measure"};
+#endif
 };
@@ -0,0 +1,202 @@
+/**
+ * Homie Node for runtime diagnostics of the controller.
+ */
+
+#include "DiagnosticsNode.hpp"
+#include "PublishQueue.hpp"
+#include "TraceRecorder.hpp"
+
+/**
+ *
+ */
+DiagnosticsNode::DiagnosticsNode(const char* id, const char* name, const int measurementInterval)
+    : HomieNode(id, name, "diagnostics") {
+
+  _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
+
+#ifdef LOOP_PROFILING
+  _nextStats = LoopStats::MAX_STATS;
+#endif
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::setup() {
+  advertise("free-heap").setName("Free heap").setDatatype("integer").setUnit("B");
+  advertise("max-block").setName("Largest free block").setDatatype("integer").setUnit("B");
+  advertise("fragmentation").setName("Heap fragmentation").setDatatype("integer").setFormat("0:100").setUnit("%");
+  advertise("scheduler").setName("Scheduler runs and lateness").setDatatype("string");
+  advertise("publish-queue").setName("Publish queue").setDatatype("string");
+  advertise("trace").setName("Trace recording").setDatatype("enum").setFormat("on,off,clear").settable();
+#ifdef HEAP_TRACKING
+  advertise("allocations").setName("Allocations per call site").setDatatype("string");
+#endif
+#ifdef LOOP_PROFILING
+  for (uint8_t i = 0; i < LoopStats::getStatsCount(); i++) {
+    advertise(LoopStats::getStats(i)->getProperty()).setName("Loop timing").setDatatype("string").setUnit("µs");
+  }
+#endif
+
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::loop() {
+#ifdef LOOP_PROFILING
+  PROFILE_SCOPE(_loopStats);
+
+  // spread the publishes over the following loops
+  if (_nextStats < LoopStats::getStatsCount() && Homie.isConnected()) {
+    publishStats(*LoopStats::getStats(_nextStats++));
+  }
+#endif
+}
+
+/**
+ * trace: on, off or clear.
+ */
+bool DiagnosticsNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+  if (!property.equalsIgnoreCase("trace")) {
+    return false;
+  }
+
+  if (value == "on") {
+    traceRecorder.start();
+  } else if (value == "off") {
+    traceRecorder.stop();
+  } else if (value == "clear") {
+    traceRecorder.clear();
+  } else {
+    return false;
+  }
+  publishQueue.send(*this, "trace", traceRecorder.isRecording() ? "on" : "off", PublishQueue::SETTING);
+  return true;
+}
+
+/**
+ * Called by the scheduler every measurement interval while Homie is connected.
+ */
+void DiagnosticsNode::measure() {
+  publishHeap();
+  publishScheduler();
+  publishQueueStats();
+#ifdef HEAP_TRACKING
+  publishAllocations();
+#endif
+
+#ifdef LOOP_PROFILING
+  _nextStats = 0;
+#endif
+}
+
+/**
+ *
+ */
+void DiagnosticsNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
+}
+
+/**
+ * Fragmentation in % is 100 - largest free block / free heap.
+ */
+void DiagnosticsNode::publishHeap() {
+  const uint32_t freeHeap = ESP.getFreeHeap();
+#ifdef ESP32
+  const uint32_t maxBlock      = ESP.getMaxAllocHeap();
+  const uint8_t  fragmentation = (freeHeap > 0) ? 100 - (uint32_t)(maxBlock * 100ULL / freeHeap) : 0;
+#elif defined(ESP8266)
+  const uint32_t maxBlock      = ESP.getMaxFreeBlockSize();
+  const uint8_t  fragmentation = ESP.getHeapFragmentation();
+#endif
+
+  publishQueue.send(*this, "free-heap", String(freeHeap), PublishQueue::LOG);
+  publishQueue.send(*this, "max-block", String(maxBlock), PublishQueue::LOG);
+  publishQueue.send(*this, "fragmentation", String(fragmentation), PublishQueue::LOG);
+}
+
+/**
+ * {"task":[runs,max. lateness in ms],..} of the last interval.
+ */
+void DiagnosticsNode::publishScheduler() {
+  size_t length = 1;
+  strcpy(_message, "{");
+
+  for (Scheduler::Task* task = scheduler.getFirstTask(); task != NULL; task = scheduler.getNextTask(task)) {
+    const int n = snprintf(_message + length, sizeof(_message) - length, "%s\"%s\":[%u,%u]", (length == 1) ? "" : ",",
+                           task->getName(), task->getRuns(), task->getMaxLateness());
+    if (n < 0 || length + n >= sizeof(_message) - 1) break;  // keep room for the closing brace
+    length += n;
+    task->resetStats();
+  }
+  strcpy(_message + length, "}");
+
+  publishQueue.send(*this, "scheduler", _message, PublishQueue::LOG);
+}
+
+/**
+ * {"depth":..,"maxDepth":..,"sent":..,"coalesced":..,"dropped":..,"refused":..},
+ * the max. depth of the last interval and the counts since boot, see
+ * PublishQueue.hpp.
+ */
+void DiagnosticsNode::publishQueueStats() {
+  snprintf(_message, sizeof(_message), "{\"depth\":%u,\"maxDepth\":%u,\"sent\":%u,\"coalesced\":%u,\"dropped\":%u,\"refused\":%u}",
+           publishQueue.getDepth(), publishQueue.getMaxDepth(), publishQueue.getSent(), publishQueue.getCoalesced(),
+           publishQueue.getDropped(), publishQueue.getRefused());
+  publishQueue.resetMaxDepth();
+
+  publishQueue.send(*this, "publish-queue", _message, PublishQueue::LOG);
+}
+
+#ifdef HEAP_TRACKING
+/**
+ * {"total":..,"untracked":..,"sites":[["40201234",count,bytes],..]} of the
+ * last interval. The sites are collected anew every interval.
+ */
+void DiagnosticsNode::publishAllocations() {
+  // snapshot first, formatting and sending allocate themselves
+  HeapTracker::Site sites[HeapTracker::MAX_SITES];
+  const uint8_t     siteCount   = HeapTracker::getSiteCount();
+  const uint32_t    allocations = HeapTracker::getAllocations();
+  const uint32_t    untracked   = HeapTracker::getUntracked();
+  for (uint8_t i = 0; i < siteCount; i++) {
+    sites[i] = HeapTracker::getSite(i);
+  }
+
+  size_t length = snprintf(_message, sizeof(_message), "{\"total\":%u,\"untracked\":%u,\"sites\":[", allocations, untracked);
+  for (uint8_t i = 0; i < siteCount; i++) {
+    const int n = snprintf(_message + length, sizeof(_message) - length, "%s[\"%08x\",%u,%u]", (i == 0) ? "" : ",",
+                           sites[i].address, sites[i].count, sites[i].bytes);
+    if (n < 0 || length + n >= sizeof(_message) - 2) break;  // keep room for the closing brackets
+    length += n;
+  }
+  strcpy(_message + length, "]}");
+
+  publishQueue.send(*this, "allocations", _message, PublishQueue::LOG);
+  HeapTracker::reset();
+}
+#endif
+
+#ifdef LOOP_PROFILING
+/**
+ * {"count":..,"min":..,"mean":..,"max":..,"histogram":[..]} of the last
+ * interval, histogram bucket n counts durations of n significant bits in µs.
+ */
+void DiagnosticsNode::publishStats(LoopStats& stats) {
+  size_t length = snprintf(_message, sizeof(_message), "{\"count\":%u,\"min\":%u,\"mean\":%u,\"max\":%u,\"histogram\":[",
+                           stats.getCount(), stats.getMin(), stats.getMean(), stats.getMax());
+
+  for (uint8_t i = 0; i < LoopStats::BUCKETS && length < sizeof(_message); i++) {
+    length += snprintf(_message + length, sizeof(_message) - length, (i == 0) ? "%u" : ",%u", stats.getBucket(i));
+  }
+  if (length < sizeof(_message)) {
+    snprintf(_message + length, sizeof(_message) - length, "]}");
+  }
+
+  publishQueue.send(*this, stats.getProperty(), _message, PublishQueue::LOG);
+  stats.reset();
+}
+#endif
@@ -0,0 +1,56 @@
+/**
+ * Homie Node for runtime diagnostics of the controller.
+ *
+ * Publishes free heap, the largest free block, the fragmentation, the
+ * lateness of the scheduler tasks and the publish queue statistics every
+ * measurement interval. Builds with LOOP_PROFILING add the loop timing
+ * statistics, builds with HEAP_TRACKING the allocations per call site.
+ * The settable property trace switches the trace recording on or off or
+ * clears the trace files, see TraceRecorder.hpp.
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include "HeapTracker.hpp"
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
+
+class DiagnosticsNode : public HomieNode {
+
+public:
+  DiagnosticsNode(const char* id, const char* name, const int measurementInterval = MEASUREMENT_INTERVAL);
+
+  void          setMeasurementInterval(unsigned long interval);
+  unsigned long getMeasurementInterval() const { return _measurementInterval; }
+
+protected:
+  void setup() override;
+  void loop() override;
+  bool handleInput(const HomieRange& range, const String& property, const String& value) override;
+
+private:
+  static const int MIN_INTERVAL         = 10;  // in seconds
+  static const int MEASUREMENT_INTERVAL = 60;
+
+  unsigned long _measurementInterval;
+  char          _message[384];
+
+  Scheduler::Task _measureTask{getId(), [](void* node) { static_cast<DiagnosticsNode*>(node)->measure(); }, this};
+
+  void measure();
+  void publishHeap();
+  void publishScheduler();
+  void publishQueueStats();
+#ifdef HEAP_TRACKING
+  void publishAllocations();
+#endif
+
+#ifdef LOOP_PROFILING
+  uint8_t _nextStats;  // stats to publish, one per loop
+
+  void publishStats(LoopStats& stats);
+
+  LoopStats _loopStats{getId(), "loop"};
+#endif
+};
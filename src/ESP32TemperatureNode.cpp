@@ -4,6 +4,8 @@
  */
 
 #include "ESP32TemperatureNode.hpp"
+#include "Log.hpp"
+#include "PublishQueue.hpp"
 
 /**
  * @param id
@@ -12,45 +14,52 @@ ESP32TemperatureNode::ESP32TemperatureNode(const char* id, const char* name, con
     : HomieNode(id, name, "temperature") {
 
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = millis();
 }
 
 /**
  *
  */
 void ESP32TemperatureNode::printCaption() {
-  Homie.getLogger() << cCaption << endl;
+  LOG_DEBUG << cCaption << endl;
 }
 
 /**
- *
+ * Called by the scheduler every measurement interval while Homie is connected.
  */
-void ESP32TemperatureNode::loop() {
+void ESP32TemperatureNode::measure() {
+  PROFILE_SCOPE(_measureStats);
 
 #ifdef ESP32
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-    _lastMeasurement = millis();
-
-    Homie.getLogger() << F("〽 Sending Temperature: ") << getId() << endl;
-
-    //internal temp of ESP
-    const uint8_t temp_farenheit = temprature_sens_read();
-    const double  temp           = (temp_farenheit - 32) / 1.8;
+  LOG_DEBUG << F("〽 Sending Temperature: ") << getId() << endl;
 
-    Homie.getLogger() << cIndent << F("Temperature = ") << temp << cTemperatureUnit << endl;
-    if(Homie.isConnected()) {
-      setProperty(cTemperature).send(String(temp, 2));
-      setProperty(cHomieNodeState).send(cHomieNodeState_OK);
-    }
+  //internal temp of ESP
+  const uint8_t temp_farenheit = temprature_sens_read();
+  const double  temp           = (temp_farenheit - 32) / 1.8;
 
+  LOG_DEBUG << cIndent << F("Temperature = ") << temp << cTemperatureUnit << endl;
+  if(Homie.isConnected()) {
+    publishQueue.send(*this, cTemperature, String(temp, 2), PublishQueue::SENSOR);
+    publishQueue.send(*this, cHomieNodeState, cHomieNodeState_OK, PublishQueue::SENSOR);
   }
 #endif
 }
 
+/**
+ *
+ */
+void ESP32TemperatureNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
+}
+
 /**
  *
  */
 void ESP32TemperatureNode::onReadyToOperate() {
   advertise(cTemperature).setName(cTemperatureName).setDatatype("float").setFormat("-50:100").setUnit(cTemperatureUnit);
   advertise(cHomieNodeState).setName(cHomieNodeStateName);
+
+  if (!_measureTask.isScheduled()) {
+    scheduler.every(_measureTask, _measurementInterval * 1000UL);
+  }
 }
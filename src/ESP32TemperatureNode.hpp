@@ -6,6 +6,8 @@
 #pragma once
 
 #include <Homie.hpp>
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
 
 #ifdef ESP32
 extern "C" {
@@ -20,11 +22,10 @@ public:
   ESP32TemperatureNode(const char* id, const char* name, const int measurementInterval = MEASUREMENT_INTERVAL);
 
   float         getTemperature() const { return temperature; }
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
 
 protected:
-  void loop() override;
   void onReadyToOperate() override;
 
 private:
@@ -47,9 +48,15 @@ private:
   bool          _sensorFound = false;
   unsigned int  _pin;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
 
   float temperature = NAN;
 
+  Scheduler::Task _measureTask{getId(), [](void* node) { static_cast<ESP32TemperatureNode*>(node)->measure(); }, this};
+
+  void measure();
   void printCaption();
+
+#ifdef LOOP_PROFILING
+  LoopStats _measureStats{getId(), "measure"};
+#endif
 };
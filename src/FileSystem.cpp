@@ -0,0 +1,15 @@
+/**
+ * The file system Homie keeps its configuration on.
+ */
+
+#include "FileSystem.hpp"
+
+/**
+ * Mounts the file system on the first call, the later ones only return the
+ * result.
+ * @return true if mounted
+ */
+bool mountFileSystem() {
+  static const bool mounted = FILE_SYSTEM.begin();
+  return mounted;
+}
@@ -0,0 +1,16 @@
+/**
+ * The file system Homie keeps its configuration on, also used by the
+ * trace recorder and the offline history.
+ */
+
+#pragma once
+
+#ifdef ESP32
+#include <SPIFFS.h>
+#define FILE_SYSTEM SPIFFS
+#elif defined(ESP8266)
+#include <LittleFS.h>
+#define FILE_SYSTEM LittleFS
+#endif
+
+bool mountFileSystem();
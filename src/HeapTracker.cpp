@@ -0,0 +1,67 @@
+/**
+ * Allocation counting per call site.
+ */
+
+#include "HeapTracker.hpp"
+
+#ifdef HEAP_TRACKING
+
+HeapTracker::Site HeapTracker::_sites[MAX_SITES];
+uint8_t           HeapTracker::_siteCount   = 0;
+uint32_t          HeapTracker::_allocations = 0;
+uint32_t          HeapTracker::_bytes       = 0;
+uint32_t          HeapTracker::_untracked   = 0;
+
+/**
+ * Called by the allocator wrappers, must not allocate itself.
+ */
+void HeapTracker::record(const void* caller, size_t size) {
+  const uint32_t address = (uint32_t)(uintptr_t)caller;
+  _allocations++;
+  _bytes += size;
+
+  for (uint8_t i = 0; i < _siteCount; i++) {
+    if (_sites[i].address == address) {
+      _sites[i].count++;
+      _sites[i].bytes += size;
+      return;
+    }
+  }
+
+  if (_siteCount < MAX_SITES) {
+    Site& site   = _sites[_siteCount++];
+    site.address = address;
+    site.count   = 1;
+    site.bytes   = size;
+  } else {
+    _untracked++;
+  }
+}
+
+/**
+ * Forgets all sites, so that the next interval only shows the steady state.
+ */
+void HeapTracker::reset() {
+  _siteCount   = 0;
+  _allocations = 0;
+  _bytes       = 0;
+  _untracked   = 0;
+}
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  HeapTracker::record(__builtin_return_address(0), size);
+  return __real_malloc(size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  HeapTracker::record(__builtin_return_address(0), size);
+  return __real_realloc(ptr, size);
+}
+}
+
+#endif
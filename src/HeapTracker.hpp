@@ -0,0 +1,45 @@
+/**
+ * Allocation counting per call site, enabled by the build flag HEAP_TRACKING.
+ *
+ * The firmware has to be linked with -Wl,--wrap=malloc -Wl,--wrap=realloc,
+ * the wrappers record the return address of every allocation before calling
+ * the real allocator. The sites are code addresses, addr2line on the ELF file
+ * of the build turns them into functions. Allocations made through String
+ * show up inside String, the sites of new inside operator new.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef HEAP_TRACKING
+
+class HeapTracker {
+
+public:
+  static const uint8_t MAX_SITES = 16;
+
+  struct Site {
+    uint32_t address;
+    uint32_t count;
+    uint32_t bytes;
+  };
+
+  static void record(const void* caller, size_t size);
+  static void reset();
+
+  static uint8_t     getSiteCount() { return _siteCount; }
+  static const Site& getSite(uint8_t index) { return _sites[index]; }
+  static uint32_t    getAllocations() { return _allocations; }
+  static uint32_t    getBytes() { return _bytes; }
+  static uint32_t    getUntracked() { return _untracked; }  // of sites beyond MAX_SITES
+
+private:
+  static Site     _sites[MAX_SITES];
+  static uint8_t  _siteCount;
+  static uint32_t _allocations;
+  static uint32_t _bytes;
+  static uint32_t _untracked;
+};
+
+#endif
@@ -0,0 +1,269 @@
+/**
+ * Homie Node with the readings and relay transitions of an outage.
+ */
+
+#include "HistoryNode.hpp"
+#include "FileSystem.hpp"
+#include "JsonValue.hpp"
+#include "Log.hpp"
+#include "TimeClientHelper.hpp"
+
+const char* const HistoryNode::FILE_PATH = "/history.bin";
+
+/**
+ *
+ */
+HistoryNode::HistoryNode(const char* id, const char* name)
+    : HomieNode(id, name, "history") {
+  setRunLoopDisconnected(true);  // writes the buffer out during the outage
+}
+
+/**
+ * Mounts the file system, records left from before a reset are published
+ * first once connected.
+ */
+void HistoryNode::setup() {
+  advertise("records").setName("Records of the last outage").setDatatype("string");
+
+  publishQueue.addListener(onPublish, this);
+
+  _mounted = mountFileSystem();
+  if (!_mounted) {
+    LOG_WARNING << F("✖ history: file system not mounted, records kept in RAM only") << endl;
+    return;
+  }
+  _filePending = FILE_SYSTEM.exists(FILE_PATH);
+}
+
+/**
+ * Writes the buffer out once a minute while disconnected, publishes a
+ * batch every REPLAY_PERIOD ms while connected.
+ */
+void HistoryNode::loop() {
+  if (!Homie.isConnected()) {
+    if (_mounted && _ramOffset < _length && millis() - _lastFlush >= FLUSH_PERIOD) {
+      flush();
+    }
+    return;
+  }
+
+  if (isPending() && millis() - _lastReplay >= REPLAY_PERIOD && publishQueue.hasRoom(PublishQueue::LOG)) {
+    _lastReplay = millis();
+    replay();
+  }
+}
+
+/**
+ * Values longer than a record holds are dropped, a cut JSON value would
+ * break the batch.
+ */
+void HistoryNode::record(const HomieNode& node, const char* property, const HomieRange& range, const String& value) {
+  if (!isTimeValid()) return;
+
+  char      topic[MAX_TOPIC + 1];
+  const int written = range.isRange ? snprintf(topic, sizeof(topic), "%s/%s_%d", node.getId(), property, range.index)
+                                    : snprintf(topic, sizeof(topic), "%s/%s", node.getId(), property);
+
+  const size_t topicLength = min((size_t)max(written, 0), MAX_TOPIC);
+  const size_t valueLength = value.length();
+  const size_t size        = 4 + 1 + topicLength + 1 + valueLength;
+  if (valueLength > 0xFF) {
+    _dropped++;
+    return;
+  }
+
+  if (_length + size > BUFFER_SIZE && _mounted) {
+    flush();
+  }
+  if (_length + size > BUFFER_SIZE) {
+    _dropped++;
+    return;
+  }
+
+  if (_length == _ramOffset) _lastFlush = millis();  // a minute from the first record
+
+  const uint32_t utc = getUtcTime();
+  uint8_t*       p   = _buffer + _length;
+  memcpy(p, &utc, sizeof(utc));
+  p += sizeof(utc);
+  *p++ = topicLength;
+  memcpy(p, topic, topicLength);
+  p += topicLength;
+  *p++ = valueLength;
+  memcpy(p, value.c_str(), valueLength);
+  _length += size;
+  _recorded++;
+}
+
+/**
+ * Appends the records not yet published to the file, they are dropped if
+ * it would grow beyond MAX_FILE_SIZE.
+ */
+void HistoryNode::flush() {
+  _lastFlush = millis();
+  if (_ramOffset == _length) return;
+
+  const uint8_t* records = _buffer + _ramOffset;
+  const size_t   length  = _length - _ramOffset;
+  _length                = 0;
+  _ramOffset             = 0;
+
+  File file = FILE_SYSTEM.open(FILE_PATH, "a");
+  if (!file || file.size() + length > MAX_FILE_SIZE) {
+    _dropped += countRecords(records, length);
+    return;
+  }
+  if (file.write(records, length) != length) {
+    _dropped += countRecords(records, length);
+  }
+  file.close();
+  _filePending = true;
+}
+
+/**
+ * Publishes the next batch: the records of the file first, they are older
+ * than the ones in RAM.
+ */
+void HistoryNode::replay() {
+  _message[0]    = '[';
+  _messageLength = 1;
+
+  if (!_filePending || replayFile()) {
+    replayBuffer();
+  }
+  sendMessage();
+}
+
+/**
+ * Adds the records of the file to the batch, removes the file once all are
+ * in. A record cut by a reset ends the file.
+ * @return true if the file is done and the batch has room for more
+ */
+bool HistoryNode::replayFile() {
+  File file = FILE_SYSTEM.open(FILE_PATH, "r");
+  if (file && file.seek(_fileOffset)) {
+    const size_t fileSize = file.size();
+    while (_fileOffset < fileSize) {
+      uint8_t header[5];
+      char    topic[MAX_TOPIC];
+      uint8_t valueLength;
+      char    value[0xFF];
+      if (file.read(header, sizeof(header)) != sizeof(header) || header[4] > MAX_TOPIC ||
+          file.read((uint8_t*)topic, header[4]) != header[4] || file.read(&valueLength, 1) != 1 ||
+          file.read((uint8_t*)value, valueLength) != valueLength) {
+        break;
+      }
+
+      uint32_t utc;
+      memcpy(&utc, header, sizeof(utc));
+      if (!addRecord(utc, topic, header[4], value, valueLength)) {
+        file.close();
+        return false;
+      }
+      _fileOffset += sizeof(header) + header[4] + 1 + valueLength;
+    }
+    file.close();
+  }
+
+  FILE_SYSTEM.remove(FILE_PATH);
+  _filePending = false;
+  _fileOffset  = 0;
+  return true;
+}
+
+/**
+ * Adds the records of the buffer to the batch, the buffer starts over once
+ * all are in.
+ */
+void HistoryNode::replayBuffer() {
+  while (_ramOffset < _length) {
+    const uint8_t* p = _buffer + _ramOffset;
+    uint32_t       utc;
+    memcpy(&utc, p, sizeof(utc));
+    const uint8_t topicLength = p[4];
+    const char*   topic       = (const char*)p + 5;
+    const uint8_t valueLength = p[5 + topicLength];
+    const char*   value       = (const char*)p + 6 + topicLength;
+
+    if (!addRecord(utc, topic, topicLength, value, valueLength)) return;
+    _ramOffset += 6 + topicLength + valueLength;
+  }
+  _length    = 0;
+  _ramOffset = 0;
+}
+
+/**
+ * Adds [utc,"topic",value] to the batch. A record too long for an empty
+ * batch is dropped.
+ * @return false if the batch is full
+ */
+bool HistoryNode::addRecord(uint32_t utc, const char* topic, size_t topicLength, const char* value, size_t valueLength) {
+  char text[0xFF + 1];
+  memcpy(text, value, valueLength);
+  text[valueLength] = '\0';
+
+  char         json[0xFF + 3];
+  const size_t jsonLength = JsonValue::format(json, sizeof(json), text);
+
+  // ,[4294967295,"topic",value]] with the closing bracket of the batch
+  const size_t needed = 1 + 1 + 10 + 2 + topicLength + 2 + jsonLength + 2;
+  if (_messageLength + needed >= MESSAGE_SIZE) {
+    if (_messageLength > 1) return false;
+    _dropped++;
+    return true;
+  }
+  if (jsonLength == 0) {
+    _dropped++;
+    return true;
+  }
+
+  if (_messageLength > 1) _message[_messageLength++] = ',';
+  _messageLength += snprintf(_message + _messageLength, MESSAGE_SIZE - _messageLength, "[%lu,\"%.*s\",",
+                             (unsigned long)utc, (int)topicLength, topic);
+  memcpy(_message + _messageLength, json, jsonLength);
+  _messageLength += jsonLength;
+  _message[_messageLength++] = ']';
+  return true;
+}
+
+/**
+ *
+ */
+void HistoryNode::sendMessage() {
+  if (_messageLength <= 1) return;
+
+  _message[_messageLength++] = ']';
+  _message[_messageLength]   = '\0';
+  publishQueue.append(*this, "records", _message, PublishQueue::LOG);
+
+  if (!isPending()) {
+    LOG_INFO << F("✔ history: published, records dropped: ") << _dropped << endl;
+  }
+}
+
+/**
+ *
+ */
+size_t HistoryNode::countRecords(const uint8_t* p, size_t length) {
+  size_t count = 0;
+  for (size_t offset = 0; offset < length; count++) {
+    offset += 6 + p[offset + 4] + p[offset + 5 + p[offset + 4]];
+  }
+  return count;
+}
+
+/**
+ * Listener of the publish queue, records the relay and sensor values while
+ * disconnected. Relay values go to the file right away, a reset must not
+ * lose a switching.
+ */
+void HistoryNode::onPublish(void* context, const HomieNode& node, const char* property, const HomieRange& range,
+                            PublishQueue::Priority priority, const String& value) {
+  if (priority > PublishQueue::SENSOR || Homie.isConnected()) return;
+
+  HistoryNode* history = static_cast<HistoryNode*>(context);
+  history->record(node, property, range, value);
+  if (priority == PublishQueue::RELAY && history->_mounted) {
+    history->flush();
+  }
+}
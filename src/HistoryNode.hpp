@@ -0,0 +1,80 @@
+/**
+ * Homie Node with the readings and relay transitions of an MQTT or WiFi
+ * outage, published once the controller is connected again.
+ *
+ * While Homie is disconnected, every value the nodes hand to the publish
+ * queue in the relay and sensor classes is recorded with its UTC time:
+ * in a RAM buffer, which is appended to /history.bin on the file system
+ * when it is full, once a minute and right after a relay value. An outage
+ * of hours fits in, a reset during it loses the readings of up to
+ * FLUSH_PERIOD, no relay transitions. Records go in only once the clock is
+ * valid, the file stops growing at MAX_FILE_SIZE and the records beyond
+ * are dropped.
+ *
+ * Once connected, the records are published in order, oldest first, as
+ * batches on the history topic, one every REPLAY_PERIOD ms and only while
+ * the publish queue has room for logs:
+ *
+ *   [[1735689600,"pool-temp/tempSucPool",77.50],[1735689600,"pool-pump/switch",true],..]
+ *
+ * The retained property topics aren't written with old values, they get
+ * the last value of the outage through the queue as usual.
+ *
+ * Record: u32 UTC, u8 length, "node/property" (with "_index" for ranges),
+ * u8 length, value. Little endian.
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include "PublishQueue.hpp"
+
+class HistoryNode : public HomieNode {
+
+public:
+  static const size_t   BUFFER_SIZE   = 1024;
+  static const size_t   MESSAGE_SIZE  = 768;
+  static const size_t   MAX_FILE_SIZE = 128 * 1024UL;
+  static constexpr size_t MAX_TOPIC   = 64;  // constexpr: min() takes it by reference
+  static const uint32_t FLUSH_PERIOD  = 60000UL;  // in ms
+  static const uint32_t REPLAY_PERIOD = 2000UL;   // in ms
+
+  static const char* const FILE_PATH;
+
+  HistoryNode(const char* id, const char* name);
+
+  uint32_t getRecorded() const { return _recorded; }
+  uint32_t getDropped() const { return _dropped; }
+  bool     isPending() const { return _filePending || _ramOffset < _length; }
+
+protected:
+  void setup() override;
+  void loop() override;
+
+private:
+  uint8_t       _buffer[BUFFER_SIZE];
+  size_t        _length      = 0;
+  size_t        _ramOffset   = 0;  // of the next record to publish
+  uint32_t      _fileOffset  = 0;
+  bool          _filePending = false;
+  bool          _mounted     = false;
+  unsigned long _lastFlush   = 0;
+  unsigned long _lastReplay  = 0;
+  uint32_t      _recorded    = 0;
+  uint32_t      _dropped     = 0;
+
+  char   _message[MESSAGE_SIZE];
+  size_t _messageLength = 0;
+
+  void record(const HomieNode& node, const char* property, const HomieRange& range, const String& value);
+  void flush();
+  void replay();
+  bool replayFile();
+  void replayBuffer();
+  bool addRecord(uint32_t utc, const char* topic, size_t topicLength, const char* value, size_t valueLength);
+  void sendMessage();
+
+  static size_t countRecords(const uint8_t* p, size_t length);
+  static void   onPublish(void* context, const HomieNode& node, const char* property, const HomieRange& range,
+                          PublishQueue::Priority priority, const String& value);
+};
@@ -0,0 +1,41 @@
+/**
+ * Property values as JSON: numbers, true, false, objects and arrays as they
+ * are, anything else as a string without the characters it can't hold.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace JsonValue {
+
+/**
+ * Not terminated, strings are truncated.
+ * @return length, 0 if a value that goes in as it is doesn't fit
+ */
+inline size_t format(char* buffer, size_t size, const char* value) {
+  const size_t length = strlen(value);
+
+  bool raw = strcmp(value, "true") == 0 || strcmp(value, "false") == 0 || value[0] == '{' || value[0] == '[';
+  if (!raw && length > 0 && strspn(value, "0123456789.-+eE") == length) {
+    char* end;
+    strtod(value, &end);
+    raw = (*end == '\0');
+  }
+
+  if (raw) {
+    if (length >= size) return 0;
+    memcpy(buffer, value, length);
+    return length;
+  }
+
+  size_t pos    = 0;
+  buffer[pos++] = '"';
+  for (; *value && pos + 2 < size; value++) {
+    if (*value != '"' && *value != '\\' && (uint8_t)*value >= 0x20) buffer[pos++] = *value;
+  }
+  buffer[pos++] = '"';
+  return pos;
+}
+
+}  // namespace JsonValue
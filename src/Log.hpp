@@ -0,0 +1,54 @@
+/**
+ * Logging facade for the serial log of all nodes.
+ *
+ *   LOG_DEBUG << cIndent << F("Temperature=") << temp << endl;
+ *
+ * Statements below LOG_MIN_LEVEL (a build flag, e.g. -D LOG_MIN_LEVEL=1 for
+ * INFO) are dead code after constant folding: the formatting code and its
+ * string literals are not part of the firmware. Statements above it are
+ * filtered at runtime by the LoggerNode level, without evaluating the
+ * streamed expressions.
+ *
+ * LOGB_xxx(id, args...) is the binary counterpart for hot, fixed-format
+ * lines, see BinaryLog.hpp: same filtering, but only the format id and the
+ * raw arguments are stored.
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include "BinaryLog.hpp"
+#include "LoggerNode.hpp"
+
+namespace Log {
+
+constexpr bool isCompiled(const LoggerNode::E_Loglevel level) {
+  return level >= LOG_MIN_LEVEL;
+}
+
+inline bool isEnabled(const LoggerNode::E_Loglevel level) {
+  return isCompiled(level) && LoggerNode::loglevel(level);
+}
+
+}  // namespace Log
+
+// the if/else form keeps a following else bound to the caller's if
+#define LOG_AT(level) \
+  if (!Log::isEnabled(level)) { \
+  } else \
+    Homie.getLogger()
+
+#define LOG_DEBUG LOG_AT(LoggerNode::DEBUG)
+#define LOG_INFO LOG_AT(LoggerNode::INFO)
+#define LOG_WARNING LOG_AT(LoggerNode::WARNING)
+#define LOG_ERROR LOG_AT(LoggerNode::ERROR)
+
+#define LOGB_AT(level, id, ...) \
+  do { \
+    if (Log::isEnabled(level)) binaryLog.record(level, LogFormat::id, ##__VA_ARGS__); \
+  } while (0)
+
+#define LOGB_DEBUG(id, ...) LOGB_AT(LoggerNode::DEBUG, id, ##__VA_ARGS__)
+#define LOGB_INFO(id, ...) LOGB_AT(LoggerNode::INFO, id, ##__VA_ARGS__)
+#define LOGB_WARNING(id, ...) LOGB_AT(LoggerNode::WARNING, id, ##__VA_ARGS__)
+#define LOGB_ERROR(id, ...) LOGB_AT(LoggerNode::ERROR, id, ##__VA_ARGS__)
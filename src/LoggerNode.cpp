@@ -7,6 +7,14 @@
 
 #include "LoggerNode.hpp"
 #include <Homie.hpp>
+#include "SerialLogBuffer.hpp"
+#include "BinaryLog.hpp"
+#include "CrashLog.hpp"
+#include "PropertyHash.hpp"
+#include "PublishQueue.hpp"
+#ifdef ESP32
+#include <esp_system.h>
+#endif
 
 HomieSetting<const char*> LoggerNode::default_loglevel("loglevel", "default loglevel");  // id, description
 HomieSetting<bool> LoggerNode::logserial("logserial", "log to serial");  // id, description
@@ -14,17 +22,25 @@ HomieSetting<bool> LoggerNode::flushlog("flushlog", "Flush serial log after each
 
 
 LoggerNode::LoggerNode() :
-		HomieNode("Log", "Logger", "Logger"), m_loglevel(DEBUG), logSerial(true), logJSON(true) {
+		HomieNode("Log", "Logger", "Logger"), m_head(0), m_count(0), m_dropped(0), m_lastStats(0), m_lastFlush(0), m_lastToken(0), m_tokens(TOKEN_BURST), logSerial(true), logBinary(false) {
 	default_loglevel.setDefaultValue(levelstring[DEBUG].c_str()).setValidator([] (const char* candidate) {
 		return convertToLevel(String(candidate)) != INVALID;
 	});
 	logserial.setDefaultValue(true);
 	flushlog.setDefaultValue(false);
-	advertise("log").setName("log output").setDatatype("String");
+	advertise("log").setName("log output, JSON array").setDatatype("String");
 	advertise("Level").settable().setName("Loglevel").setDatatype("enum").setFormat(LoggerNode::getLevelStrings().c_str());
 	advertise("LogSerial").settable().setName("log to serial interface").setDatatype("boolean");
+	advertise("LogBinary").settable().setName("publish binary log records").setDatatype("boolean");
+	advertise("logbin").setName("binary log output").setDatatype("String");
+	advertise("crash").setName("last records before the reset").setDatatype("String");
+	advertise("Dropped").setName("log records dropped").setDatatype("integer");
+	advertise("SerialDropped").setName("serial log lines dropped").setDatatype("integer");
+	advertise("LogTime").setName("max. time spent logging per loop").setDatatype("integer").setUnit("µs");
 }
 
+LoggerNode::E_Loglevel LoggerNode::m_loglevel = DEBUG;
+
 const String LoggerNode::levelstring[CRITICAL+1] = { "DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL" };
 
 const String& LoggerNode::getLevelStrings() {
@@ -52,53 +68,241 @@ void LoggerNode::setup() {
 }
 
 void LoggerNode::onReadyToOperate() {
-	setProperty("Level").send(levelstring[m_loglevel]);
-	setProperty("LogSerial").send(logSerial? "true":"false");
+	publishQueue.send(*this, "Level", levelstring[m_loglevel], PublishQueue::SETTING);
+	publishQueue.send(*this, "LogSerial", logSerial? "true":"false", PublishQueue::SETTING);
+	publishQueue.send(*this, "LogBinary", logBinary? "true":"false", PublishQueue::SETTING);
 }
 
 
-void LoggerNode::log(const String& function, const E_Loglevel level, const String& text) const {
-	if (!loglevel(level)) return;
-	if (Homie.isConnected()) {
-		String message;
-		String mqtt_path("log");
-		if (logJSON) {
-			message.concat("{\"Level\": \"");
-			message.concat(levelstring[level]);
-			message.concat("\",\"Function\": \"");
-			message.concat(function);
-			message.concat("\",\"Message\": \"");
-			message.concat(text);
-			message.concat("\"}");
-		} else {
-			mqtt_path.concat('/');
-			mqtt_path.concat(levelstring[level]);
-			mqtt_path.concat('/');
-			mqtt_path.concat(function);
-			message = text;
+void LoggerNode::loop() {
+	PROFILE_SCOPE(m_loopStats);
+	if (millis() - m_lastStats >= STATS_INTERVAL) {
+		m_lastStats = millis();
+		publishQueue.send(*this, "Dropped", String(m_dropped + binaryLog.getDropped()), PublishQueue::LOG);
+		publishQueue.send(*this, "SerialDropped", String(serialLog.getDropped()), PublishQueue::LOG);
+		publishQueue.send(*this, "LogTime", String(serialLog.getMaxLoopTime()), PublishQueue::LOG);
+		serialLog.resetMaxLoopTime();
+	}
+}
+
+/*
+ * Forwards the waiting records to MQTT: one JSON array per FLUSH_INTERVAL,
+ * and only while the token bucket allows another publish and the publish
+ * queue has room for it. Called from the
+ * main loop after Homie.loop(), so the control publishes of the nodes are
+ * queued ahead of the log traffic of the same pass.
+ */
+void LoggerNode::flush() {
+	PROFILE_SCOPE(m_flushStats);
+	// refill the token bucket
+	while (m_tokens < TOKEN_BURST && millis() - m_lastToken >= TOKEN_INTERVAL) {
+		m_tokens++;
+		m_lastToken += TOKEN_INTERVAL;
+	}
+	if (m_tokens == TOKEN_BURST) m_lastToken = millis();
+
+	// binary records become text, unless they're forwarded as they are
+	if (!logBinary || !Homie.isConnected()) {
+		BinaryLog::Record binary;
+		for (uint_fast8_t i = 0; i < DRAIN_PER_LOOP && binaryLog.read(binary); i++) {
+			drainBinary(binary);
 		}
-		setProperty(mqtt_path).send(message);
 	}
-	if (logSerial || !Homie.isConnected()) {
-		Serial.printf("%ld [%s]: %s: %s\n",millis(), levelstring[level].c_str(), function.c_str(), text.c_str());
-		if (flushlog.get()) Serial.flush();
+
+	// a full publish queue keeps the records here
+	if (!Homie.isConnected() || millis() - m_lastFlush < FLUSH_INTERVAL || !publishQueue.hasRoom(PublishQueue::LOG)) return;
+
+	if (m_count > 0 && m_tokens > 0) {
+		publishBatch();
+		m_tokens--;
+		m_lastFlush = millis();
+	}
+	if (logBinary && !binaryLog.isEmpty() && m_tokens > 0 && publishQueue.hasRoom(PublishQueue::LOG)) {
+		publishBinaryBatch();
+		m_tokens--;
+		m_lastFlush = millis();
 	}
+
+	// lowest priority: only when the log is idle and the bucket is full
+	if (crashLog.hasReport() && m_count == 0 && m_tokens == TOKEN_BURST && publishQueue.hasRoom(PublishQueue::LOG)) {
+		publishCrashReport();
+		m_tokens--;
+		m_lastFlush = millis();
+	}
+}
+
+/*
+ * What the previous boot did last, from the crash log. Records decode with
+ * tools/logdecode.py.
+ */
+void LoggerNode::publishCrashReport() {
+#ifdef ESP32
+	size_t length = snprintf(m_message, sizeof(m_message), "{\"Reason\":%d,\"Phase\":\"%s\",\"Records\":\"",
+			(int) esp_reset_reason(), crashLog.getReportPhase());
+#else
+	size_t length = snprintf(m_message, sizeof(m_message), "{\"Reason\":\"%s\",\"Phase\":\"%s\",\"Records\":\"",
+			ESP.getResetReason().c_str(), crashLog.getReportPhase());
+#endif
+	length += crashLog.reportToHex(m_message + length, sizeof(m_message) - length - 3);
+	snprintf(m_message + length, sizeof(m_message) - length, "\"}");
+
+	publishQueue.append(*this, "crash", m_message, PublishQueue::LOG);
+	crashLog.clearReport();
 }
 
-void LoggerNode::logf(const String& function, const E_Loglevel level, const char* format, ...) const {
+/*
+ * Copies the message into the ring, no heap allocation. The oldest record is
+ * overwritten (and counted) if MQTT can't keep up.
+ */
+void LoggerNode::log(const char* function, const E_Loglevel level, const char* text) const {
 	if (!loglevel(level)) return;
+	LogRecord* record = reserve(function, level);
+	strncpy(record->text, text, TEXT_LEN - 1);
+	record->text[TEXT_LEN - 1] = '\0';
+	commit(*record);
+}
+
+void LoggerNode::logf(const char* function, const E_Loglevel level, const char* format, ...) const {
+	if (!loglevel(level)) return;
+	LogRecord* record = reserve(function, level);
 	va_list arg;
 	va_start(arg, format);
-	char temp[100];
-	//size_t len = vsnprintf(temp, sizeof(temp), format, arg);
+	vsnprintf(record->text, TEXT_LEN, format, arg);
 	va_end(arg);
-	log(function, level, temp);
+	commit(*record);
+}
+
+LoggerNode::LogRecord* LoggerNode::reserve(const char* function, const E_Loglevel level) const {
+	if (m_count == RING_SIZE) {
+		m_head = (m_head + 1) % RING_SIZE;
+		m_count--;
+		m_dropped++;
+	}
+	LogRecord* record = &m_ring[(m_head + m_count) % RING_SIZE];
+	record->time = millis();
+	record->level = level;
+	strncpy(record->function, function, FUNCTION_LEN - 1);
+	record->function[FUNCTION_LEN - 1] = '\0';
+	return record;
+}
+
+void LoggerNode::commit(const LogRecord& record) const {
+	m_count++;
+	if (logSerial || !Homie.isConnected()) {
+		serialLog.print(record.time);
+		serialLog.print(F(" ["));
+		serialLog.print(levelstring[record.level]);
+		serialLog.print(F("]: "));
+		serialLog.print(record.function);
+		serialLog.print(F(": "));
+		serialLog.println(record.text);
+		if (flushlog.get()) serialLog.flush();
+	}
+}
+
+/*
+ * Formats a binary record into the text ring.
+ */
+void LoggerNode::drainBinary(const BinaryLog::Record& binary) {
+	char name[FUNCTION_LEN];
+	BinaryLog::getName(binary.id, name, sizeof(name));
+	LogRecord* record = reserve(name, (E_Loglevel) binary.level);
+	record->time = binary.time;
+	BinaryLog::format(record->text, TEXT_LEN, binary);
+	commit(*record);
+}
+
+/*
+ * Publishes as many records as fit into the buffer as one JSON array,
+ * the rest waits for the next flush.
+ */
+void LoggerNode::publishBatch() {
+	size_t length = 1;
+	m_message[0] = '[';
+
+	while (m_count > 0) {
+		const LogRecord& record = m_ring[m_head];
+
+		// worst case: every char escaped, plus the closing bracket; the rest waits
+		const size_t needed = 80 + 2 * (strlen(record.function) + strlen(record.text));
+		if (length + needed >= sizeof(m_message)) break;
+
+		if (length > 1) m_message[length++] = ',';
+		length += snprintf(m_message + length, sizeof(m_message) - length, "{\"Time\":%lu,\"Level\":\"%s\",\"Function\":\"",
+				(unsigned long) record.time, levelstring[record.level].c_str());
+		length = appendEscaped(m_message, length, sizeof(m_message), record.function);
+		length += snprintf(m_message + length, sizeof(m_message) - length, "\",\"Message\":\"");
+		length = appendEscaped(m_message, length, sizeof(m_message), record.text);
+		length += snprintf(m_message + length, sizeof(m_message) - length, "\"}");
+
+		m_head = (m_head + 1) % RING_SIZE;
+		m_count--;
+	}
+
+	m_message[length++] = ']';
+	m_message[length] = '\0';
+	publishQueue.append(*this, "log", m_message, PublishQueue::LOG);
+}
+
+/*
+ * Publishes the wire format of the waiting binary records, concatenated as
+ * hex, for tools/logdecode.py.
+ */
+void LoggerNode::publishBinaryBatch() {
+	static const size_t MAX_HEX = (2 + BinaryLog::MAX_ARGS) * 8;
+
+	size_t length = 0;
+	BinaryLog::Record binary;
+	while (length + MAX_HEX < sizeof(m_message) && binaryLog.read(binary)) {
+		length += BinaryLog::toHex(m_message + length, sizeof(m_message) - length, binary);
+
+		if (logSerial) {
+			char text[TEXT_LEN];
+			BinaryLog::format(text, sizeof(text), binary);
+			serialLog.print(binary.time);
+			serialLog.print(F(" ["));
+			serialLog.print(levelstring[binary.level]);
+			serialLog.print(F("]: "));
+			serialLog.println(text);
+		}
+	}
+
+	publishQueue.append(*this, "logbin", m_message, PublishQueue::LOG);
+}
+
+/*
+ * Appends text as JSON string content, truncated to the buffer.
+ */
+size_t LoggerNode::appendEscaped(char* buffer, size_t pos, size_t size, const char* text) {
+	for (; *text && pos + 2 < size; text++) {
+		if (*text == '"' || *text == '\\') {
+			buffer[pos++] = '\\';
+			buffer[pos++] = *text;
+		} else if ((uint8_t) *text >= 0x20) {
+			buffer[pos++] = *text;
+		}
+	}
+	buffer[pos] = '\0';
+	return pos;
 }
 
 
 bool LoggerNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+	PROFILE_SCOPE(m_inputStats);
 	this->logf("LoggerNode::handleInput()", LoggerNode::DEBUG,	"property %s set to %s", property.c_str(), value.c_str());
-	if (property.equals("Level") /* || property.equals("DefaultLevel") */) {
+	enum { NONE, LEVEL, LOG_BINARY, LOG_SERIAL } id = NONE;
+	const char* name = "";
+	switch (PropertyHash::of(property)) {
+		case PropertyHash::of("Level"):     id = LEVEL;      name = "Level";     break;
+		case PropertyHash::of("LogBinary"): id = LOG_BINARY; name = "LogBinary"; break;
+		case PropertyHash::of("LogSerial"): id = LOG_SERIAL; name = "LogSerial"; break;
+	}
+	if (id == NONE || strcmp(property.c_str(), name) != 0) {
+		logf("LoggerNode::handleInput()", ERROR, "Received invalid property %s with value %s", property.c_str(),	value.c_str());
+		return false;
+	}
+
+	if (id == LEVEL) {
 		E_Loglevel newLevel = convertToLevel(value);
 		if (newLevel == INVALID) {
 			logf("LoggerNode::handleInput()", WARNING , "Received invalid level %s.", value.c_str());
@@ -106,17 +310,20 @@ bool LoggerNode::handleInput(const HomieRange& range, const String& property, co
 		}
 		m_loglevel = newLevel;
 		logf("LoggerNode::handleInput()", INFO, "New loglevel set to %d", m_loglevel);
-		setProperty("Level").send(levelstring[m_loglevel]);
+		publishQueue.send(*this, "Level", levelstring[m_loglevel], PublishQueue::SETTING);
 		return true;
-	} else if (property.equals("LogSerial")) {
-		bool on = value.equalsIgnoreCase("ON") || value.equalsIgnoreCase("true");
+	}
+
+	const bool on = strcasecmp(value.c_str(), "ON") == 0 || strcasecmp(value.c_str(), "true") == 0;
+	if (id == LOG_BINARY) {
+		logBinary = on;
+		publishQueue.send(*this, "LogBinary", logBinary ? "true" : "false", PublishQueue::SETTING);
+	} else {
 		logSerial = on;
 		this->logf("LoggerNode::handleInput()", LoggerNode::INFO, "Received command to switch 'Log to serial' %s.", on ? "On" : "Off");
-		setProperty("LogSerial").send(on ? "true" : "false");
-		return true;
+		publishQueue.send(*this, "LogSerial", on ? "true" : "false", PublishQueue::SETTING);
 	}
-	logf("LoggerNode::handleInput()", ERROR, "Received invalid property %s with value %s", property.c_str(),	value.c_str());
-	return false;
+	return true;
 }
 
 LoggerNode::E_Loglevel LoggerNode::convertToLevel(const String& level) {
@@ -7,6 +7,13 @@
 #pragma once
 
 #include "HomieNode.hpp"
+#include "BinaryLog.hpp"
+#include "LoopProfiler.hpp"
+
+// lowest level compiled into the firmware, see Log.hpp
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0  // DEBUG
+#endif
 
 
 class LoggerNode: public HomieNode {
@@ -14,7 +21,7 @@ public:
 	LoggerNode();
 
 	virtual void setup() override;
-	//virtual void loop() override; // loop() not necessary
+	virtual void loop() override;
 	virtual void onReadyToOperate() override;
 	virtual bool handleInput(const HomieRange& range, const String  &property, const String &value) override;
 
@@ -22,21 +29,55 @@ public:
 		INVALID=-1, DEBUG=0, INFO, WARNING, ERROR, CRITICAL
 	};
 
-	void log(const String& function, const E_Loglevel level, const String& text) const;
-	void logf(const String& function, const E_Loglevel level, const char *format, ...) const;
+	void log(const char* function, const E_Loglevel level, const char* text) const;
+	void logf(const char* function, const E_Loglevel level, const char *format, ...) const __attribute__ ((format (printf, 4, 5)));
+
+	void flush();
+
+	uint32_t getDropped() const { return m_dropped; }
 
-	bool loglevel(E_Loglevel l) const {
-		return ((uint_fast8_t) l >= (uint_fast8_t) m_loglevel);
+	static bool loglevel(E_Loglevel l) {
+		return l >= LOG_MIN_LEVEL && ((uint_fast8_t) l >= (uint_fast8_t) m_loglevel);
 	}
 
+	static E_Loglevel getLoglevel() { return m_loglevel; }
+
 	void setLoglevel(E_Loglevel l) {
 		if (l >= DEBUG && l <= CRITICAL) m_loglevel = l;
 	}
 
 private:
-	E_Loglevel m_loglevel;
+	// records waiting for MQTT, written by log(), sent by flush()
+	static const uint8_t RING_SIZE = 8;
+	static const uint8_t FUNCTION_LEN = 32;
+	static const uint8_t TEXT_LEN = 96;
+	static const uint8_t DRAIN_PER_LOOP = 2;
+	static const unsigned long STATS_INTERVAL = 60000;  // in ms
+	static const unsigned long FLUSH_INTERVAL = 1000;   // in ms, batching window
+	// token bucket: bursts of TOKEN_BURST publishes, then one per TOKEN_INTERVAL
+	static const uint8_t TOKEN_BURST = 4;
+	static const unsigned long TOKEN_INTERVAL = 5000;  // in ms
+
+	struct LogRecord {
+		uint32_t time;
+		E_Loglevel level;
+		char function[FUNCTION_LEN];
+		char text[TEXT_LEN];
+	};
+
+	mutable LogRecord m_ring[RING_SIZE];
+	mutable uint8_t m_head;  // next record to publish
+	mutable uint8_t m_count;
+	mutable uint32_t m_dropped;
+	unsigned long m_lastStats;
+	unsigned long m_lastFlush;
+	unsigned long m_lastToken;
+	uint8_t m_tokens;
+	char m_message[1024];  // holds a worst case record: every char escaped
+
+	static E_Loglevel m_loglevel;  // shared with the LOG_xxx macros
 	bool logSerial;
-	bool logJSON;
+	bool logBinary;
 	static const String levelstring[CRITICAL + 1 ];
 	static HomieSetting<const char*> default_loglevel;
 	static HomieSetting<bool> logserial;
@@ -45,4 +86,18 @@ private:
 	static E_Loglevel convertToLevel(const String& level);
 	static const String& getLevelStrings();
 
+	LogRecord* reserve(const char* function, const E_Loglevel level) const;
+	void commit(const LogRecord& record) const;
+	void publishBatch();
+	void publishBinaryBatch();
+	void publishCrashReport();
+	void drainBinary(const BinaryLog::Record& binary);
+	static size_t appendEscaped(char* buffer, size_t pos, size_t size, const char* text);
+
+
+#ifdef LOOP_PROFILING
+	LoopStats m_loopStats{getId(), "loop"};
+	LoopStats m_inputStats{getId(), "input"};
+	LoopStats m_flushStats{getId(), "flush"};
+#endif
 };
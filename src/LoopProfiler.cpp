@@ -0,0 +1,53 @@
+/**
+ * Loop timing instrumentation.
+ */
+
+#include "LoopProfiler.hpp"
+
+#ifdef LOOP_PROFILING
+
+LoopStats* LoopStats::_stats[MAX_STATS];
+uint8_t    LoopStats::_statsCount = 0;
+
+/**
+ * Registers the statistics for the diagnostics node. Instances are static
+ * or members of static nodes, they live as long as the firmware runs.
+ */
+LoopStats::LoopStats(const char* owner, const char* kind) {
+  snprintf(_property, sizeof(_property), "%s-%s", owner, kind);
+  reset();
+
+  if (_statsCount < MAX_STATS) {
+    _stats[_statsCount++] = this;
+  }
+}
+
+/**
+ *
+ */
+void LoopStats::add(uint32_t cycles) {
+  const uint32_t micros = cycles / ESP.getCpuFreqMHz();
+
+  _count++;
+  _sum += micros;
+  if (micros < _min) _min = micros;
+  if (micros > _max) _max = micros;
+
+  // bucket = number of significant bits
+  uint8_t bucket = (micros == 0) ? 0 : 32 - __builtin_clz(micros);
+  if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+  if (_histogram[bucket] < UINT16_MAX) _histogram[bucket]++;
+}
+
+/**
+ * Starts a new reporting window.
+ */
+void LoopStats::reset() {
+  _count = 0;
+  _min   = UINT32_MAX;
+  _max   = 0;
+  _sum   = 0;
+  memset(_histogram, 0, sizeof(_histogram));
+}
+
+#endif
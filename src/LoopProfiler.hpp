@@ -0,0 +1,75 @@
+/**
+ * Loop timing instrumentation, enabled by the build flag LOOP_PROFILING.
+ *
+ *   class MyNode : public HomieNode {
+ *   #ifdef LOOP_PROFILING
+ *     LoopStats _loopStats{getId(), "loop"};
+ *   #endif
+ *   };
+ *
+ *   void MyNode::loop() {
+ *     PROFILE_SCOPE(_loopStats);
+ *     ...
+ *
+ * A scope reads the CPU cycle counter on entry and exit. The duration goes
+ * into fixed per-instance statistics: count, min, mean, max and a log2
+ * histogram in µs. Without the flag the macro and the members vanish.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef LOOP_PROFILING
+
+class LoopStats {
+
+public:
+  static const uint8_t MAX_STATS = 32;
+  static const uint8_t BUCKETS   = 16;  // [0], [1], [2..3], ... [16384..] µs
+
+  LoopStats(const char* owner, const char* kind);
+
+  void add(uint32_t cycles);
+  void reset();
+
+  const char* getProperty() const { return _property; }
+  uint32_t    getCount() const { return _count; }
+  uint32_t    getMin() const { return _count > 0 ? _min : 0; }
+  uint32_t    getMax() const { return _max; }
+  uint32_t    getMean() const { return _count > 0 ? _sum / _count : 0; }
+  uint16_t    getBucket(uint8_t bucket) const { return _histogram[bucket]; }
+
+  static uint8_t    getStatsCount() { return _statsCount; }
+  static LoopStats* getStats(uint8_t index) { return _stats[index]; }
+
+private:
+  char     _property[24];  // Homie property id: <owner>-<kind>
+  uint32_t _count;
+  uint32_t _min;  // in µs
+  uint32_t _max;
+  uint64_t _sum;
+  uint16_t _histogram[BUCKETS];
+
+  static LoopStats* _stats[MAX_STATS];
+  static uint8_t    _statsCount;
+};
+
+class LoopScope {
+
+public:
+  explicit LoopScope(LoopStats& stats) : _stats(stats), _start(ESP.getCycleCount()) {}
+  ~LoopScope() { _stats.add(ESP.getCycleCount() - _start); }
+
+private:
+  LoopStats&     _stats;
+  const uint32_t _start;
+};
+
+#define PROFILE_SCOPE(stats) LoopScope _loopScope(stats)
+
+#else
+
+#define PROFILE_SCOPE(stats)
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ * Local monotonic clock disciplined by NTP.
+ *
+ * Protocol: https://tools.ietf.org/html/rfc5905
+ */
+
+#include "NtpClock.hpp"
+#include "Log.hpp"
+#include <Homie.hpp>
+
+#ifdef ESP32
+#include <WiFi.h>
+#include <lwip/tcpip.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#endif
+
+/**
+ * @param server        NTP server or pool name
+ * @param syncInterval  seconds between two successful synchronisations
+ */
+NtpClock::NtpClock(const char* server, const unsigned long syncInterval) {
+  _server       = server;
+  _syncInterval = syncInterval;
+}
+
+/**
+ *
+ */
+void NtpClock::begin() {
+  _state       = IDLE;
+  _nextAttempt = millis();
+}
+
+/**
+ * Drives the request/reply state machine. Never waits for the network.
+ */
+void NtpClock::loop() {
+  if (WiFi.status() != WL_CONNECTED) {
+    if (_state != IDLE) {
+      _state = IDLE;
+      scheduleRetry();
+    }
+    return;
+  }
+
+  if (_state == IDLE) {
+    if ((long)(millis() - _nextAttempt) >= 0) {
+      if ((uint32_t)_serverIp == 0) {
+        if (startLookup()) {
+          _state = RESOLVING;
+        } else {
+          scheduleRetry();
+        }
+      } else if (sendRequest()) {
+        _state = WAITING;
+      } else {
+        scheduleRetry();
+      }
+    }
+    return;
+  }
+
+  if (_state == RESOLVING) {
+    if (_lookupDone && _lookupAddress != 0) {
+      _serverIp = IPAddress(_lookupAddress);
+      _state    = sendRequest() ? WAITING : IDLE;
+      if (_state == IDLE) scheduleRetry();
+
+    } else if (_lookupDone || millis() - _requestMillis >= LOOKUP_TIMEOUT) {
+      _state = IDLE;
+      LOG_WARNING << cIndent << F("✖ NTP: lookup failed for ") << _server << endl;
+      scheduleRetry();
+    }
+    return;
+  }
+
+  // WAITING
+  uint64_t      epochMs;
+  unsigned long receiveMillis = millis();
+
+  if (readReply(epochMs)) {
+    _state = IDLE;
+    applySync(epochMs, receiveMillis);
+
+  } else if (receiveMillis - _requestMillis >= REPLY_TIMEOUT) {
+    _state = IDLE;
+    LOG_WARNING << cIndent << F("✖ NTP: no reply from ") << _server << endl;
+    if (++_timeouts >= MAX_TIMEOUTS) {
+      // the pool may have handed out a dead server
+      _serverIp = IPAddress();
+      _timeouts = 0;
+    }
+    scheduleRetry();
+  }
+}
+
+/**
+ * Starts the lookup of the server name, loop() picks up the address.
+ */
+bool NtpClock::startLookup() {
+  _lookupDone    = false;
+  _lookupAddress = 0;
+  _requestMillis = millis();
+#ifdef ESP32
+  // lwIP runs in its own task
+  return tcpip_callback(lookup, this) == ERR_OK;
+#else
+  lookup(this);
+  return true;
+#endif
+}
+
+/**
+ * Answers from the resolver's cache right away, else from onLookup() later.
+ */
+void NtpClock::lookup(void* context) {
+  NtpClock*   clock = static_cast<NtpClock*>(context);
+  ip_addr_t   address;
+  const err_t result = dns_gethostbyname(clock->_server, &address, onLookup, clock);
+  if (result == ERR_OK) {
+    onLookup(clock->_server, &address, clock);
+  } else if (result != ERR_INPROGRESS) {
+    onLookup(clock->_server, NULL, clock);
+  }
+}
+
+/**
+ * @param address NULL if the lookup failed
+ */
+void NtpClock::onLookup(const char* name, const ip_addr_t* address, void* context) {
+  NtpClock* clock       = static_cast<NtpClock*>(context);
+  clock->_lookupAddress = (address != NULL) ? ip4_addr_get_u32(ip_2_ip4(address)) : 0;
+  clock->_lookupDone    = true;
+}
+
+/**
+ * Sends one client request to the resolved server.
+ */
+bool NtpClock::sendRequest() {
+  if (!_udpStarted) {
+    _udpStarted = _udp.begin(LOCAL_PORT);
+    if (!_udpStarted) return false;
+  }
+
+  // drop stale replies of an earlier, timed out request
+  while (_udp.parsePacket() > 0) {
+  }
+
+  memset(_packet, 0, NTP_PACKET_SIZE);
+  _packet[0] = 0b11100011;  // LI = unsynchronised, version 4, mode client
+  _packet[2] = 6;           // polling interval
+  _packet[3] = 0xEC;        // peer clock precision
+
+  if (!_udp.beginPacket(_serverIp, NTP_PORT)) return false;
+  _udp.write(_packet, NTP_PACKET_SIZE);
+  if (!_udp.endPacket()) return false;
+
+  _requestMillis = millis();
+  return true;
+}
+
+/**
+ * Reads a pending reply, if any.
+ *
+ * @return true with epochMs set to the server transmit time when a valid reply was read
+ */
+bool NtpClock::readReply(uint64_t& epochMs) {
+  if (_udp.parsePacket() < NTP_PACKET_SIZE) return false;
+
+  if (_udp.read(_packet, NTP_PACKET_SIZE) < NTP_PACKET_SIZE) return false;
+
+  const uint8_t leap    = _packet[0] >> 6;
+  const uint8_t mode    = _packet[0] & 0x07;
+  const uint8_t stratum = _packet[1];
+  if (leap == 3 || mode != 4 || stratum == 0 || stratum > 15) {
+    LOG_WARNING << cIndent << F("✖ NTP: server not synchronised, stratum ") << stratum << endl;
+    _serverIp = IPAddress();  // another server of the pool on the next attempt
+    return false;
+  }
+
+  const uint32_t seconds  = ((uint32_t)_packet[40] << 24) | ((uint32_t)_packet[41] << 16) | ((uint32_t)_packet[42] << 8) | _packet[43];
+  const uint32_t fraction = ((uint32_t)_packet[44] << 24) | ((uint32_t)_packet[45] << 16) | ((uint32_t)_packet[46] << 8) | _packet[47];
+  if (seconds <= SEVENTY_YEARS) return false;
+
+  epochMs = (uint64_t)(seconds - SEVENTY_YEARS) * 1000ULL + (((uint64_t)fraction * 1000ULL) >> 32);
+  return true;
+}
+
+/**
+ * Takes over a new reference time and updates the drift estimate.
+ */
+void NtpClock::applySync(uint64_t epochMs, unsigned long receiveMillis) {
+  _lastRoundTrip = receiveMillis - _requestMillis;
+
+  // the server stamped its reply about half a round trip before it arrived
+  const uint64_t measured = epochMs + _lastRoundTrip / 2;
+
+  if (isValid()) {
+    const uint64_t      predicted = predictMillis(receiveMillis);
+    const unsigned long span      = receiveMillis - _syncMillis;
+    _lastCorrection               = (long)((int64_t)measured - (int64_t)predicted);
+
+    if (span >= DRIFT_MIN_SPAN) {
+      // residual error after the current drift correction, in ppm of the span
+      long ppm  = _driftPpm + (long)((int64_t)_lastCorrection * 1000000LL / (int64_t)span);
+      ppm       = constrain(ppm, -DRIFT_LIMIT, DRIFT_LIMIT);
+      _driftPpm = (_syncCount > 1) ? (3 * _driftPpm + ppm) / 4 : ppm;
+    }
+  } else {
+    _lastCorrection = 0;
+  }
+
+  _syncEpochMs = measured;
+  _syncMillis  = receiveMillis;
+  _synced      = true;
+  _syncCount++;
+
+  _retryDelay  = RETRY_MIN;
+  _timeouts    = 0;
+  _nextAttempt = millis() + _syncInterval * 1000UL;
+
+  LOGB_INFO(NTP_SYNCED, _lastRoundTrip, _lastCorrection, _driftPpm);
+}
+
+/**
+ * Exponential backoff between failed attempts.
+ */
+void NtpClock::scheduleRetry() {
+  _failCount++;
+  _nextAttempt = millis() + _retryDelay * 1000UL;
+  _retryDelay  = _retryDelay * 2;
+  if (_retryDelay > RETRY_MAX) _retryDelay = RETRY_MAX;
+  if (_retryDelay > _syncInterval) _retryDelay = _syncInterval;
+}
+
+/**
+ * UTC in ms at local time `at`, extrapolated from the last sync and corrected by the drift estimate.
+ */
+uint64_t NtpClock::predictMillis(unsigned long at) const {
+  const unsigned long elapsed = at - _syncMillis;
+  return _syncEpochMs + elapsed + (int64_t)elapsed * _driftPpm / 1000000LL;
+}
+
+/**
+ * The clock is valid after the first sync and as long as the holdover limit is not exceeded.
+ */
+bool NtpClock::isValid() const {
+  return _synced && (millis() - _syncMillis) < MAX_HOLDOVER * 1000UL;
+}
+
+/**
+ * @return current UTC in ms, 0 if the clock is not valid
+ */
+uint64_t NtpClock::nowMillis() const {
+  return isValid() ? predictMillis(millis()) : 0;
+}
+
+/**
+ * @return current UTC in seconds, 0 if the clock is not valid
+ */
+time_t NtpClock::now() const {
+  return (time_t)(nowMillis() / 1000ULL);
+}
+
+/**
+ *
+ */
+NtpClock::Quality NtpClock::getQuality() const {
+  if (!isValid()) {
+    return NONE;
+  }
+  // missed at least two regular syncs
+  return (millis() - _syncMillis) > 2 * _syncInterval * 1000UL ? HOLDOVER : SYNCED;
+}
+
+/**
+ * @return ms since the last successful sync
+ */
+unsigned long NtpClock::getLastSyncAge() const {
+  return _synced ? millis() - _syncMillis : 0;
+}
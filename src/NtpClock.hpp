@@ -0,0 +1,101 @@
+/**
+ * Local monotonic clock disciplined by NTP.
+ *
+ * The clock keeps an offset between millis() and UTC. "now" is answered from
+ * that offset in constant time without any network I/O. Resynchronisation runs
+ * asynchronously from loop(): a single NTP request is sent and the answer is
+ * picked up on a later pass, so a slow or lost reply never blocks the caller.
+ * The server name is resolved the same way, through the lwIP resolver, and
+ * the address is kept until the server answers badly or a few requests in a
+ * row time out.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <lwip/dns.h>
+#include <time.h>
+
+class NtpClock {
+
+public:
+  enum Quality { NONE, HOLDOVER, SYNCED };
+
+  NtpClock(const char* server, const unsigned long syncInterval = SYNC_INTERVAL);
+
+  void begin();
+  void loop();
+
+  bool     isValid() const;
+  time_t   now() const;
+  uint64_t nowMillis() const;
+
+  void          setSyncInterval(unsigned long interval) { _syncInterval = interval; }
+  unsigned long getSyncInterval() const { return _syncInterval; }
+
+  Quality       getQuality() const;
+  unsigned long getLastSyncAge() const;
+  unsigned long getLastRoundTrip() const { return _lastRoundTrip; }
+  long          getLastCorrection() const { return _lastCorrection; }
+  long          getDriftPpm() const { return _driftPpm; }
+  unsigned int  getSyncCount() const { return _syncCount; }
+  unsigned int  getFailCount() const { return _failCount; }
+
+private:
+  static const unsigned long SYNC_INTERVAL  = 3600;    // in seconds
+  static const unsigned long RETRY_MIN      = 10;      // in seconds
+  static const unsigned long RETRY_MAX      = 300;     // in seconds
+  static const unsigned long MAX_HOLDOVER   = 259200;  // 3 days in seconds, well below the millis() wrap
+  static const unsigned long REPLY_TIMEOUT  = 1500;    // in ms
+  static const unsigned long LOOKUP_TIMEOUT = 5000;    // in ms
+  static const uint8_t       MAX_TIMEOUTS   = 3;       // in a row, then the server name is looked up again
+  static const unsigned long DRIFT_MIN_SPAN = 600000;  // in ms, shorter spans are too noisy to estimate drift
+  static const long          DRIFT_LIMIT    = 500;     // in ppm
+
+  static const uint16_t NTP_PORT        = 123;
+  static const uint16_t LOCAL_PORT      = 2390;
+  static const uint8_t  NTP_PACKET_SIZE = 48;
+  static const uint32_t SEVENTY_YEARS   = 2208988800UL;  // 1900-01-01 to 1970-01-01 in seconds
+
+  const char* cIndent = "  ◦ ";
+
+  enum State { IDLE, RESOLVING, WAITING };
+
+  const char*   _server;
+  IPAddress     _serverIp;
+  uint8_t       _timeouts   = 0;  // in a row
+  WiFiUDP       _udp;
+  bool          _udpStarted = false;
+  State         _state      = IDLE;
+  uint8_t       _packet[NTP_PACKET_SIZE];
+  unsigned long _syncInterval;
+
+  // last sync: UTC in ms at local millis() _syncMillis
+  bool          _synced      = false;
+  uint64_t      _syncEpochMs = 0;
+  unsigned long _syncMillis  = 0;
+
+  unsigned long _requestMillis  = 0;
+  unsigned long _nextAttempt    = 0;
+  unsigned long _retryDelay     = RETRY_MIN;
+  unsigned long _lastRoundTrip  = 0;
+  long          _lastCorrection = 0;
+  long          _driftPpm       = 0;
+  unsigned int  _syncCount      = 0;
+  unsigned int  _failCount      = 0;
+
+  // set by the resolver, on the ESP32 from the lwIP task
+  volatile bool     _lookupDone    = false;
+  volatile uint32_t _lookupAddress = 0;
+
+  bool     startLookup();
+  bool     sendRequest();
+  bool     readReply(uint64_t& epochMs);
+  void     applySync(uint64_t epochMs, unsigned long receiveMillis);
+  void     scheduleRetry();
+  uint64_t predictMillis(unsigned long at) const;
+
+  static void lookup(void* context);
+  static void onLookup(const char* name, const ip_addr_t* address, void* context);
+};
@@ -1,5 +1,8 @@
 
 #include "OperationModeNode.hpp"
+#include "Log.hpp"
+#include "PropertyHash.hpp"
+#include "PublishQueue.hpp"
 #include "RuleManu.hpp"
 #include "RuleAuto.hpp"
 #include "RuleBoost.hpp"
@@ -11,7 +14,6 @@ OperationModeNode::OperationModeNode(const char* id, const char* name, const int
     : HomieNode(id, name, "switch") {
 
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = 0;
 
   //setRunLoopDisconnected(true);
 }
@@ -27,11 +29,11 @@ void OperationModeNode::addRule(Rule* rule) {
  *
  */
 Rule* OperationModeNode::getRule() {
-  Homie.getLogger() << F("getRule: mode=") << _mode << endl;
+  LOG_DEBUG << F("getRule: mode=") << _mode << endl;
 
   for (int i = 0; i < _ruleVec.Size(); i++) {
     if (_mode.equals(_ruleVec[i]->getMode())) {
-      Homie.getLogger() << F("getRule: Active Rule: ") << _ruleVec[i]->getMode() << endl;
+      LOG_DEBUG << F("getRule: Active Rule: ") << _ruleVec[i]->getMode() << endl;
       //update the properties
       _ruleVec[i]->setPoolMaxTemperatur(getPoolMaxTemperature());
       _ruleVec[i]->setSolarMinTemperature(getSolarMinTemperature());
@@ -51,25 +53,82 @@ Rule* OperationModeNode::getRule() {
 /**
  *
  */
-bool OperationModeNode::setMode(String mode) {
+bool OperationModeNode::setMode(const String& mode) {
   bool retval;
 
   if (mode.equals(STATUS_AUTO) || mode.equals(STATUS_MANU) || mode.equals(STATUS_BOOST) || mode.equals(STATUS_TIMER)) {
     _mode = mode;
-    Homie.getLogger() << F("set mode: ") << _mode << endl;
-    setProperty(cMode).send(_mode);
-    setProperty(cHomieNodeState).send(cHomieNodeState_OK);
+    LOG_INFO << F("set mode: ") << _mode << endl;
+    publishQueue.send(*this, cMode, _mode, PublishQueue::SETTING);
+    publishQueue.send(*this, cHomieNodeState, cHomieNodeState_OK, PublishQueue::SETTING);
     retval = true;
 
   } else {
-    Homie.getLogger() << F("✖ UNDEFINED Mode: ") << mode << F(" Current unchanged mode: ") << _mode << endl;
-    setProperty(cHomieNodeState).send(cHomieNodeState_Error);
+    LOG_WARNING << F("✖ UNDEFINED Mode: ") << mode << F(" Current unchanged mode: ") << _mode << endl;
+    publishQueue.send(*this, cHomieNodeState, cHomieNodeState_Error, PublishQueue::SETTING);
     retval = false;
   }
 
   return retval;
 }
 
+/**
+ * Takes the circuit from the valves, which keep their position over a
+ * reset: spa if both are on.
+ */
+void OperationModeNode::setCircuitValves(RelayModuleNode* suction, RelayModuleNode* ret) {
+  _suctionValve  = suction;
+  _returnValve   = ret;
+  const bool spa = suction->getSwitch() && ret->getSwitch();
+  if (suction->getSwitch() != ret->getSwitch()) {
+    LOG_WARNING << F("✖ Circuit: valves in different positions, taken as ") << CIRCUIT_POOL << endl;
+  }
+
+  _circuit = spa ? CIRCUIT_SPA : CIRCUIT_POOL;
+  publishQueue.send(*this, cCircuit, _circuit, PublishQueue::SETTING);
+}
+
+/**
+ * Switches between pool and spa by the configured relay transition.
+ * Rejected while a transition is still in progress, taken without one if
+ * the valves are in position already.
+ */
+bool OperationModeNode::setCircuit(const String& circuit) {
+  const RelayGroup::Transition* transition;
+
+  if (circuit.equals(CIRCUIT_POOL)) {
+    transition = _toPool;
+  } else if (circuit.equals(CIRCUIT_SPA)) {
+    transition = _toSpa;
+  } else {
+    LOG_WARNING << F("✖ UNDEFINED Circuit: ") << circuit << F(" Current unchanged circuit: ") << _circuit << endl;
+    return false;
+  }
+
+  if (_circuitGroup == NULL || transition == NULL) {
+    LOG_WARNING << F("✖ Circuit: no transitions configured") << endl;
+    return false;
+  }
+
+  // e.g. after the relay states of a trace snapshot: the pump keeps running
+  const bool spa = circuit.equals(CIRCUIT_SPA);
+  if (_suctionValve != NULL && !_circuitGroup->isBusy() && _suctionValve->getSwitch() == spa && _returnValve->getSwitch() == spa) {
+    _circuit = circuit;
+    publishQueue.send(*this, cCircuit, _circuit, PublishQueue::SETTING);
+    return true;
+  }
+
+  if (!_circuitGroup->start(*transition)) {
+    LOG_WARNING << F("✖ Circuit: transition in progress, unchanged circuit: ") << _circuit << endl;
+    return false;
+  }
+
+  _circuit = circuit;
+  LOG_INFO << F("set circuit: ") << _circuit << endl;
+  publishQueue.send(*this, cCircuit, _circuit, PublishQueue::SETTING);
+  return true;
+}
+
 /**
  *
  */
@@ -87,121 +146,159 @@ void OperationModeNode::setup() {
   advertise(cPoolMaxTemp).setName(cPoolMaxTempName).setDatatype("float").setFormat("0:40").setUnit("°C").settable();
   advertise(cSolarMinTemp).setName(cSolarMinTempName).setDatatype("float").setFormat("0:100").setUnit("°C").settable();
   advertise(cHysteresis).setName(cHysteresisName).setDatatype("float").setFormat("0:10").setUnit("K").settable();
+  advertise(cCircuit).setName(cCircuitName).setDatatype("enum").setFormat("pool,spa").settable();
 
   advertise(cTimerStartHour).setName("Timer Start").setDatatype("float").setFormat("0:23").setUnit("hh").settable();
   advertise(cTimerStartMin).setName("Timer Start").setDatatype("float").setFormat("0:59").setUnit("MM").settable();
 
   advertise(cTimerEndHour).setName("Timer End").setDatatype("float").setFormat("0:23").setUnit("hh").settable();
   advertise(cTimerEndMin).setName("Timer End").setDatatype("float").setFormat("0:59").setUnit("MM").settable();
+
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
 }
 
 /**
- *
+ * Called by the scheduler every measurement interval while Homie is connected.
  */
-void OperationModeNode::loop() {
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
-    Homie.getLogger() << F("〽 OperatioalMode update rule ") << endl;
-    //call loop to evaluate the current rule
-    Rule* rule = getRule();
-    if( rule != nullptr) {
-      rule->loop();
-    } else {
-      Homie.getLogger() << cIndent << F("✖ no rule defined: ") << _mode << endl;
-    }
-    if (Homie.isConnected()) {
+void OperationModeNode::measure() {
+  PROFILE_SCOPE(_measureStats);
+  if (_circuitGroup != NULL && _circuitGroup->isBusy()) {
+    // the pump is sequenced by the circuit transition, rules wait until it finished
+    scheduler.every(_measureTask, _measurementInterval * 1000UL, BUSY_RETRY);
+    return;
+  }
+
+  LOG_DEBUG << F("〽 OperatioalMode update rule ") << endl;
+  //call loop to evaluate the current rule
+  Rule* rule = getRule();
+  if( rule != nullptr) {
+    PROFILE_SCOPE(_ruleStats);
+    rule->loop();
+  } else {
+    LOG_WARNING << cIndent << F("✖ no rule defined: ") << _mode << endl;
+  }
+  if (Homie.isConnected()) {
 /*
-      Homie.getLogger() << cIndent << F("mode: ") << _mode << endl;
-      Homie.getLogger() << cIndent << F("SolarMinTemp: ") << _solarMinTemp << endl;
-      Homie.getLogger() << cIndent << F("PoolMaxTemp:  ") << _poolMaxTemp << endl;
-      Homie.getLogger() << cIndent << F("Hysteresis:   ") << _hysteresis << endl;
+    LOG_DEBUG << cIndent << F("mode: ") << _mode << endl;
+    LOG_DEBUG << cIndent << F("SolarMinTemp: ") << _solarMinTemp << endl;
+    LOG_DEBUG << cIndent << F("PoolMaxTemp:  ") << _poolMaxTemp << endl;
+    LOG_DEBUG << cIndent << F("Hysteresis:   ") << _hysteresis << endl;
 */
-      setProperty(cMode).send(_mode);
-      setProperty(cSolarMinTemp).send(String(_solarMinTemp));
-      setProperty(cPoolMaxTemp).send(String(_poolMaxTemp));
-      setProperty(cHysteresis).send(String(_hysteresis));
-
-      setProperty(cTimerStartHour).send(String(_timerSetting.timerStartHour));
-      setProperty(cTimerStartMin).send(String(_timerSetting.timerStartMinutes));
-
-      setProperty(cTimerEndHour).send(String(_timerSetting.timerEndHour));
-      setProperty(cTimerEndMin).send(String(_timerSetting.timerEndMinutes));
-    } else {
-      Homie.getLogger() << F("✖ OperationalMode: not connected.") << endl;
-    }
+    publishQueue.send(*this, cMode, _mode, PublishQueue::SETTING);
+    publishQueue.send(*this, cCircuit, _circuit, PublishQueue::SETTING);
+    publishQueue.send(*this, cSolarMinTemp, String(_solarMinTemp), PublishQueue::SETTING);
+    publishQueue.send(*this, cPoolMaxTemp, String(_poolMaxTemp), PublishQueue::SETTING);
+    publishQueue.send(*this, cHysteresis, String(_hysteresis), PublishQueue::SETTING);
 
-    _lastMeasurement = millis();
+    publishQueue.send(*this, cTimerStartHour, String(_timerSetting.timerStartHour), PublishQueue::SETTING);
+    publishQueue.send(*this, cTimerStartMin, String(_timerSetting.timerStartMinutes), PublishQueue::SETTING);
+
+    publishQueue.send(*this, cTimerEndHour, String(_timerSetting.timerEndHour), PublishQueue::SETTING);
+    publishQueue.send(*this, cTimerEndMin, String(_timerSetting.timerEndMinutes), PublishQueue::SETTING);
+  } else {
+    LOG_WARNING << F("✖ OperationalMode: not connected.") << endl;
   }
 }
 
+/**
+ *
+ */
+void OperationModeNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
+}
+
 /**
  * Handle update by Homie message.
  */
 bool OperationModeNode::handleInput(const HomieRange& range, const String& property, const String& value) {
+  PROFILE_SCOPE(_inputStats);
   printCaption();
 
-  Homie.getLogger() << cIndent << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
-  bool retval;
-
-  if (property.equalsIgnoreCase(cMode)) {
-    Homie.getLogger() << cIndent << F("✔ set operational mode: ") << value << endl;
-    retval = this->setMode(value);
-
-  } else if (property.equalsIgnoreCase(cHysteresis)) {
-    Homie.getLogger() << cIndent << F("✔ hysteresis: ") << value << endl;
-    _hysteresis = value.toFloat();
-    retval      = true;
-
-  } else if (property.equalsIgnoreCase(cSolarMinTemp)) {
-    Homie.getLogger() << cIndent << F("✔ solar min temp: ") << value << endl;
-    _solarMinTemp = value.toFloat();
-    retval        = true;
-
-  } else if (property.equalsIgnoreCase(cPoolMaxTemp)) {
-    Homie.getLogger() << cIndent << F("✔ pool max temp: ") << value << endl;
-    _poolMaxTemp = value.toFloat();
-    retval       = true;
-
-  } else if (property.equalsIgnoreCase(cTimerStartHour)) {
-    Homie.getLogger() << cIndent << F("✔ Timer start hh: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerStartHour = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
-
-  } else if (property.equalsIgnoreCase(cTimerStartMin)) {
-    Homie.getLogger() << cIndent << F("✔  Timer start min.: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerStartMinutes = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
-
-  } else if (property.equalsIgnoreCase(cTimerEndHour)) {
-    Homie.getLogger() << cIndent << F("✔ Timer end h: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerEndHour = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
-
-  } else if (property.equalsIgnoreCase(cTimerEndMin)) {
-    Homie.getLogger() << cIndent << F("✔ Timer end min.: ") << value << endl;
-    TimerSetting timerSetting = getTimerSetting();
-    timerSetting.timerEndMinutes = value.toInt();
-    setTimerSetting(timerSetting);
-    retval = true;
-
-  } else {
-    retval = false;
+  LOG_DEBUG << cIndent << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
+  bool retval = true;
+
+  switch (toProperty(property)) {
+    case PROPERTY_MODE:
+      LOG_INFO << cIndent << F("✔ set operational mode: ") << value << endl;
+      retval = this->setMode(value);
+      break;
+
+    case PROPERTY_CIRCUIT:
+      LOG_INFO << cIndent << F("✔ set circuit: ") << value << endl;
+      retval = this->setCircuit(value);
+      break;
+
+    case PROPERTY_HYSTERESIS:
+      LOG_INFO << cIndent << F("✔ hysteresis: ") << value << endl;
+      _hysteresis = value.toFloat();
+      break;
+
+    case PROPERTY_SOLAR_MIN_TEMP:
+      LOG_INFO << cIndent << F("✔ solar min temp: ") << value << endl;
+      _solarMinTemp = value.toFloat();
+      break;
+
+    case PROPERTY_POOL_MAX_TEMP:
+      LOG_INFO << cIndent << F("✔ pool max temp: ") << value << endl;
+      _poolMaxTemp = value.toFloat();
+      break;
+
+    case PROPERTY_TIMER_START_HOUR:
+      LOG_INFO << cIndent << F("✔ Timer start hh: ") << value << endl;
+      _timerSetting.timerStartHour = value.toInt();
+      break;
+
+    case PROPERTY_TIMER_START_MIN:
+      LOG_INFO << cIndent << F("✔  Timer start min.: ") << value << endl;
+      _timerSetting.timerStartMinutes = value.toInt();
+      break;
+
+    case PROPERTY_TIMER_END_HOUR:
+      LOG_INFO << cIndent << F("✔ Timer end h: ") << value << endl;
+      _timerSetting.timerEndHour = value.toInt();
+      break;
+
+    case PROPERTY_TIMER_END_MIN:
+      LOG_INFO << cIndent << F("✔ Timer end min.: ") << value << endl;
+      _timerSetting.timerEndMinutes = value.toInt();
+      break;
+
+    default:
+      retval = false;
   }
 
-  //set 0 to force call of loop explicite on changes
-  _lastMeasurement = 0;
+  // evaluate the rule right away on changes
+  scheduler.every(_measureTask, _measurementInterval * 1000UL, 0);
 
   return retval;
 }
 
+/**
+ * Resolves a settable property by its hash, see PropertyHash.hpp.
+ */
+OperationModeNode::Property OperationModeNode::toProperty(const String& property) const {
+  Property    id;
+  const char* name;
+
+  switch (PropertyHash::of(property)) {
+    case PropertyHash::of("mode"):            id = PROPERTY_MODE;             name = cMode;           break;
+    case PropertyHash::of("circuit"):         id = PROPERTY_CIRCUIT;          name = cCircuit;        break;
+    case PropertyHash::of("hysteresis"):      id = PROPERTY_HYSTERESIS;       name = cHysteresis;     break;
+    case PropertyHash::of("solar-min-temp"):  id = PROPERTY_SOLAR_MIN_TEMP;   name = cSolarMinTemp;   break;
+    case PropertyHash::of("pool-max-temp"):   id = PROPERTY_POOL_MAX_TEMP;    name = cPoolMaxTemp;    break;
+    case PropertyHash::of("timer-start-h"):   id = PROPERTY_TIMER_START_HOUR; name = cTimerStartHour; break;
+    case PropertyHash::of("timer-start-min"): id = PROPERTY_TIMER_START_MIN;  name = cTimerStartMin;  break;
+    case PropertyHash::of("timer-end-h"):     id = PROPERTY_TIMER_END_HOUR;   name = cTimerEndHour;   break;
+    case PropertyHash::of("timer-end-min"):   id = PROPERTY_TIMER_END_MIN;    name = cTimerEndMin;    break;
+    default:                                  return PROPERTY_UNKNOWN;
+  }
+  return strcasecmp(property.c_str(), name) == 0 ? id : PROPERTY_UNKNOWN;
+}
+
 /**
  *
  */
 void OperationModeNode::printCaption() {
-  Homie.getLogger() << cCaption << endl;
+  LOG_DEBUG << cCaption << endl;
 }
@@ -9,18 +9,22 @@
 #include <Vector.h>
 
 #include "DallasTemperatureNode.hpp"
+#include "RelayGroup.hpp"
 #include "Rule.hpp"
 #include "Timer.hpp"
 #include "TimeClientHelper.hpp"
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
 
 class OperationModeNode : public HomieNode {
+  friend class Benchmarks;
 
 public:
   OperationModeNode(const char* id, const char* name, const int measurementInterval = MEASUREMENT_INTERVAL);
 
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
-  bool          setMode(String mode);
+  bool          setMode(const String& mode);
   String        getMode();
   void          addRule(Rule* rule);
   Rule*         getRule();
@@ -41,21 +45,33 @@ public:
   void  setTimerSetting(TimerSetting setting) { _timerSetting = setting; };
   TimerSetting getTimerSetting() { return _timerSetting; };
 
+  void setCircuitTransitions(RelayGroup* group, const RelayGroup::Transition* toPool, const RelayGroup::Transition* toSpa) {
+    _circuitGroup = group;
+    _toPool       = toPool;
+    _toSpa        = toSpa;
+  };
+  void   setCircuitValves(RelayModuleNode* suction, RelayModuleNode* ret);
+  bool   setCircuit(const String& circuit);
+  String getCircuit() { return _circuit; };
+
   enum MODE { AUTO, MANU, BOOST };
   const char* STATUS_AUTO  = "auto";
   const char* STATUS_MANU  = "manu";
   const char* STATUS_BOOST = "boost";
   const char* STATUS_TIMER = "timer";
 
+  const char* CIRCUIT_POOL = "pool";
+  const char* CIRCUIT_SPA  = "spa";
+
 protected:
   void setup() override;
-  void loop() override;
   bool handleInput(const HomieRange& range, const String& property, const String& value) override;
 
 private:
   // suggested rate is 1/60Hz (1m)
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
+  static const int BUSY_RETRY           = 1000;  // in ms
   const char*      cCaption             = "• Operation Status:";
   const char*      cIndent              = "  ◦ ";
 
@@ -75,6 +91,9 @@ private:
   const char* cTimerStartHour = "timer-start-h";
   const char* cTimerStartMin  = "timer-start-min";
 
+  const char* cCircuit     = "circuit";
+  const char* cCircuitName = "Circuit";
+
   const char* cTimerEndHour = "timer-end-h";
   const char* cTimerEndMin  = "timer-end-min";
 
@@ -90,13 +109,42 @@ private:
   float         _hysteresis;
   Vector<Rule*> _ruleVec;
 
+  String                        _circuit      = CIRCUIT_POOL;
+  RelayGroup*                   _circuitGroup = NULL;
+  const RelayGroup::Transition* _toPool       = NULL;
+  const RelayGroup::Transition* _toSpa        = NULL;
+  RelayModuleNode*              _suctionValve = NULL;
+  RelayModuleNode*              _returnValve  = NULL;
+
   DallasTemperatureNode* _currentPoolTempNode;
   DallasTemperatureNode* _currentSolarTempNode;
 
   TimerSetting _timerSetting;
 
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
 
-  void printCaption();
+  Scheduler::Task _measureTask{getId(), [](void* node) { static_cast<OperationModeNode*>(node)->measure(); }, this};
+
+  enum Property {
+    PROPERTY_UNKNOWN,
+    PROPERTY_MODE,
+    PROPERTY_CIRCUIT,
+    PROPERTY_HYSTERESIS,
+    PROPERTY_SOLAR_MIN_TEMP,
+    PROPERTY_POOL_MAX_TEMP,
+    PROPERTY_TIMER_START_HOUR,
+    PROPERTY_TIMER_START_MIN,
+    PROPERTY_TIMER_END_HOUR,
+    PROPERTY_TIMER_END_MIN
+  };
+
+  Property toProperty(const String& property) const;
+  void     measure();
+  void     printCaption();
+
+#ifdef LOOP_PROFILING
+  LoopStats _measureStats{getId(), "measure"};
+  LoopStats _inputStats{getId(), "input"};
+  LoopStats _ruleStats{getId(), "rule"};
+#endif
 };
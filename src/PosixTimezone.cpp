@@ -0,0 +1,312 @@
+/**
+ * Time zone configured by a POSIX TZ string.
+ *
+ * Format: https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/V1_chap08.html
+ * Calendar math: http://howardhinnant.github.io/date_algorithms.html
+ */
+
+#include "PosixTimezone.hpp"
+
+/**
+ * Starts as UTC without DST.
+ */
+PosixTimezone::PosixTimezone() {
+  _rule[0] = '\0';
+  setRule("UTC0");
+}
+
+/**
+ * Takes over a new TZ string. An invalid string leaves the current zone unchanged.
+ */
+bool PosixTimezone::setRule(const char* tz) {
+  Zone zone;
+  if (tz == NULL || strlen(tz) >= MAX_RULE || !parse(tz, zone)) {
+    return false;
+  }
+
+  strcpy(_rule, tz);
+  _zone = zone;
+
+  // invalidate the cache
+  _cachedYear = 0;
+  _yearStart  = 0;
+  _yearEnd    = 0;
+  _dstStart   = 0;
+  _dstEnd     = 0;
+
+  return true;
+}
+
+/**
+ *
+ */
+bool PosixTimezone::isValidRule(const char* tz) {
+  Zone zone;
+  return tz != NULL && strlen(tz) < MAX_RULE && parse(tz, zone);
+}
+
+/**
+ *
+ */
+time_t PosixTimezone::toLocal(time_t utc) {
+  return utc + getOffset(utc);
+}
+
+/**
+ * @return offset to UTC in seconds, east positive
+ */
+long PosixTimezone::getOffset(time_t utc) {
+  return isDst(utc) ? _zone.dstOffset : _zone.stdOffset;
+}
+
+/**
+ *
+ */
+const char* PosixTimezone::getAbbrev(time_t utc) {
+  return isDst(utc) ? _zone.dstAbbrev : _zone.stdAbbrev;
+}
+
+/**
+ *
+ */
+bool PosixTimezone::isDst(time_t utc) {
+  if (!_zone.hasDst) {
+    return false;
+  }
+
+  if (utc < _yearStart || utc >= _yearEnd) {
+    updateCache(utc);
+  }
+
+  if (_dstStart < _dstEnd) {
+    return utc >= _dstStart && utc < _dstEnd;
+  } else {
+    // southern hemisphere: DST spans the turn of the year
+    return utc < _dstEnd || utc >= _dstStart;
+  }
+}
+
+/**
+ * Computes the transition instants of the (standard time) year containing utc.
+ */
+void PosixTimezone::updateCache(time_t utc) {
+  long days = (long)((utc + _zone.stdOffset) / 86400L);
+  if ((utc + _zone.stdOffset) % 86400L < 0) days--;
+
+  _cachedYear = yearFromDays(days);
+  _yearStart  = (time_t)daysFromCivil(_cachedYear, 1, 1) * 86400L - _zone.stdOffset;
+  _yearEnd    = (time_t)daysFromCivil(_cachedYear + 1, 1, 1) * 86400L - _zone.stdOffset;
+
+  // start is given in local standard time, end in local daylight time
+  _dstStart = transitionTime(_cachedYear, _zone.start, _zone.stdOffset);
+  _dstEnd   = transitionTime(_cachedYear, _zone.end, _zone.dstOffset);
+}
+
+/**
+ * @return UTC of the transition described by rule in the given year
+ */
+time_t PosixTimezone::transitionTime(int year, const TransitionRule& rule, long offset) {
+  long day;
+
+  switch (rule.type) {
+    case JULIAN_1:
+      // 1..365, February 29th is never counted
+      day = daysFromCivil(year, 1, 1) + rule.day - 1;
+      if (isLeapYear(year) && rule.day >= 60) day++;
+      break;
+
+    case JULIAN_0:
+      day = daysFromCivil(year, 1, 1) + rule.day;
+      break;
+
+    default: {
+      // day of week rule.day in week rule.week (5 = last) of rule.month
+      const long first   = daysFromCivil(year, rule.month, 1);
+      long       weekday = (first + 4) % 7;  // 1970-01-01 was a Thursday
+      if (weekday < 0) weekday += 7;
+
+      day = first + (rule.day - weekday + 7) % 7 + (rule.week - 1) * 7;
+
+      const long next = (rule.month == 12) ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, rule.month + 1, 1);
+      while (day >= next) day -= 7;
+      break;
+    }
+  }
+
+  return (time_t)day * 86400L + rule.time - offset;
+}
+
+/**
+ *
+ */
+bool PosixTimezone::parse(const char* tz, Zone& zone) {
+  const char* p = tz;
+  long        seconds;
+
+  if ((p = parseAbbrev(p, zone.stdAbbrev)) == NULL) return false;
+  if ((p = parseTime(p, seconds)) == NULL) return false;
+  zone.stdOffset = -seconds;  // POSIX offsets are west positive
+
+  zone.hasDst    = false;
+  zone.dstOffset = zone.stdOffset;
+  strcpy(zone.dstAbbrev, zone.stdAbbrev);
+
+  if (*p == '\0') return true;
+
+  if ((p = parseAbbrev(p, zone.dstAbbrev)) == NULL) return false;
+  zone.hasDst    = true;
+  zone.dstOffset = zone.stdOffset + 3600;
+
+  if (*p != ',' && *p != '\0') {
+    if ((p = parseTime(p, seconds)) == NULL) return false;
+    zone.dstOffset = -seconds;
+  }
+
+  if (*p == '\0') {
+    // no rules given, use the US rules like glibc
+    p = ",M3.2.0,M11.1.0";
+  }
+
+  if (*p++ != ',') return false;
+  if ((p = parseTransition(p, zone.start)) == NULL) return false;
+  if (*p++ != ',') return false;
+  if ((p = parseTransition(p, zone.end)) == NULL) return false;
+
+  return *p == '\0';
+}
+
+/**
+ * Reads "CET" or a quoted "<+0530>".
+ */
+const char* PosixTimezone::parseAbbrev(const char* p, char* abbrev) {
+  uint8_t len = 0;
+
+  if (*p == '<') {
+    p++;
+    while (*p != '>') {
+      if (*p == '\0') return NULL;
+      if (len < MAX_ABBREV - 1) abbrev[len++] = *p;
+      p++;
+    }
+    p++;
+  } else {
+    while (isalpha(*p)) {
+      if (len < MAX_ABBREV - 1) abbrev[len++] = *p;
+      p++;
+    }
+  }
+  abbrev[len] = '\0';
+
+  return (len >= 3) ? p : NULL;
+}
+
+/**
+ * Reads [+|-]hh[:mm[:ss]].
+ */
+const char* PosixTimezone::parseTime(const char* p, long& seconds) {
+  int sign = 1;
+  if (*p == '+' || *p == '-') {
+    sign = (*p == '-') ? -1 : 1;
+    p++;
+  }
+  if (!isdigit(*p)) return NULL;
+
+  long value = 0;
+  for (uint8_t part = 0; part < 3; part++) {
+    long n = 0;
+    if (!isdigit(*p)) return NULL;
+    while (isdigit(*p)) n = n * 10 + (*p++ - '0');
+
+    if (part == 0 && n > 167) return NULL;
+    if (part > 0 && n > 59) return NULL;
+    value = value * 60 + n;
+
+    if (*p != ':') {
+      // scale to seconds
+      for (uint8_t i = part; i < 2; i++) value *= 60;
+      break;
+    }
+    p++;
+  }
+
+  seconds = sign * value;
+  return p;
+}
+
+/**
+ * Reads Jn, n or Mm.w.d, optionally followed by /time.
+ */
+const char* PosixTimezone::parseTransition(const char* p, TransitionRule& rule) {
+  long n;
+
+  if (*p == 'M') {
+    long values[3];
+    p++;
+    for (uint8_t i = 0; i < 3; i++) {
+      if (!isdigit(*p)) return NULL;
+      n = 0;
+      while (isdigit(*p)) n = n * 10 + (*p++ - '0');
+      values[i] = n;
+      if (i < 2 && *p++ != '.') return NULL;
+    }
+    if (values[0] < 1 || values[0] > 12 || values[1] < 1 || values[1] > 5 || values[2] > 6) return NULL;
+
+    rule.type  = MONTH_WEEK_DAY;
+    rule.month = values[0];
+    rule.week  = values[1];
+    rule.day   = values[2];
+
+  } else {
+    rule.type = JULIAN_0;
+    if (*p == 'J') {
+      rule.type = JULIAN_1;
+      p++;
+    }
+    if (!isdigit(*p)) return NULL;
+    n = 0;
+    while (isdigit(*p)) n = n * 10 + (*p++ - '0');
+    if ((rule.type == JULIAN_1 && (n < 1 || n > 365)) || n > 365) return NULL;
+
+    rule.day = n;
+  }
+
+  rule.time = 7200;  // default 02:00:00
+  if (*p == '/') {
+    if ((p = parseTime(p + 1, rule.time)) == NULL) return NULL;
+  }
+
+  return p;
+}
+
+/**
+ * Days since 1970-01-01 of the given date.
+ */
+long PosixTimezone::daysFromCivil(int year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  const long     era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = (unsigned)(year - era * 400);
+  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097L + (long)doe - 719468L;
+}
+
+/**
+ * Year of the given day since 1970-01-01.
+ */
+int PosixTimezone::yearFromDays(long days) {
+  days += 719468L;
+  const long     era = (days >= 0 ? days : days - 146096L) / 146097L;
+  const unsigned doe = (unsigned)(days - era * 146097L);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp  = (5 * doy + 2) / 153;
+  const unsigned m   = mp < 10 ? mp + 3 : mp - 9;
+  return (int)(yoe + era * 400 + (m <= 2));
+}
+
+/**
+ *
+ */
+bool PosixTimezone::isLeapYear(int year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
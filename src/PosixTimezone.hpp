@@ -0,0 +1,78 @@
+/**
+ * Time zone configured by a POSIX TZ string, e.g. "PST8PDT,M3.2.0,M11.1.0".
+ *
+ * The DST/STD transition instants of a year are computed once and cached,
+ * so converting UTC to local time is an add and a compare until the year
+ * changes.
+ *
+ * Supported: std offset [dst [offset] [,start[/time],end[/time]]] with
+ * rules Mm.w.d, Jn and n, quoted names like <+0530> and signed hh[:mm[:ss]]
+ * offsets and times.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+
+class PosixTimezone {
+
+public:
+  PosixTimezone();
+
+  bool        setRule(const char* tz);
+  const char* getRule() const { return _rule; }
+
+  time_t      toLocal(time_t utc);
+  bool        isDst(time_t utc);
+  long        getOffset(time_t utc);
+  const char* getAbbrev(time_t utc);
+
+  static bool isValidRule(const char* tz);
+
+private:
+  static const uint8_t MAX_RULE   = 48;
+  static const uint8_t MAX_ABBREV = 8;
+
+  enum RuleType { JULIAN_1, JULIAN_0, MONTH_WEEK_DAY };
+
+  struct TransitionRule {
+    RuleType type;
+    uint16_t day;  // Jn: 1..365, n: 0..365, M: day of week 0..6
+    uint8_t  week;
+    uint8_t  month;
+    long     time;  // seconds after local midnight
+  };
+
+  struct Zone {
+    char           stdAbbrev[MAX_ABBREV];
+    char           dstAbbrev[MAX_ABBREV];
+    long           stdOffset;  // seconds east of UTC
+    long           dstOffset;
+    bool           hasDst;
+    TransitionRule start;
+    TransitionRule end;
+  };
+
+  char _rule[MAX_RULE];
+  Zone _zone;
+
+  // transitions of the cached year, all UTC
+  int    _cachedYear;
+  time_t _yearStart;
+  time_t _yearEnd;
+  time_t _dstStart;
+  time_t _dstEnd;
+
+  void updateCache(time_t utc);
+
+  static bool        parse(const char* tz, Zone& zone);
+  static const char* parseAbbrev(const char* p, char* abbrev);
+  static const char* parseTime(const char* p, long& seconds);
+  static const char* parseTransition(const char* p, TransitionRule& rule);
+  static time_t      transitionTime(int year, const TransitionRule& rule, long offset);
+
+  static long daysFromCivil(int year, unsigned month, unsigned day);
+  static int  yearFromDays(long days);
+  static bool isLeapYear(int year);
+};
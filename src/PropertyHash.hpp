@@ -0,0 +1,41 @@
+/**
+ * Case insensitive FNV-1a hash of property names, to dispatch handleInput()
+ * with a switch instead of a chain of string comparisons:
+ *
+ *   switch (PropertyHash::of(property)) {
+ *     case PropertyHash::of("mode"): ...
+ *   }
+ *
+ * The case labels are computed by the compiler, which also rejects two names
+ * with the same hash as duplicate labels, so the hash is perfect for the
+ * names of each switch. Other strings can still hit a label: confirm the
+ * match with one strcasecmp().
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+namespace PropertyHash {
+
+const uint32_t OFFSET = 2166136261UL;
+const uint32_t PRIME  = 16777619UL;
+
+constexpr char lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+/** Recursive, to be a constant expression in C++11. */
+constexpr uint32_t of(const char* name, uint32_t hash = OFFSET) {
+  return *name == '\0' ? hash : of(name + 1, (hash ^ static_cast<uint8_t>(lower(*name))) * PRIME);
+}
+
+inline uint32_t of(const String& name) {
+  uint32_t hash = OFFSET;
+  for (const char* c = name.c_str(); *c != '\0'; c++) {
+    hash = (hash ^ static_cast<uint8_t>(lower(*c))) * PRIME;
+  }
+  return hash;
+}
+
+}  // namespace PropertyHash
@@ -0,0 +1,221 @@
+/**
+ * Central queue of the outbound MQTT publishes.
+ */
+
+#include "PublishQueue.hpp"
+
+PublishQueue publishQueue;
+
+const HomieRange PublishQueue::NO_RANGE = {false, 0};
+
+/**
+ *
+ */
+PublishQueue::PublishQueue() {
+  for (uint8_t p = 0; p < PRIORITIES; p++) {
+    _head[p] = NONE;
+    _tail[p] = NONE;
+  }
+  for (uint8_t i = 0; i < CAPACITY; i++) {
+    _entries[i].next = (i + 1 < CAPACITY) ? i + 1 : NONE;
+  }
+  _free = 0;
+}
+
+/**
+ * Queues the value of a topic, or replaces the value still waiting for it.
+ * A replaced value moves up to the class of the new one if that is higher.
+ * False if it was dropped.
+ */
+bool PublishQueue::send(const HomieNode& node, const char* property, const String& value, Priority priority, const HomieRange& range) {
+  notify(node, property, range, priority, value);
+  return replace(node, property, range, NONE, value, priority);
+}
+
+/**
+ * Like send(), for a topic several sources share: replaces only the value
+ * still waiting with the same key. False if it was dropped.
+ */
+bool PublishQueue::sendKeyed(const HomieNode& node, const char* property, uint8_t key, const String& value, Priority priority) {
+  notify(node, property, NO_RANGE, priority, value);
+  return replace(node, property, NO_RANGE, key, value, priority);
+}
+
+/**
+ * Queues the value behind the waiting ones of the topic. False if it was
+ * dropped.
+ */
+bool PublishQueue::append(const HomieNode& node, const char* property, const String& value, Priority priority, const HomieRange& range) {
+  notify(node, property, range, priority, value);
+  return enqueue(node, property, range, NONE, value, priority);
+}
+
+/**
+ *
+ */
+bool PublishQueue::replace(const HomieNode& node, const char* property, const HomieRange& range, uint8_t key, const String& value, Priority priority) {
+  for (uint8_t p = 0; p < PRIORITIES; p++) {
+    uint8_t previous = NONE;
+    for (uint8_t i = _head[p]; i != NONE; previous = i, i = _entries[i].next) {
+      if (!matches(_entries[i], node, property, range, key)) continue;
+
+      _entries[i].value = value;
+      _coalesced++;
+      if (p > priority) {
+        unlink(p, previous, i);
+        link(priority, i);
+      }
+      return true;
+    }
+  }
+  return enqueue(node, property, range, key, value, priority);
+}
+
+/**
+ *
+ */
+bool PublishQueue::enqueue(const HomieNode& node, const char* property, const HomieRange& range, uint8_t key, const String& value, Priority priority) {
+  if (_free == NONE && !evictBelow(priority)) {
+    _dropped++;
+    return false;
+  }
+
+  const uint8_t i = _free;
+  _free           = _entries[i].next;
+
+  Entry& entry   = _entries[i];
+  entry.node     = &node;
+  entry.property = property;
+  entry.range    = range;
+  entry.key      = key;
+  entry.value    = value;
+  link(priority, i);
+
+  if (++_depth > _maxDepth) _maxDepth = _depth;
+  return true;
+}
+
+/**
+ * False if all listeners are taken.
+ */
+bool PublishQueue::addListener(Listener listener, void* context) {
+  for (uint8_t i = 0; i < LISTENERS; i++) {
+    if (_listeners[i] != NULL) continue;
+
+    _listeners[i]        = listener;
+    _listenerContexts[i] = context;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Whether a value of the class would be queued without dropping one.
+ */
+bool PublishQueue::hasRoom(Priority priority) const {
+  if (_free != NONE) return true;
+  for (uint8_t p = priority + 1; p < PRIORITIES; p++) {
+    if (_head[p] != NONE) return true;
+  }
+  return false;
+}
+
+/**
+ * Publishes the waiting values, highest class first, a slice per pass.
+ */
+void PublishQueue::loop() {
+  if (_depth == 0 || !Homie.isConnected()) return;
+
+  const uint32_t start = micros();
+  for (uint8_t n = 0; n < SLICE && (n == 0 || micros() - start < BUDGET); n++) {
+    uint8_t p = 0;
+    while (p < PRIORITIES && _head[p] == NONE) p++;
+    if (p == PRIORITIES) return;
+
+    const uint8_t i     = _head[p];
+    const Entry&  entry = _entries[i];
+
+    HomieInternals::SendingPromise& promise = entry.node->setProperty(entry.property);
+    if (entry.range.isRange) promise.setRange(entry.range);
+    if (promise.send(entry.value) == 0) {
+      _refused++;  // the client's buffer is full, the next pass retries
+      return;
+    }
+
+    unlink(p, NONE, i);
+    release(i);
+    _sent++;
+  }
+}
+
+/**
+ *
+ */
+void PublishQueue::notify(const HomieNode& node, const char* property, const HomieRange& range, Priority priority, const String& value) {
+  for (uint8_t i = 0; i < LISTENERS && _listeners[i] != NULL; i++) {
+    _listeners[i](_listenerContexts[i], node, property, range, priority, value);
+  }
+}
+
+/**
+ *
+ */
+bool PublishQueue::matches(const Entry& entry, const HomieNode& node, const char* property, const HomieRange& range, uint8_t key) const {
+  return entry.node == &node && entry.key == key && entry.range.isRange == range.isRange && (!range.isRange || entry.range.index == range.index) &&
+         (entry.property == property || strcmp(entry.property, property) == 0);
+}
+
+/**
+ * Drops the oldest value of the lowest class below priority.
+ */
+bool PublishQueue::evictBelow(Priority priority) {
+  for (uint8_t p = PRIORITIES - 1; p > priority; p--) {
+    const uint8_t i = _head[p];
+    if (i == NONE) continue;
+
+    unlink(p, NONE, i);
+    release(i);
+    _dropped++;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Appends the entry to its class.
+ */
+void PublishQueue::link(uint8_t priority, uint8_t index) {
+  _entries[index].next = NONE;
+  if (_tail[priority] == NONE) {
+    _head[priority] = index;
+  } else {
+    _entries[_tail[priority]].next = index;
+  }
+  _tail[priority] = index;
+}
+
+/**
+ * Takes the entry out of its class, previous is the entry before it.
+ */
+void PublishQueue::unlink(uint8_t priority, uint8_t previous, uint8_t index) {
+  const uint8_t next = _entries[index].next;
+  if (previous == NONE) {
+    _head[priority] = next;
+  } else {
+    _entries[previous].next = next;
+  }
+  if (_tail[priority] == index) _tail[priority] = previous;
+}
+
+/**
+ * Returns the entry to the free list. Short values keep their buffer for
+ * the next one.
+ */
+void PublishQueue::release(uint8_t index) {
+  Entry& entry = _entries[index];
+  if (entry.value.length() > KEEP_VALUE) entry.value = String();
+
+  entry.next = _free;
+  _free      = index;
+  _depth--;
+}
@@ -0,0 +1,104 @@
+/**
+ * Central queue of the outbound MQTT publishes.
+ *
+ * The nodes hand their property values to send() instead of publishing
+ * inline, and loop() publishes them once per pass of the main loop: by
+ * priority class (relay state, sensor values, settings echo, logs and
+ * diagnostics), in order within a class. While a topic waits, a new value
+ * replaces the waiting one, so a backlog of the MQTT client delays the
+ * last value of each topic instead of stalling the node that publishes.
+ * Log batches go through append(), they queue up instead. Topics shared by
+ * several sources go through sendKeyed(), which replaces only the waiting
+ * value with the same key, e.g. the sensor index of a JSON message.
+ *
+ * loop() publishes at most SLICE messages or for BUDGET µs per pass and
+ * stops at the first publish the MQTT client refuses, the rest waits for
+ * the next pass, also while disconnected. A full queue makes room by
+ * dropping the oldest entry of the lowest class below the new one, or else
+ * drops the new one.
+ *
+ *   publishQueue.send(*this, cSwitch, cFlagOn, PublishQueue::RELAY);
+ *
+ * The property names are kept as pointers: members or literals of the
+ * static nodes. The listeners see every value handed to the queue, also the
+ * ones replaced or dropped later.
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+
+class PublishQueue {
+
+public:
+  enum Priority : uint8_t { RELAY, SENSOR, SETTING, LOG, PRIORITIES };
+
+  typedef void (*Listener)(void* context, const HomieNode& node, const char* property, const HomieRange& range, Priority priority,
+                           const String& value);
+
+  static const uint8_t  CAPACITY   = 32;
+  static const uint8_t  SLICE      = 8;
+  static const uint32_t BUDGET     = 2000;  // in µs
+  static const size_t   KEEP_VALUE = 64;    // longer values give their buffer back once sent
+  static const uint8_t  LISTENERS  = 2;
+
+  static const HomieRange NO_RANGE;
+
+  PublishQueue();
+
+  bool send(const HomieNode& node, const char* property, const String& value, Priority priority, const HomieRange& range = NO_RANGE);
+  bool sendKeyed(const HomieNode& node, const char* property, uint8_t key, const String& value, Priority priority);
+  bool append(const HomieNode& node, const char* property, const String& value, Priority priority, const HomieRange& range = NO_RANGE);
+  bool hasRoom(Priority priority) const;
+  void loop();
+
+  bool addListener(Listener listener, void* context);
+
+  // counts since boot
+  uint32_t getSent() const { return _sent; }
+  uint32_t getCoalesced() const { return _coalesced; }
+  uint32_t getDropped() const { return _dropped; }
+  uint32_t getRefused() const { return _refused; }  // publishes the client didn't take, retried
+
+  uint8_t getDepth() const { return _depth; }
+  uint8_t getMaxDepth() const { return _maxDepth; }
+  void    resetMaxDepth() { _maxDepth = _depth; }
+
+private:
+  static const uint8_t NONE = 0xFF;
+
+  struct Entry {
+    const HomieNode* node     = NULL;
+    const char*      property = NULL;
+    HomieRange       range    = {false, 0};
+    String           value;
+    uint8_t          key  = NONE;  // of sendKeyed()
+    uint8_t          next = NONE;  // in its class or the free list
+  };
+
+  Entry   _entries[CAPACITY];
+  uint8_t _head[PRIORITIES];
+  uint8_t _tail[PRIORITIES];
+  uint8_t _free;
+
+  Listener _listeners[LISTENERS]        = {};
+  void*    _listenerContexts[LISTENERS] = {};
+
+  uint8_t  _depth     = 0;
+  uint8_t  _maxDepth  = 0;
+  uint32_t _sent      = 0;
+  uint32_t _coalesced = 0;
+  uint32_t _dropped   = 0;
+  uint32_t _refused   = 0;
+
+  void notify(const HomieNode& node, const char* property, const HomieRange& range, Priority priority, const String& value);
+  bool replace(const HomieNode& node, const char* property, const HomieRange& range, uint8_t key, const String& value, Priority priority);
+  bool enqueue(const HomieNode& node, const char* property, const HomieRange& range, uint8_t key, const String& value, Priority priority);
+  bool matches(const Entry& entry, const HomieNode& node, const char* property, const HomieRange& range, uint8_t key) const;
+  bool evictBelow(Priority priority);
+  void link(uint8_t priority, uint8_t index);
+  void unlink(uint8_t priority, uint8_t previous, uint8_t index);
+  void release(uint8_t index);
+};
+
+extern PublishQueue publishQueue;
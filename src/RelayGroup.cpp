@@ -0,0 +1,167 @@
+/**
+ * Atomic multi-relay transitions.
+ */
+
+#include "RelayGroup.hpp"
+
+#ifdef ESP32
+#include <soc/gpio_struct.h>
+#endif
+
+/**
+ *
+ */
+RelayGroup::Transition::Transition() {
+  clear();
+}
+
+/**
+ *
+ */
+void RelayGroup::Transition::clear() {
+  _stageCount = 0;
+}
+
+/**
+ * Adds a relay to the current stage. Actions beyond MAX_ACTIONS are dropped.
+ */
+RelayGroup::Transition& RelayGroup::Transition::set(RelayModuleNode* relay, const boolean state) {
+  return add(relay, state, false);
+}
+
+/**
+ * Adds a relay to the current stage, switched back to its state at the start of the transition.
+ */
+RelayGroup::Transition& RelayGroup::Transition::restore(RelayModuleNode* relay) {
+  return add(relay, false, true);
+}
+
+/**
+ *
+ */
+RelayGroup::Transition& RelayGroup::Transition::add(RelayModuleNode* relay, const boolean state, const boolean restore) {
+  if (_stageCount == 0) {
+    then(0);
+  }
+
+  Stage& stage = _stages[_stageCount - 1];
+  if (stage.actionCount < MAX_ACTIONS) {
+    stage.actions[stage.actionCount].relay   = relay;
+    stage.actions[stage.actionCount].state   = state;
+    stage.actions[stage.actionCount].restore = restore;
+    stage.actionCount++;
+  }
+
+  return *this;
+}
+
+/**
+ * Starts a new stage, applied delay ms after the previous one. Stages beyond MAX_STAGES are dropped.
+ */
+RelayGroup::Transition& RelayGroup::Transition::then(unsigned long delay) {
+  if (_stageCount < MAX_STAGES) {
+    _stages[_stageCount].delay       = delay;
+    _stages[_stageCount].actionCount = 0;
+    _stageCount++;
+  }
+
+  return *this;
+}
+
+/**
+ * Starts a transition. The first stage is applied right away unless it has a delay.
+ * The transition must stay valid until it finished.
+ *
+ * @return false if another transition is still in progress
+ */
+bool RelayGroup::start(const Transition& transition) {
+  if (isBusy()) {
+    return false;
+  }
+
+  _transition = &transition;
+  _nextStage  = 0;
+  _stageStart = millis();
+  _restored   = 0;
+
+  for (uint8_t s = 0; s < transition._stageCount; s++) {
+    const Transition::Stage& stage = transition._stages[s];
+    for (uint8_t a = 0; a < stage.actionCount; a++) {
+      if (stage.actions[a].restore && stage.actions[a].relay->getSwitch()) {
+        _restored |= 1UL << (s * MAX_ACTIONS + a);
+      }
+    }
+  }
+
+  loop();
+  return true;
+}
+
+/**
+ * Applies the next stage once its delay expired. Call from the main loop.
+ */
+void RelayGroup::loop() {
+  while (_transition != NULL && millis() - _stageStart >= _transition->_stages[_nextStage].delay) {
+    applyStage(_nextStage);
+    _stageStart = millis();
+
+    if (++_nextStage >= _transition->_stageCount) {
+      _transition = NULL;
+    }
+  }
+}
+
+/**
+ * Stops a transition in progress, stages already applied stay applied.
+ */
+void RelayGroup::abort() {
+  _transition = NULL;
+}
+
+/**
+ * Writes the pins of all relays of a stage with one set and one clear register write.
+ */
+void RelayGroup::applyStage(uint8_t index) {
+  const Transition::Stage& stage = _transition->_stages[index];
+  boolean                  states[MAX_ACTIONS];
+  uint32_t                 setMask   = 0;
+  uint32_t                 clearMask = 0;
+
+  for (uint8_t i = 0; i < stage.actionCount; i++) {
+    const Transition::Action& action = stage.actions[i];
+    states[i] = action.restore ? (_restored & (1UL << (index * MAX_ACTIONS + i))) != 0 : action.state;
+
+    const RelayModuleNode* relay = action.relay;
+    const uint8_t          pin   = relay->getPin();
+    const uint8_t          level = relay->getPinLevel(states[i]);
+
+#ifdef ESP8266
+    // GPIO16 is not part of the GPO register
+    if (pin < 16) {
+#elif defined(ESP32)
+    if (pin < 32) {
+#else
+    if (false) {
+#endif
+      if (level == HIGH) {
+        setMask |= (1UL << pin);
+      } else {
+        clearMask |= (1UL << pin);
+      }
+    } else {
+      digitalWrite(pin, level);
+    }
+  }
+
+#ifdef ESP8266
+  GPOS = setMask;
+  GPOC = clearMask;
+#elif defined(ESP32)
+  GPIO.out_w1ts = setMask;
+  GPIO.out_w1tc = clearMask;
+#endif
+
+  for (uint8_t i = 0; i < stage.actionCount; i++) {
+    stage.actions[i].relay->commitSwitch(states[i]);
+  }
+}
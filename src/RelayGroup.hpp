@@ -0,0 +1,73 @@
+/**
+ * Atomic multi-relay transitions.
+ *
+ * A transition is a sequence of stages. All relays of a stage change in one
+ * GPIO set/clear register write, so e.g. suction and return valves move at
+ * the same instant. The delay between stages is enforced by loop() without
+ * blocking, Homie.loop() keeps running while a transition is in progress.
+ * restore() switches a relay back to its state at the start of the
+ * transition, e.g. the pump only runs again if it was running before.
+ *
+ *   RelayGroup::Transition toSpa;
+ *   toSpa.set(&pump, false).then(3000).set(&suction, true).set(&ret, true).then(30000).restore(&pump);
+ *   group.start(toSpa);
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "RelayModuleNode.hpp"
+
+class RelayGroup {
+
+public:
+  static const uint8_t MAX_STAGES  = 4;
+  static const uint8_t MAX_ACTIONS = 8;  // per stage
+
+  class Transition {
+    friend class RelayGroup;
+
+  public:
+    Transition();
+
+    Transition& set(RelayModuleNode* relay, const boolean state);
+    Transition& restore(RelayModuleNode* relay);
+    Transition& then(unsigned long delay);
+    void        clear();
+
+    uint8_t getStageCount() const { return _stageCount; }
+
+  private:
+    struct Action {
+      RelayModuleNode* relay;
+      boolean          state;
+      boolean          restore;  // state at the start of the transition instead
+    };
+
+    struct Stage {
+      unsigned long delay;  // in ms, before this stage is applied
+      uint8_t       actionCount;
+      Action        actions[MAX_ACTIONS];
+    };
+
+    uint8_t _stageCount;
+    Stage   _stages[MAX_STAGES];
+
+    Transition& add(RelayModuleNode* relay, const boolean state, const boolean restore);
+  };
+
+  bool start(const Transition& transition);
+  void loop();
+  void abort();
+  bool isBusy() const { return _transition != NULL; }
+
+private:
+  const Transition* _transition = NULL;
+  uint8_t           _nextStage  = 0;
+  unsigned long     _stageStart = 0;
+  uint32_t          _restored   = 0;  // states of the restore actions at the start, bit per action
+
+  static_assert(MAX_STAGES * MAX_ACTIONS <= 32, "a bit per action in _restored");
+
+  void applyStage(uint8_t index);
+};
@@ -5,18 +5,72 @@
  * https://github.com/YuriiSalimov/RelayModule
  */
 #include "RelayModuleNode.hpp"
+#include "Log.hpp"
+#include "PublishQueue.hpp"
+#include "TraceRecorder.hpp"
+
+RelayModuleNode* RelayModuleNode::_relays[RelayStateStore::MAX_RELAYS];
+uint8_t          RelayModuleNode::_relayCount = 0;
+RelayStateStore  RelayModuleNode::_store;
+#ifdef BENCHMARK
+boolean RelayModuleNode::_outputBlocked = false;
+#endif
 
 RelayModuleNode::RelayModuleNode(const char* id, const char* name, const uint8_t pin, const int measurementInterval)
     : HomieNode(id, name, "switch") {
   _pin                 = pin;
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
-  _lastMeasurement     = 0;
+
+  // each relay owns one bit of the persisted state
+  _slot = _relayCount;
+  if (_relayCount < RelayStateStore::MAX_RELAYS) {
+    _relays[_relayCount++] = this;
+  }
+
+  // transitions while disconnected wait in the publish queue and go into the history
+  setRunLoopDisconnected(true);
 }
 
 /**
- *
+ * Restores the persisted state of all relays, if it was stored with the
+ * same relays in the same order.
+ * Call first thing in setup(), long before WiFi and MQTT are up.
+ */
+void RelayModuleNode::restoreAll() {
+  uint32_t layout = 0;
+  for (uint8_t i = 0; i < _relayCount; i++) {
+    const char* id = _relays[i]->getId();
+    layout         = Crc32::update(layout, reinterpret_cast<const uint8_t*>(id), strlen(id) + 1);
+    layout         = Crc32::update(layout, &_relays[i]->_pin, 1);
+  }
+  _store.begin(layout);
+
+  for (uint8_t i = 0; i < _relayCount; i++) {
+    _relays[i]->initRelay();
+    _relays[i]->applyStoredState();
+  }
+}
+
+/**
+ * Writes changed states to flash, coalesced. Call from the main loop.
+ */
+void RelayModuleNode::storeLoop() {
+  _store.loop();
+}
+
+/**
+ * Switches the relay right away. Publishing and persisting are queued,
+ * and only if the state really changed.
  */
 void RelayModuleNode::setSwitch(const boolean state) {
+#ifdef BENCHMARK
+  if (_outputBlocked) {
+    // no pin, store, trace or publish while the benchmarks run the rules
+    _state         = state;
+    _commandMicros = 0;
+    return;
+  }
+#endif
 
   if (state) {
     relay->on();
@@ -24,34 +78,43 @@ void RelayModuleNode::setSwitch(const boolean state) {
     relay->off();
   }
 
-  if(Homie.isConnected()){
-    setProperty(cSwitch).send((state ? cFlagOn : cFlagOff));
-    setProperty(cHomieNodeState).send(cHomieNodeState_OK);
+  commitSwitch(state);
+}
+
+/**
+ * Bookkeeping after the pin was written, by setSwitch() or by a RelayGroup.
+ */
+void RelayModuleNode::commitSwitch(const boolean state) {
+  if (_commandMicros != 0) {
+    // latency from MQTT receipt to pin write
+    _lastLatency   = micros() - _commandMicros;
+    _maxLatency    = max(_maxLatency, _lastLatency);
+    _commandMicros = 0;
   }
-  // persist value
-#ifdef ESP32
-  preferences.begin(getId(), false);
-  preferences.putBool(cSwitch, state);
-  preferences.end();
-#elif defined(ESP8266)
 
-#endif
+  if (state == _state) {
+    return;
+  }
+  _state          = state;
+  _publishPending = true;
+  traceRecorder.relay(_pin, state);
 
-  Homie.getLogger() << cIndent << F("Relay is ") << (state ? cFlagOn : cFlagOff) << endl;
+  // persist value
+  _store.set(_slot, state);
 }
 
 /**
  *
  */
 boolean RelayModuleNode::getSwitch() {
-  return relay->isOn();
+  return _state;
 }
 
 /**
  *
  */
 void RelayModuleNode::printCaption() {
-  Homie.getLogger() << cCaption << F(" pin[") << _pin << F("]:") << endl;
+  LOG_DEBUG << cCaption << F(" pin[") << _pin << F("]:") << endl;
 }
 
 /**
@@ -59,47 +122,59 @@ void RelayModuleNode::printCaption() {
  *
  */
 bool RelayModuleNode::handleInput(const HomieRange& range, const String& property, const String& value) {
-  printCaption();
-
-  Homie.getLogger() << cIndent << F("〽 handleInput -> property '") << property << F("' value=") << value << endl;
-  bool retval;
+  PROFILE_SCOPE(_inputStats);
+  const unsigned long received = micros();
 
-  if (value != cFlagOn && value != cFlagOff) {
-    Homie.getLogger() << F("invalid value for property '") << property << F("' value=") << value << endl;
+  const bool on = value == cFlagOn;
+  if (!on && value != cFlagOff) {
+    printCaption();
+    LOG_WARNING << cIndent << F("✖ invalid value for property '") << property << F("' value=") << value << endl;
 
     if(Homie.isConnected()) {
-      setProperty(cHomieNodeState).send(cHomieNodeState_Error);
+      publishQueue.send(*this, cHomieNodeState, cHomieNodeState_Error, PublishQueue::RELAY);
     }
-    retval = false;
-  } else {
-    const bool flag = (value == cFlagOn);
-    setSwitch(flag);
-
-    retval = true;
+    return false;
   }
 
-  Homie.getLogger() << F("〽 handleInput <-") << retval << endl;
-  return retval;
+  _commandMicros = received;
+  setSwitch(on);
+
+  LOG_DEBUG << cIndent << F("〽 handleInput ") << getId() << F(" ") << property << F("=") << value << endl;
+  return true;
 }
 
 /**
  *
  */
 void RelayModuleNode::loop() {
-  if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0) {
+  PROFILE_SCOPE(_loopStats);
+  if (_publishPending) {
+    _publishPending = false;
 
-    if (Homie.isConnected()) {
+    publishQueue.send(*this, cSwitch, (_state ? cFlagOn : cFlagOff), PublishQueue::RELAY);
+    publishQueue.send(*this, cHomieNodeState, cHomieNodeState_OK, PublishQueue::RELAY);
 
-      const boolean isOn = getSwitch();
-      Homie.getLogger() << F("〽 Sending Switch status: ") << getId() << F(" switch: ") << (isOn ? cFlagOn : cFlagOff) << endl;
+    LOGB_INFO(RELAY_SWITCHED, _pin, _state, _lastLatency, _maxLatency);
+  }
+}
 
-      if(Homie.isConnected()) {
-        setProperty(cSwitch).send((isOn ? cFlagOn : cFlagOff));
-      }
-    }
+/**
+ * Called by the scheduler every measurement interval while Homie is connected.
+ */
+void RelayModuleNode::measure() {
+  PROFILE_SCOPE(_measureStats);
+  const boolean isOn = getSwitch();
+  LOG_DEBUG << F("〽 Sending Switch status: ") << getId() << F(" switch: ") << (isOn ? cFlagOn : cFlagOff) << endl;
 
-    _lastMeasurement = millis();
-  }
+  publishQueue.send(*this, cSwitch, (isOn ? cFlagOn : cFlagOff), PublishQueue::RELAY);
+}
+
+/**
+ *
+ */
+void RelayModuleNode::setMeasurementInterval(unsigned long interval) {
+  _measurementInterval = interval;
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
 }
 
 /**
@@ -111,20 +186,33 @@ void RelayModuleNode::setup() {
   advertise(cSwitch).setName(cSwitchName).setDatatype("boolean").settable();
   advertise(cHomieNodeState).setName(cHomieNodeStateName).setDatatype("string");
   
-  boolean INVERT_SIGNAL = true;
+  // normally done by restoreAll() already
+  if (initRelay()) {
+    applyStoredState();
+  }
+
+  scheduler.every(_measureTask, _measurementInterval * 1000UL);
+}
+
+/**
+ * @return true if the relay was created now
+ */
+bool RelayModuleNode::initRelay() {
+  if (relay != NULL) {
+    return false;
+  }
+
   relay = new RelayModule(_pin, INVERT_SIGNAL); // The second parameter is whether to invert the signal
+  return true;
+}
 
-#ifdef ESP32
-  preferences.begin(getId(), false);
-  boolean storedSwitchValue = preferences.getBool(cSwitch, false);
-  // Close the Preferences
-  preferences.end();
-#elif defined(ESP8266)
-  boolean storedSwitchValue = false;
-#endif
+/**
+ *
+ */
+void RelayModuleNode::applyStoredState() {
+  _state = _store.get(_slot);
 
-  //restore from preferences
-  if (storedSwitchValue) {
+  if (_state) {
     relay->on();
   } else {
     relay->off();
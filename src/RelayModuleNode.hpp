@@ -7,22 +7,27 @@
 
 #include <Homie.hpp>
 #include <RelayModule.h>
-#ifdef ESP32
-#include <Preferences.h>
-#elif defined(ESP8266)
-
-#endif
+#include "RelayStateStore.hpp"
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
 
 class RelayModuleNode : public HomieNode {
+  friend class RelayGroup;
+  friend class Benchmarks;
 
 public:
   RelayModuleNode(const char* id, const char* name, const uint8_t pin, const int measurementInterval = MEASUREMENT_INTERVAL);
 
   uint8_t       getPin() const { return _pin; }
-  void          setMeasurementInterval(unsigned long interval) { _measurementInterval = interval; }
+  void          setMeasurementInterval(unsigned long interval);
   unsigned long getMeasurementInterval() const { return _measurementInterval; }
   void          setSwitch(const boolean state);
   boolean       getSwitch();
+  unsigned long getLastLatency() const { return _lastLatency; }
+  unsigned long getMaxLatency() const { return _maxLatency; }
+
+  static void restoreAll();
+  static void storeLoop();
 
 protected:
   virtual void setup() override;
@@ -35,6 +40,9 @@ private:
   static const int MIN_INTERVAL         = 60;  // in seconds
   static const int MEASUREMENT_INTERVAL = 300;
 
+  // relay modules switch on a LOW signal
+  static const boolean INVERT_SIGNAL = true;
+
   const char* cCaption = "• Relay Module:";
   const char* cIndent  = "  ◦ ";
 
@@ -51,15 +59,35 @@ private:
   const char* cHomieNodeState_Error = "Error";
 
   uint8_t       _pin;
+  uint8_t       _slot;
   unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
   RelayModule*  relay = NULL;
 
-#ifdef ESP32
-  Preferences preferences;
-#elif defined(ESP8266)
-
+  boolean       _state          = false;
+  boolean       _publishPending = false;
+  unsigned long _commandMicros  = 0;
+  unsigned long _lastLatency    = 0;  // in µs
+  unsigned long _maxLatency     = 0;  // in µs
+
+  static RelayModuleNode* _relays[RelayStateStore::MAX_RELAYS];
+  static uint8_t          _relayCount;
+  static RelayStateStore  _store;
+#ifdef BENCHMARK
+  static boolean _outputBlocked;  // set by Benchmarks: setSwitch() changes the state only
 #endif
 
-  void printCaption();
+  Scheduler::Task _measureTask{getId(), [](void* node) { static_cast<RelayModuleNode*>(node)->measure(); }, this};
+
+  void    measure();
+  void    printCaption();
+  bool    initRelay();
+  void    applyStoredState();
+  void    commitSwitch(const boolean state);
+  uint8_t getPinLevel(const boolean state) const { return (state != INVERT_SIGNAL) ? HIGH : LOW; }
+
+#ifdef LOOP_PROFILING
+  LoopStats _loopStats{getId(), "loop"};
+  LoopStats _measureStats{getId(), "measure"};
+  LoopStats _inputStats{getId(), "input"};
+#endif
 };
\ No newline at end of file
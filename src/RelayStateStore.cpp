@@ -0,0 +1,151 @@
+/**
+ * Persistent state of the relays in RTC memory and flash.
+ */
+
+#include "RelayStateStore.hpp"
+
+#ifdef ESP32
+// survives software and watchdog resets, garbage after power on (caught by the CRC)
+RTC_NOINIT_ATTR static uint32_t rtcRecord[4];
+#endif
+
+/**
+ * Loads the stored states: RTC memory first, as it holds the latest states
+ * after a soft reset, flash after a power loss. Only records of the layout.
+ */
+void RelayStateStore::begin(uint32_t layout) {
+  Record record;
+  _layout = layout;
+
+#ifdef ESP8266
+  EEPROM.begin(sizeof(Record));
+#endif
+
+  Record flash;
+  bool   flashValid = readFlash(flash);
+  _flashStates      = flashValid ? flash.states : 0;
+
+  if (readRtc(record)) {
+    _states = record.states;
+    _source = RTC;
+  } else if (flashValid) {
+    _states = flash.states;
+    _source = FLASH;
+    seal(record, _states);
+    writeRtc(record);
+  } else {
+    _states = 0;
+    _source = NONE;
+  }
+}
+
+/**
+ * Writes pending changes to flash once the states were stable for FLASH_DELAY.
+ */
+void RelayStateStore::loop() {
+  if (_flashDirty && millis() - _lastChange >= FLASH_DELAY) {
+    _flashDirty = false;
+
+    if (_states != _flashStates) {
+      Record record;
+      seal(record, _states);
+      writeFlash(record);
+      _flashStates = _states;
+    }
+  }
+}
+
+/**
+ *
+ */
+bool RelayStateStore::get(uint8_t slot) const {
+  return slot < MAX_RELAYS && (_states & (1UL << slot));
+}
+
+/**
+ * Stores a state in RTC memory right away and schedules the flash write.
+ */
+void RelayStateStore::set(uint8_t slot, bool state) {
+  if (slot >= MAX_RELAYS) return;
+
+  const uint32_t states = state ? (_states | (1UL << slot)) : (_states & ~(1UL << slot));
+  if (states == _states) return;
+
+  _states = states;
+
+  Record record;
+  seal(record, _states);
+  writeRtc(record);
+
+  _flashDirty = true;
+  _lastChange = millis();
+}
+
+/**
+ *
+ */
+bool RelayStateStore::readRtc(Record& record) {
+#ifdef ESP32
+  memcpy(&record, rtcRecord, sizeof(Record));
+#elif defined(ESP8266)
+  if (!ESP.rtcUserMemoryRead(RTC_OFFSET, reinterpret_cast<uint32_t*>(&record), sizeof(Record))) return false;
+#endif
+  return isValid(record);
+}
+
+/**
+ *
+ */
+void RelayStateStore::writeRtc(const Record& record) {
+#ifdef ESP32
+  memcpy(rtcRecord, &record, sizeof(Record));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryWrite(RTC_OFFSET, reinterpret_cast<uint32_t*>(const_cast<Record*>(&record)), sizeof(Record));
+#endif
+}
+
+/**
+ *
+ */
+bool RelayStateStore::readFlash(Record& record) {
+#ifdef ESP32
+  _preferences.begin("relays", true);
+  size_t len = _preferences.getBytes("states", &record, sizeof(Record));
+  _preferences.end();
+  if (len != sizeof(Record)) return false;
+#elif defined(ESP8266)
+  EEPROM.get(0, record);
+#endif
+  return isValid(record);
+}
+
+/**
+ *
+ */
+void RelayStateStore::writeFlash(const Record& record) {
+#ifdef ESP32
+  _preferences.begin("relays", false);
+  _preferences.putBytes("states", &record, sizeof(Record));
+  _preferences.end();
+#elif defined(ESP8266)
+  EEPROM.put(0, record);
+  EEPROM.commit();
+#endif
+}
+
+/**
+ *
+ */
+void RelayStateStore::seal(Record& record, uint32_t states) const {
+  record.magic  = MAGIC;
+  record.layout = _layout;
+  record.states = states;
+  record.crc    = Crc32::compute(reinterpret_cast<const uint8_t*>(&record), offsetof(Record, crc));
+}
+
+/**
+ *
+ */
+bool RelayStateStore::isValid(const Record& record) const {
+  return record.magic == MAGIC && record.layout == _layout && record.crc == Crc32::compute(reinterpret_cast<const uint8_t*>(&record), offsetof(Record, crc));
+}
@@ -0,0 +1,69 @@
+/**
+ * Persistent state of the relays.
+ *
+ * The states are kept as one bit per relay in RTC memory, which survives soft
+ * and watchdog resets without flash wear, and mirrored to flash for power
+ * loss. Flash writes are coalesced: they happen once the states were stable
+ * for FLASH_DELAY and only if they differ from the flash copy.
+ *
+ * The records carry the layout, a CRC of the ids and pins of the relays in
+ * slot order. A record of another layout, e.g. from before a firmware
+ * update added or reordered a relay, is ignored, the relays start off.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "Crc32.hpp"
+#ifdef ESP32
+#include <Preferences.h>
+#include <esp_attr.h>
+#elif defined(ESP8266)
+#include <EEPROM.h>
+#endif
+
+class RelayStateStore {
+
+public:
+  static const uint8_t MAX_RELAYS = 32;
+
+  enum Source { NONE, RTC, FLASH };
+
+  void   begin(uint32_t layout);
+  void   loop();
+  bool   get(uint8_t slot) const;
+  void   set(uint8_t slot, bool state);
+  Source getSource() const { return _source; }
+
+private:
+  static const uint32_t      MAGIC       = 0x504F4F4C;  // "POOL"
+  static const unsigned long FLASH_DELAY = 10000;       // in ms
+  // in 4-byte blocks, the first 128 bytes of the user RTC memory are wiped by OTA updates
+  static const uint32_t RTC_OFFSET = 32;
+
+  struct Record {
+    uint32_t magic;
+    uint32_t layout;
+    uint32_t states;
+    uint32_t crc;
+  };
+
+  uint32_t      _layout      = 0;
+  uint32_t      _states      = 0;
+  uint32_t      _flashStates = 0;
+  bool          _flashDirty  = false;
+  unsigned long _lastChange  = 0;
+  Source        _source      = NONE;
+
+#ifdef ESP32
+  Preferences _preferences;
+#endif
+
+  bool readRtc(Record& record);
+  void writeRtc(const Record& record);
+  bool readFlash(Record& record);
+  void writeFlash(const Record& record);
+
+  void seal(Record& record, uint32_t states) const;
+  bool isValid(const Record& record) const;
+};
@@ -6,6 +6,8 @@
 #include "TimeClientHelper.hpp"
 
 class RuleAuto : public Rule {
+  friend class Benchmarks;
+
 public:
   RuleAuto(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay);
 
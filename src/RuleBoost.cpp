@@ -1,5 +1,6 @@
 
 #include "RuleBoost.hpp"
+#include "Log.hpp"
 
 /**
  *
@@ -13,25 +14,25 @@ RuleBoost::RuleBoost(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay) {
  *
  */
 void RuleBoost::loop() {
-  Homie.getLogger() << cIndent << F("RuleBoost: loop") << endl;
+  LOG_DEBUG << cIndent << F("RuleBoost: loop") << endl;
   if (_poolRelay->getSwitch()) {
     if ((!_solarRelay->getSwitch())
       && (getPoolTemperature() < (getPoolMaxTemperature() - getTemperaturHysteresis()))
       && (getPoolTemperature() < (getSolarTemperature() - getTemperaturHysteresis()))) {
-      Homie.getLogger() << cIndent << F("RuleBoost: below max. Temperature. Switch solar on") << endl;
+      LOG_INFO << cIndent << F("RuleBoost: below max. Temperature. Switch solar on") << endl;
       _solarRelay->setSwitch(true);
 
     } else if ((_solarRelay->getSwitch())
       && (getPoolTemperature() > (getPoolMaxTemperature() + getTemperaturHysteresis()))
       && (getPoolTemperature() > (getSolarTemperature() + getTemperaturHysteresis()))) {
-      Homie.getLogger() << cIndent << F("RuleBoost: Max. Temperature reached. Switch solar off") << endl;
+      LOG_INFO << cIndent << F("RuleBoost: Max. Temperature reached. Switch solar off") << endl;
       _solarRelay->setSwitch(false);
 
     } else {
       // no change of status
     }
   } else {
-    Homie.getLogger() << cIndent << F("RuleBoost: pool pump is disabled.") << endl;
+    LOG_DEBUG << cIndent << F("RuleBoost: pool pump is disabled.") << endl;
     if (_solarRelay->getSwitch()) {
       _solarRelay->setSwitch(false);
     }
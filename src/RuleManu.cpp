@@ -1,5 +1,6 @@
 
 #include "RuleManu.hpp"
+#include "Log.hpp"
 
 
 /**
@@ -12,6 +13,6 @@ RuleManu::RuleManu() {}
  */
 void RuleManu::loop() {
   // no ruling if manual
-  Homie.getLogger() << F("RuleManu: loop") << endl;
+  LOG_DEBUG << F("RuleManu: loop") << endl;
   return;
 }
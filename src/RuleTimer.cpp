@@ -1,5 +1,6 @@
 
 #include "RuleTimer.hpp"
+#include "Log.hpp"
 
 /**
  *
@@ -15,9 +16,14 @@ RuleTimer::RuleTimer(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay) {
  *
  */
 void RuleTimer::loop() {
-  Homie.getLogger() << cIndent << F("§ RuleTimer: loop") << endl;
+  LOG_DEBUG << cIndent << F("§ RuleTimer: loop") << endl;
 
-  _poolRelay->setSwitch(checkPoolPumpTimer());
+  if (isTimeValid()) {
+    _poolRelay->setSwitch(checkPoolPumpTimer());
+  } else {
+    // no NTP sync yet: do not run the timer against 1970
+    LOG_WARNING << cIndent << F("✖ RuleTimer: time not valid, pool pump unchanged") << endl;
+  }
 
   if (_solarRelay->getSwitch()) {
     _solarRelay->setSwitch(false);
@@ -29,27 +35,12 @@ void RuleTimer::loop() {
  *
  */
 bool RuleTimer::checkPoolPumpTimer() {
-  Homie.getLogger() << F("↕  checkPoolPumpTimer") << endl;
-
-  tm  time = getCurrentDateTime();
-  bool retval;
-
-  tm startTime = getStartTime(getTimerSetting());
-  tm endTime   = getEndTime(getTimerSetting());
+  LOG_DEBUG << F("↕  checkPoolPumpTimer") << endl;
 
-  Homie.getLogger() << cIndent << F("time=      ") << asctime(&time);
-  Homie.getLogger() << cIndent << F("startTime= ") << asctime(&startTime);
-  Homie.getLogger() << cIndent << F("endTime=   ") << asctime(&endTime);
-
-  if (difftime(mktime(&time), mktime(&startTime)) >= 0
-    && difftime(mktime(&time), mktime(&endTime)) <= 0) {
-    retval = true;
-
-  } else {
-    retval = false;
-  }
+  const bool retval = isInTimerWindow(getTimerSetting());
 
-  Homie.getLogger() << cIndent << F("checkPoolPumpTimer = ") << retval << endl;
+  LOG_DEBUG << cIndent << F("time=") << getFormattedTime(getLocalEpoch()) << F(" ") << getTimeInfo() << endl;
+  LOG_DEBUG << cIndent << F("checkPoolPumpTimer = ") << retval << endl;
   return retval;
 }
 
@@ -6,6 +6,8 @@
 #include "TimeClientHelper.hpp"
 
 class RuleTimer : public Rule {
+  friend class Benchmarks;
+
 public:
   RuleTimer(RelayModuleNode* solarRelay, RelayModuleNode* poolRelay);
 
@@ -0,0 +1,203 @@
+/**
+ * Cooperative scheduler for periodic and one-shot tasks.
+ */
+
+#include "Scheduler.hpp"
+
+Scheduler scheduler;
+
+/**
+ *
+ */
+Scheduler::Task::Task(const char* name, Callback callback, void* context)
+    : _name(name), _callback(callback), _context(context) {}
+
+/**
+ *
+ */
+void Scheduler::Task::resetStats() {
+  _runs        = 0;
+  _maxLateness = 0;
+}
+
+/**
+ * Runs the task every interval ms, the first time after an automatic phase.
+ */
+void Scheduler::every(Task& task, unsigned long interval) {
+  if (interval < TICK) interval = TICK;
+
+  // golden ratio sequence: every prefix is spread evenly over the interval
+  const unsigned long phase = (unsigned long)(((uint32_t)_phaseIndex++ * 40503UL & 0xFFFF) * (uint64_t)interval >> 16);
+  every(task, interval, phase);
+}
+
+/**
+ * Runs the task every interval ms, the first time phase ms from now.
+ */
+void Scheduler::every(Task& task, unsigned long interval, unsigned long phase) {
+  start();
+  remove(task);
+
+  task._interval = (interval < TICK) ? TICK : interval;
+  task._due      = millis() + phase;
+  insert(task);
+}
+
+/**
+ * Runs the task once, delay ms from now.
+ */
+void Scheduler::after(Task& task, unsigned long delay) {
+  start();
+  remove(task);
+
+  task._interval = 0;
+  task._due      = millis() + delay;
+  insert(task);
+}
+
+/**
+ *
+ */
+void Scheduler::cancel(Task& task) {
+  remove(task);
+}
+
+/**
+ * Processes the slots of all ticks that ended before now. After a long
+ * stall every slot is processed once, which catches all overdue tasks.
+ */
+void Scheduler::loop(bool connected) {
+  if (!_started) return;
+  _connected = connected;
+
+  const unsigned long now   = millis();
+  unsigned long       ticks = (now - _tickStart) / TICK;
+  if (ticks == 0) return;
+
+  if (ticks > SLOTS) {
+    _cursor = (_cursor + (ticks - SLOTS)) % SLOTS;
+    _tickStart += (ticks - SLOTS) * TICK;
+    ticks = SLOTS;
+  }
+
+  while (ticks-- > 0) {
+    processSlot(_tickStart + TICK);
+    _cursor = (_cursor + 1) % SLOTS;
+    _tickStart += TICK;
+  }
+}
+
+/**
+ * The longest delay of a deadline since the last reset of the task stats.
+ */
+uint32_t Scheduler::getMaxLateness() const {
+  uint32_t lateness = 0;
+  for (const Task* task = _tasks; task != NULL; task = task->_nextTask) {
+    if (task->_maxLateness > lateness) lateness = task->_maxLateness;
+  }
+  return lateness;
+}
+
+/**
+ *
+ */
+void Scheduler::start() {
+  if (!_started) {
+    _started   = true;
+    _tickStart = millis();
+  }
+}
+
+/**
+ * Puts the task into the slot of its due tick, overdue tasks into the
+ * current one.
+ */
+void Scheduler::insert(Task& task) {
+  if (!task._known) {
+    task._known    = true;
+    task._nextTask = _tasks;
+    _tasks         = &task;
+  }
+
+  const long ahead = (long)(task._due - _tickStart);
+  uint8_t    slot  = (ahead <= 0) ? _cursor : (_cursor + (unsigned long)ahead / TICK) % SLOTS;
+  if (_processing && ahead < (long)TICK) {
+    // the current slot is being processed, the next one catches it
+    slot = (_cursor + 1) % SLOTS;
+  }
+
+  task._slot   = slot;
+  task._next   = _slots[slot];
+  _slots[slot] = &task;
+}
+
+/**
+ *
+ */
+void Scheduler::remove(Task& task) {
+  if (task._slot == Task::NONE) return;
+
+  Task** link = (task._slot == Task::PENDING) ? &_pending : &_slots[task._slot];
+  while (*link != NULL && *link != &task) {
+    link = &(*link)->_next;
+  }
+  if (*link != NULL) {
+    *link = task._next;
+  }
+
+  task._next = NULL;
+  task._slot = Task::NONE;
+}
+
+/**
+ * Runs the tasks of the current slot that are due before tickEnd, the
+ * others belong to a later round of the wheel and go back.
+ */
+void Scheduler::processSlot(unsigned long tickEnd) {
+  // callbacks may (re)schedule or cancel any task, also one of this slot
+  _processing     = true;
+  _pending        = _slots[_cursor];
+  _slots[_cursor] = NULL;
+  for (Task* task = _pending; task != NULL; task = task->_next) {
+    task->_slot = Task::PENDING;
+  }
+
+  while (_pending != NULL) {
+    Task& task = *_pending;
+    _pending   = task._next;
+    task._next = NULL;
+    task._slot = Task::NONE;
+
+    if ((long)(task._due - tickEnd) < 0) {
+      run(task, millis());
+    } else {
+      insert(task);
+    }
+  }
+  _processing = false;
+}
+
+/**
+ *
+ */
+void Scheduler::run(Task& task, unsigned long now) {
+  if (!_connected && !task._runDisconnected) {
+    if (task._interval > 0) {
+      task._due += ((now - task._due) / task._interval + 1) * task._interval;
+    }
+    insert(task);  // a one-shot task stays due
+    return;
+  }
+
+  const uint32_t lateness = (long)(now - task._due) > 0 ? now - task._due : 0;
+  if (lateness > task._maxLateness) task._maxLateness = lateness;
+  task._runs++;
+
+  if (task._interval > 0) {
+    // next period in phase, skipping the ones already missed
+    task._due += ((now - task._due) / task._interval + 1) * task._interval;
+    insert(task);
+  }
+
+  task._callback(task._context);
+}
@@ -0,0 +1,93 @@
+/**
+ * Cooperative scheduler for periodic and one-shot tasks.
+ *
+ * Tasks sit in a hashed timer wheel of SLOTS lists, one per TICK. loop()
+ * only compares millis() between ticks and walks one slot per elapsed tick,
+ * so a pass without a deadline costs next to nothing. Periodic tasks keep
+ * their phase: a task that is late runs once and skips the missed periods.
+ * Without an explicit phase the first run is placed on a low discrepancy
+ * sequence over the interval, so tasks of equal interval don't fire together.
+ *
+ *   Scheduler::Task _measureTask{getId(), [](void* node) { static_cast<MyNode*>(node)->measure(); }, this};
+ *   scheduler.every(_measureTask, 30000);
+ *
+ * While Homie is disconnected only the tasks marked with setRunDisconnected()
+ * run, the others skip their periods and one-shot tasks wait.
+ *
+ * Tasks must outlive their schedule, they are members of the static nodes.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class Scheduler {
+
+public:
+  typedef void (*Callback)(void* context);
+
+  static const unsigned long TICK  = 10;  // in ms
+  static const uint8_t       SLOTS = 128;
+
+  class Task {
+    friend class Scheduler;
+
+  public:
+    Task(const char* name, Callback callback, void* context);
+
+    const char*   getName() const { return _name; }
+    bool          isScheduled() const { return _slot != NONE; }
+    unsigned long getInterval() const { return _interval; }
+    uint32_t      getRuns() const { return _runs; }
+    uint32_t      getMaxLateness() const { return _maxLateness; }  // in ms
+    void          resetStats();
+    void          setRunDisconnected(bool run) { _runDisconnected = run; }
+
+  private:
+    static const uint8_t NONE    = 0xFF;
+    static const uint8_t PENDING = 0xFE;  // taken out of its slot by loop()
+
+    const char*   _name;
+    Callback      _callback;
+    void*         _context;
+    unsigned long _interval        = 0;  // in ms, 0 = one-shot
+    unsigned long _due             = 0;
+    uint8_t       _slot            = NONE;
+    Task*         _next            = NULL;  // in the slot
+    Task*         _nextTask        = NULL;  // of all tasks
+    bool          _known           = false;
+    bool          _runDisconnected = false;
+
+    uint32_t _runs        = 0;
+    uint32_t _maxLateness = 0;
+  };
+
+  void every(Task& task, unsigned long interval);
+  void every(Task& task, unsigned long interval, unsigned long phase);
+  void after(Task& task, unsigned long delay);
+  void cancel(Task& task);
+  void loop(bool connected = true);
+
+  Task*    getFirstTask() const { return _tasks; }
+  Task*    getNextTask(const Task* task) const { return task->_nextTask; }
+  uint32_t getMaxLateness() const;
+
+private:
+  Task*         _slots[SLOTS] = {};
+  Task*         _pending      = NULL;  // of the slot being processed
+  Task*         _tasks        = NULL;
+  uint8_t       _cursor       = 0;  // slot of the tick starting at _tickStart
+  unsigned long _tickStart    = 0;
+  bool          _started      = false;
+  bool          _processing   = false;
+  bool          _connected    = true;
+  uint16_t      _phaseIndex   = 0;
+
+  void start();
+  void insert(Task& task);
+  void remove(Task& task);
+  void processSlot(unsigned long tickEnd);
+  void run(Task& task, unsigned long now);
+};
+
+extern Scheduler scheduler;
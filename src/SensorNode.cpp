@@ -8,6 +8,7 @@
  */
 
 #include "SensorNode.hpp"
+#include "Log.hpp"
 
 SensorNode::SensorNode(const char *id, const char *name, const char *type)
     : HomieNode(id, name, type),
@@ -50,7 +51,7 @@ void SensorNode::fixRange(float *value, float min, float max)
 
 void SensorNode::printCaption()
 {
-  Homie.getLogger() << _caption << endl;
+  LOG_DEBUG << _caption << endl;
 }
 
 
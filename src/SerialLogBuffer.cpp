@@ -0,0 +1,125 @@
+/**
+ * Non-blocking serial log output.
+ */
+
+#include "SerialLogBuffer.hpp"
+
+SerialLogBuffer serialLog(Serial);
+
+/**
+ *
+ */
+size_t SerialLogBuffer::write(uint8_t c) {
+  const uint32_t start = ESP.getCycleCount();
+  put(c);
+  _cycles += ESP.getCycleCount() - start;
+  return 1;
+}
+
+/**
+ *
+ */
+size_t SerialLogBuffer::write(const uint8_t* buffer, size_t size) {
+  const uint32_t start = ESP.getCycleCount();
+  for (size_t i = 0; i < size; i++) {
+    put(buffer[i]);
+  }
+  _cycles += ESP.getCycleCount() - start;
+  return size;
+}
+
+/**
+ * Blocks until everything is sent, only for the "flushlog" setting.
+ */
+void SerialLogBuffer::flush() {
+  while (_tail != _head) {
+    if (drain(BUFFER_SIZE) == 0) {
+      yield();
+    }
+  }
+  _serial.flush();
+}
+
+/**
+ * Sends as much as the UART takes without waiting. Call from the main loop.
+ */
+void SerialLogBuffer::loop() {
+  const uint32_t start = ESP.getCycleCount();
+  drain(BUFFER_SIZE);
+  _cycles += ESP.getCycleCount() - start;
+
+  _lastLoopTime = _cycles / ESP.getCpuFreqMHz();
+  if (_lastLoopTime > _maxLoopTime) {
+    _maxLoopTime = _lastLoopTime;
+  }
+  _cycles = 0;
+}
+
+/**
+ * On overflow the unfinished line is taken back, if it wasn't sent partly,
+ * and the rest of it is discarded.
+ */
+void SerialLogBuffer::put(uint8_t c) {
+  if (_dropping) {
+    if (c == '\n') {
+      _dropping = false;
+      // terminate a line that went out partly
+      if (_head != _lineStart && _head - _tail < BUFFER_SIZE) {
+        _buffer[_head++ % BUFFER_SIZE] = c;
+      }
+      _lineStart = _head;
+    }
+    return;
+  }
+
+  while (_booting && _head - _tail >= BUFFER_SIZE) {
+    if (drain(BUFFER_SIZE) == 0) {
+      yield();
+    }
+  }
+
+  if (_head - _tail >= BUFFER_SIZE) {
+    if ((int32_t)(_lineStart - _tail) >= 0) {
+      _head = _lineStart;
+    }
+    _dropping = true;
+    _dropped++;
+    return;
+  }
+
+  _buffer[_head++ % BUFFER_SIZE] = c;
+  if (_head - _tail > _highWater) {
+    _highWater = _head - _tail;
+  }
+
+  if (c == '\n') {
+    _lineStart = _head;
+  }
+}
+
+/**
+ * @return number of bytes handed to the UART
+ */
+size_t SerialLogBuffer::drain(size_t max) {
+  size_t sent = 0;
+
+  while (_tail != _head && sent < max) {
+    const int room = _serial.availableForWrite();
+    if (room <= 0) {
+      break;
+    }
+
+    // contiguous part up to the end of the ring
+    const size_t index = _tail % BUFFER_SIZE;
+    size_t       count = _head - _tail;
+    if (count > BUFFER_SIZE - index) count = BUFFER_SIZE - index;
+    if (count > (size_t)room) count = room;
+    if (count > max - sent) count = max - sent;
+
+    _serial.write(reinterpret_cast<const uint8_t*>(_buffer + index), count);
+    _tail += count;
+    sent += count;
+  }
+
+  return sent;
+}
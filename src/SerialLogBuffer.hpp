@@ -0,0 +1,59 @@
+/**
+ * Non-blocking serial log output.
+ *
+ * Log text is written into a RAM ring and moved to the UART by loop() in
+ * slices no larger than the free space of the TX FIFO, so printing never
+ * waits for the wire. If the ring is full the current line is discarded
+ * and counted instead of stalling the control loop. Until endBoot() a full
+ * ring waits for the UART instead, so the boot output gets out whole: the
+ * firmware ends the boot after Homie's setup handler ran, which is once
+ * WiFi and MQTT are connected.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class SerialLogBuffer : public Print {
+
+public:
+  static const size_t BUFFER_SIZE = 1024;  // power of two
+
+  explicit SerialLogBuffer(HardwareSerial& serial) : _serial(serial) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  void   flush() override;
+  void   loop();
+  void   endBoot() { _booting = false; }
+
+  uint32_t getDropped() const { return _dropped; }
+  size_t   getHighWater() const { return _highWater; }
+  uint32_t getLastLoopTime() const { return _lastLoopTime; }  // in µs
+  uint32_t getMaxLoopTime() const { return _maxLoopTime; }    // in µs
+  void     resetMaxLoopTime() { _maxLoopTime = 0; }
+
+  using Print::write;
+
+private:
+  HardwareSerial& _serial;
+
+  char _buffer[BUFFER_SIZE];
+  // running byte counters, the ring index is counter % BUFFER_SIZE
+  uint32_t _head      = 0;
+  uint32_t _tail      = 0;
+  uint32_t _lineStart = 0;
+  bool     _dropping  = false;
+  bool     _booting   = true;  // until endBoot()
+
+  uint32_t _dropped      = 0;
+  size_t   _highWater    = 0;
+  uint32_t _cycles       = 0;  // spent in write() and loop() since the last loop()
+  uint32_t _lastLoopTime = 0;
+  uint32_t _maxLoopTime  = 0;
+
+  void   put(uint8_t c);
+  size_t drain(size_t max);
+};
+
+extern SerialLogBuffer serialLog;
@@ -0,0 +1,147 @@
+/**
+ * Homie Node with the whole controller state in one JSON document.
+ */
+
+#include "StateNode.hpp"
+#include "JsonValue.hpp"
+#include "Log.hpp"
+
+/**
+ *
+ */
+StateNode::StateNode(const char* id, const char* name)
+    : HomieNode(id, name, "state") {
+  _document[0] = '\0';
+}
+
+/**
+ *
+ */
+void StateNode::setup() {
+  advertise("state").setName("Controller state").setDatatype("string");
+}
+
+/**
+ * Publishes the document after a change, at most every spacing ms.
+ */
+void StateNode::loop() {
+  if (!_changed || millis() - _lastPublish < _spacing) return;
+
+  _changed     = false;
+  _lastPublish = millis();
+  publishQueue.send(*this, "state", _document, PublishQueue::SETTING);
+}
+
+/**
+ * Takes the property of the node into the document. False when full.
+ */
+bool StateNode::add(const HomieNode& node, const char* property) {
+  if (_enabled || _fieldCount >= MAX_FIELDS) return false;
+
+  _fields[_fieldCount++] = {&node, property, 0, 0};
+  return true;
+}
+
+/**
+ * Lays out the document and starts to take in the values.
+ */
+void StateNode::begin(unsigned long spacing) {
+  _spacing = spacing;
+  layout();
+  _enabled = true;
+  publishQueue.addListener(onPublish, this);
+}
+
+/**
+ * The document with null values, fields that don't fit are left out.
+ */
+void StateNode::layout() {
+  const HomieNode* node = NULL;
+  size_t           length = 1;
+  _document[0]            = '{';
+
+  for (uint8_t i = 0; i < _fieldCount; i++) {
+    const Field& field = _fields[i];
+    // "},"node":{" + "property": + null + "}}"
+    const size_t needed = 4 + strlen(field.node->getId()) + 4 + strlen(field.property) + 3 + 4 + 2;
+    if (length + needed >= DOCUMENT_SIZE) {
+      LOG_WARNING << F("✖ State document full, left out from: ") << field.node->getId() << F("/") << field.property << endl;
+      _fieldCount = i;
+      break;
+    }
+
+    if (field.node != node) {
+      length += snprintf(_document + length, DOCUMENT_SIZE - length, "%s\"%s\":{", (node == NULL) ? "" : "},", field.node->getId());
+      node = field.node;
+    } else {
+      _document[length++] = ',';
+    }
+    length += snprintf(_document + length, DOCUMENT_SIZE - length, "\"%s\":", field.property);
+
+    _fields[i].offset = length;
+    _fields[i].length = 4;
+    memcpy(_document + length, "null", 4);
+    length += 4;
+  }
+
+  if (node != NULL) _document[length++] = '}';
+  _document[length++] = '}';
+  _document[length]   = '\0';
+  _length             = length;
+}
+
+/**
+ * Patches a value of the document, if the property is in it.
+ */
+void StateNode::update(const HomieNode& node, const char* property, const String& value) {
+  for (uint8_t i = 0; i < _fieldCount; i++) {
+    const Field& field = _fields[i];
+    if (field.node != &node || (field.property != property && strcmp(field.property, property) != 0)) continue;
+
+    char   text[VALUE_SIZE];
+    size_t length = JsonValue::format(text, sizeof(text), value.c_str());
+    if (length == 0) {
+      _overflows++;
+      memcpy(text, "null", 4);
+      length = 4;
+    }
+    if (length == field.length && memcmp(_document + field.offset, text, length) == 0) return;
+
+    if (!patch(i, text, length)) {
+      _overflows++;
+      if (!patch(i, "null", 4)) return;  // keeps the old value
+    }
+    _changed = true;
+    return;
+  }
+}
+
+/**
+ * Replaces the value of a field, the rest of the document moves if the
+ * length changes. False if it doesn't fit.
+ */
+bool StateNode::patch(uint8_t index, const char* text, size_t length) {
+  Field&    field = _fields[index];
+  const int delta = (int)length - (int)field.length;
+  if (_length + delta >= DOCUMENT_SIZE) return false;
+
+  char* value = _document + field.offset;
+  if (delta != 0) {
+    memmove(value + length, value + field.length, _length - field.offset - field.length + 1);  // with the '\0'
+    for (uint8_t i = index + 1; i < _fieldCount; i++) {
+      _fields[i].offset += delta;
+    }
+    _length += delta;
+  }
+  memcpy(value, text, length);
+  field.length = length;
+  return true;
+}
+
+/**
+ * Listener of the publish queue, values of ranges aren't in the document.
+ */
+void StateNode::onPublish(void* context, const HomieNode& node, const char* property, const HomieRange& range,
+                          PublishQueue::Priority priority, const String& value) {
+  if (!range.isRange) static_cast<StateNode*>(context)->update(node, property, value);
+}
@@ -0,0 +1,67 @@
+/**
+ * Homie Node with the whole controller state in one retained JSON document,
+ * so a dashboard syncs with one message instead of dozens of topics:
+ *
+ *   {"pool-temp":{"tempSucPool":77.50,"tempSucPoolState":"OK",..},"pool-pump":{"switch":true},..,
+ *    "operation-mode":{"mode":"auto","pool-max-temp":75.50,..}}
+ *
+ * The properties taken in are listed with add(), those of a node together,
+ * before begin(). The node sees their values as the nodes hand them to the
+ * publish queue and patches them into the document in place: the document
+ * is laid out once in a preallocated buffer with null values, a change
+ * moves the rest of the document only when the length of the value
+ * changes. Numbers, true, false and JSON objects go in as they are, other
+ * values as strings. The document goes out on change, at most every
+ * spacing ms.
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+#include "PublishQueue.hpp"
+
+class StateNode : public HomieNode {
+
+public:
+  static const uint8_t MAX_FIELDS    = 40;
+  static const size_t  DOCUMENT_SIZE = 1536;
+  static const size_t  VALUE_SIZE    = 128;
+
+  StateNode(const char* id, const char* name);
+
+  bool add(const HomieNode& node, const char* property);
+  void begin(unsigned long spacing);
+  bool isEnabled() const { return _enabled; }
+
+  const char* getDocument() const { return _document; }
+  uint32_t    getOverflows() const { return _overflows; }  // values that didn't fit and went in as null
+
+protected:
+  void setup() override;
+  void loop() override;
+
+private:
+  struct Field {
+    const HomieNode* node;
+    const char*      property;
+    uint16_t         offset;  // of the value in the document
+    uint16_t         length;
+  };
+
+  Field         _fields[MAX_FIELDS];
+  uint8_t       _fieldCount = 0;
+  char          _document[DOCUMENT_SIZE];
+  size_t        _length      = 0;
+  bool          _enabled     = false;
+  bool          _changed     = false;
+  unsigned long _spacing     = 0;  // in ms
+  unsigned long _lastPublish = 0;
+  uint32_t      _overflows   = 0;
+
+  void layout();
+  void update(const HomieNode& node, const char* property, const String& value);
+  bool patch(uint8_t index, const char* text, size_t length);
+
+  static void onPublish(void* context, const HomieNode& node, const char* property, const HomieRange& range,
+                        PublishQueue::Priority priority, const String& value);
+};
@@ -7,64 +7,70 @@
 // NTP Client
 const char *TC_SERVER = "us.pool.ntp.org";
 
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, TC_SERVER);
+NtpClock ntpClock(TC_SERVER);
 
-// For starters use hardwired Central European Time (Berlin, Paris, ...)
-TimeChangeRule usPDT = {"PDT", Second, Sun, Mar, 2, -420};  //UTC - 7 hours
-TimeChangeRule usPST = {"PST", First, Sun, Nov, 2, -480};   //UTC - 8 hours
-Timezone usPacific(usPDT, usPST);
-
-//TimeChangeRule CEST = {"CEST", Last, Sun, Mar, 2, 120}; // Central European Summer Time
-//TimeChangeRule CET = {"CET ", Last, Sun, Oct, 3, 60};   // Central European Standard Time
-//Timezone Europe(CEST, CET);
-
-// Japanese Time Zone (Tokyo)
-TimeChangeRule JPST = {"JST", First, Sun, Mar, 0, 9 * 60}; // UTC + 9 hours
-Timezone Japan(JPST, JPST);
-
-TimeZoneInfo _timezones[2] = {
-  {"Los Angeles", &usPacific},
-  {"Tokyo", &Japan}
-};
+// Local time zone, configured at runtime by a POSIX TZ string
+PosixTimezone localTimezone;
 
 void timeClientSetup() {
   // initialize NTP Client
-  timeClient.begin();
+  ntpClock.begin();
 
   // Set callback for time library and leave the sync to the NTP client
   setSyncProvider(getUtcTime);
   setSyncInterval(0);
 }
 
-int getTzCount() {
-  return (sizeof(_timezones) / sizeof(_timezones[0]));
+/**
+ * Resyncs the clock in the background. Call from the main loop.
+ */
+void timeClientLoop() {
+  ntpClock.loop();
+}
+
+/**
+ * False until the first NTP sync and after the holdover limit expired.
+ */
+bool isTimeValid() {
+  return ntpClock.isValid();
+}
+
+const NtpClock& getClock() {
+  return ntpClock;
 }
 
+/**
+ * @param tz POSIX TZ string, e.g. "PST8PDT,M3.2.0,M11.1.0"
+ * @return false if tz is invalid, the zone is unchanged then
+ */
+bool setTimezone(const char* tz) {
+  return localTimezone.setRule(tz);
+}
+
+const char* getTimezone() {
+  return localTimezone.getRule();
+}
+
+/**
+ * Constant time, no network I/O. Returns 0 while the time is not valid.
+ */
 time_t getUtcTime() {
-  if (timeClient.update()) {
-    return timeClient.getEpochTime();
-  }   else {
-    return 0;
-  }
+  return ntpClock.now();
 }
 
-time_t getTimeFor(int index, TimeChangeRule **tcr) {
-  if (index < getTzCount()) {
-    // Zeturn the time for the selected time zone
-    return _timezones[index].timezone->toLocal(getUtcTime(), tcr);
-  } else {
-    return getUtcTime();
-  }
+/**
+ * Local time in seconds since 1970-01-01 local midnight. Constant time, the
+ * DST transitions of the current year are cached by the time zone.
+ */
+time_t getLocalEpoch() {
+  return localTimezone.toLocal(getUtcTime());
 }
 
-String getTimeInfoFor(int index) {
-  if (index < getTzCount()) {
-    // Return the time for the selected time zone
-    return _timezones[index].description;
-  } else {
-    return "UTC";
-  }
+/**
+ * @return abbreviation of the time zone currently in effect, e.g. "PDT"
+ */
+String getTimeInfo() {
+  return localTimezone.getAbbrev(getUtcTime());
 }
 
 String getFormattedTime(time_t rawTime) {
@@ -5,19 +5,16 @@
 #pragma once
 
 #include "TimeLib.h"
-#include "Timezone.h"
-#include <WiFiUdp.h>
-#include <NTPClient.h>
-
-struct TimeZoneInfo
-{
-  char description[21]; // 20 chars max
-  Timezone *timezone;
-};
+#include "NtpClock.hpp"
+#include "PosixTimezone.hpp"
 
 void timeClientSetup();
-int getTzCount();
+void timeClientLoop();
+bool isTimeValid();
+const NtpClock& getClock();
+bool setTimezone(const char* tz);
+const char* getTimezone();
 time_t getUtcTime();
-time_t getTimeFor(int index, TimeChangeRule **tcr);
-String getTimeInfoFor(int index);
+time_t getLocalEpoch();
+String getTimeInfo();
 String getFormattedTime(time_t rawTime);
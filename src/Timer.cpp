@@ -5,29 +5,25 @@
  */
 tm getCurrentDateTime() {
 
-  TimeChangeRule *tcr = NULL;
-  time_t     t        = getTimeFor(0, &tcr);
-  struct tm timeinfo =  *localtime(&t);
+  time_t    t = getLocalEpoch();
+  struct tm timeinfo;
+  gmtime_r(&t, &timeinfo);
 
   return timeinfo;
 }
 
-tm getStartTime(TimerSetting timerSetting) {
-  tm startTime      = getCurrentDateTime();
-  startTime.tm_hour = timerSetting.timerStartHour;
-  startTime.tm_min  = timerSetting.timerStartMinutes;
-  startTime.tm_sec  = 0;
-
-  return startTime;
-}
-
-tm getEndTime(TimerSetting timerSetting) {
-  tm endTime      = getCurrentDateTime();
-  endTime.tm_hour = timerSetting.timerEndHour;
-  endTime.tm_min  = timerSetting.timerEndMinutes;
-  endTime.tm_sec  = 0;
-
-  return endTime;
+/**
+ * True if the local time of day is between timer start and end, both inclusive.
+ * A window with end before start spans midnight.
+ */
+bool isInTimerWindow(TimerSetting timerSetting) {
+  const long now   = getLocalEpoch() % 86400L;
+  const long start = timerSetting.timerStartHour * 3600L + timerSetting.timerStartMinutes * 60L;
+  const long end   = timerSetting.timerEndHour * 3600L + timerSetting.timerEndMinutes * 60L;
+
+  if (start <= end) {
+    return now >= start && now <= end;
+  } else {
+    return now >= start || now <= end;
+  }
 }
-
-
@@ -9,6 +9,5 @@ struct TimerSetting {
   unsigned int timerEndMinutes;
 };
 
-tm getCurrentDateTime();
-tm getStartTime(TimerSetting ts);
-tm getEndTime(TimerSetting ts);
+tm   getCurrentDateTime();
+bool isInTimerWindow(TimerSetting ts);
@@ -0,0 +1,240 @@
+/**
+ * Field trace of sensor readings, commands and relay transitions.
+ */
+
+#include "TraceRecorder.hpp"
+#include <ESPAsyncWebServer.h>
+#include "FileSystem.hpp"
+#include "Log.hpp"
+#include "TimeClientHelper.hpp"
+
+TraceRecorder traceRecorder;
+
+const char* const TraceRecorder::FILE_PATH     = "/trace.bin";
+const char* const TraceRecorder::OLD_FILE_PATH = "/trace.old";
+
+static AsyncWebServer traceServer(80);
+
+/**
+ * Mounts the file system and serves the trace files. Call once connected.
+ */
+void TraceRecorder::begin(const char* firmwareVersion) {
+  _firmwareVersion = firmwareVersion;
+  if (_mounted) return;
+
+  _mounted = mountFileSystem();
+  if (!_mounted) {
+    LOG_WARNING << F("✖ trace: file system not mounted") << endl;
+    return;
+  }
+  traceServer.serveStatic(FILE_PATH, FILE_SYSTEM, FILE_PATH).setCacheControl("no-cache");
+  traceServer.serveStatic(OLD_FILE_PATH, FILE_SYSTEM, OLD_FILE_PATH).setCacheControl("no-cache");
+  traceServer.begin();
+}
+
+/**
+ * Writes the TIME record once the clock is valid and flushes the buffer
+ * once a minute. Call from the main loop.
+ */
+void TraceRecorder::loop() {
+  if (!_recording) return;
+
+  if (!_timeWritten && isTimeValid()) {
+    writeTime();
+  }
+  if (_length > 0 && millis() - _lastFlush >= FLUSH_PERIOD) {
+    flush();
+  }
+}
+
+/**
+ * Starts a segment: the TIME record as soon as the time is known, then the
+ * snapshot of the current state.
+ */
+void TraceRecorder::start() {
+  if (_recording || !_mounted) return;
+
+  _recording   = true;
+  _timeWritten = false;
+  _lastFlush   = millis();
+  if (isTimeValid()) {
+    writeTime();
+  }
+  if (_snapshot) {
+    _snapshot();
+  }
+  LOG_INFO << F("✔ trace: recording to ") << FILE_PATH << endl;
+}
+
+/**
+ *
+ */
+void TraceRecorder::stop() {
+  if (!_recording) return;
+
+  _recording = false;  // a new file gets its TIME and snapshot with the next start()
+  flush();
+  LOG_INFO << F("✔ trace: stopped, records dropped: ") << _dropped << endl;
+}
+
+/**
+ * Removes both files, a running recording goes on in a new file.
+ */
+void TraceRecorder::clear() {
+  if (!_mounted) return;
+
+  _length = 0;
+  FILE_SYSTEM.remove(FILE_PATH);
+  FILE_SYSTEM.remove(OLD_FILE_PATH);
+  if (_recording) {
+    _recording = false;
+    start();
+  }
+}
+
+/**
+ * Temperatures go in as 1/100 °F, the disconnected value of -196.6 °F included.
+ */
+void TraceRecorder::sensor(uint8_t pin, const uint8_t* address, float fahrenheit) {
+  uint8_t* p = reserve(TYPE_SENSOR, 1 + 8 + 2);
+  if (p == NULL) return;
+
+  const int16_t temperature = (int16_t)lroundf(constrain(fahrenheit, -320.0F, 320.0F) * 100);
+  *p++ = pin;
+  p    = put(p, address, 8);
+  put(p, &temperature, sizeof(temperature));
+}
+
+/**
+ * @param range index of a range property, -1 for none
+ */
+void TraceRecorder::input(const char* node, int16_t range, const char* property, const char* value) {
+  writeCommand(TYPE_INPUT, node, range, property, value);
+}
+
+/**
+ *
+ */
+void TraceRecorder::state(const char* node, const char* property, const char* value) {
+  writeCommand(TYPE_STATE, node, -1, property, value);
+}
+
+/**
+ *
+ */
+void TraceRecorder::relay(uint8_t pin, bool state) {
+  uint8_t* p = reserve(TYPE_RELAY, 2);
+  if (p == NULL) return;
+
+  p[0] = pin;
+  p[1] = state ? 1 : 0;
+}
+
+/**
+ * Payloads are cut to the 255 bytes a record holds, values first.
+ */
+void TraceRecorder::writeCommand(Type type, const char* node, int16_t range, const char* property, const char* value) {
+  const size_t nodeLength     = min(strlen(node), (size_t)64);
+  const size_t propertyLength = min(strlen(property), (size_t)64);
+  const size_t valueLength    = min(strlen(value), 255 - 3 - nodeLength - propertyLength);
+
+  uint8_t* p = reserve(type, 3 + nodeLength + propertyLength + valueLength);
+  if (p == NULL) return;
+
+  *p++ = (range >= 0 && range < 0xFF) ? range : 0xFF;
+  *p++ = nodeLength;
+  p    = put(p, node, nodeLength);
+  *p++ = propertyLength;
+  p    = put(p, property, propertyLength);
+  put(p, value, valueLength);
+}
+
+/**
+ *
+ */
+void TraceRecorder::writeTime() {
+  uint8_t* p = reserve(TYPE_TIME, 4);
+  if (p == NULL) return;
+
+  const uint32_t utc = getUtcTime();
+  put(p, &utc, sizeof(utc));
+  _timeWritten = true;
+}
+
+/**
+ * Room for a record in the buffer, which is flushed first if needed.
+ * @return payload to fill in, NULL if not recording or the record is lost
+ */
+uint8_t* TraceRecorder::reserve(Type type, size_t payload) {
+  if (!_recording) return NULL;
+
+  const size_t size = 6 + payload;
+  if (_length + size > BUFFER_SIZE) {
+    flush();
+    if (_length + size > BUFFER_SIZE) {
+      _dropped++;
+      return NULL;
+    }
+  }
+
+  const uint32_t now = millis();
+  uint8_t*       p   = put(_buffer + _length, &now, sizeof(now));
+  *p++ = type;
+  *p++ = payload;
+  _length += size;
+  return p;
+}
+
+/**
+ * Appends the buffer to the file. Once another buffer might not fit, the
+ * file moves to OLD_FILE_PATH and the new one starts like a segment, with
+ * the TIME record and the snapshot, so each file replays on its own.
+ */
+void TraceRecorder::flush() {
+  _lastFlush = millis();
+  if (_length == 0) return;
+
+  File file = FILE_SYSTEM.open(FILE_PATH, "a");
+  if (!file) {
+    _dropped++;
+    _length = 0;
+    return;
+  }
+
+  if (file.size() == 0) {
+    uint8_t        header[7 + 32];
+    const uint32_t magic   = MAGIC;
+    const uint16_t version = VERSION;
+    const uint8_t  length  = min(strlen(_firmwareVersion), (size_t)32);
+    uint8_t*       p       = put(header, &magic, sizeof(magic));
+    p                      = put(p, &version, sizeof(version));
+    *p++                   = length;
+    p                      = put(p, _firmwareVersion, length);
+    file.write(header, p - header);
+  }
+
+  if (file.write(_buffer, _length) != _length) {
+    _dropped++;
+  }
+  const bool full = file.size() + BUFFER_SIZE > MAX_FILE_SIZE;
+  file.close();
+  _length = 0;
+
+  if (full) {
+    FILE_SYSTEM.remove(OLD_FILE_PATH);
+    FILE_SYSTEM.rename(FILE_PATH, OLD_FILE_PATH);
+
+    _timeWritten = false;
+    if (isTimeValid()) {
+      writeTime();
+    }
+    if (_recording && _snapshot) {
+      _snapshot();
+    }
+  }
+}
+
+uint8_t* TraceRecorder::put(uint8_t* p, const void* data, size_t size) {
+  memcpy(p, data, size);
+  return p + size;
+}
@@ -0,0 +1,86 @@
+/**
+ * Field trace of sensor readings, commands and relay transitions.
+ *
+ * While recording, every DS18B20 reading, every MQTT command that reaches
+ * a node's handleInput() and every relay transition is appended as a small
+ * timestamped record to /trace.bin on the file system, through a RAM buffer
+ * that is written out when it is full or once a minute. At MAX_FILE_SIZE
+ * the file moves to /trace.old, so two files are kept, and the new one
+ * starts with the TIME record and the snapshot again. Both can be
+ * downloaded at http://<device>/trace.bin and /trace.old while the
+ * controller is connected, lib/NativeHal/src/ReplayMain.cpp replays them.
+ *
+ * File: header "PTRC", u16 version, u8 length, firmware version, then the
+ * records: u32 millis, u8 type, u8 payload length, payload. Little endian.
+ *
+ *   TIME    u32 UTC at millis: starts a segment, once per start() and boot
+ *   STATE   like INPUT, the state at the start of a segment
+ *   SENSOR  u8 pin, u8[8] address, i16 temperature in 1/100 °F
+ *   INPUT   u8 range index (0xFF: none), u8 length, node id, u8 length, property, value
+ *   RELAY   u8 pin, u8 state
+ *
+ * A sensor reading costs 17 bytes, about 250 kB a day with the default
+ * sensors and intervals.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+class TraceRecorder {
+
+public:
+  static const uint32_t MAGIC         = 0x43525450;  // "PTRC"
+  static const uint16_t VERSION       = 1;
+  static const size_t   BUFFER_SIZE   = 512;
+  static const size_t   MAX_FILE_SIZE = 256 * 1024UL;
+  static const uint32_t FLUSH_PERIOD  = 60000UL;  // in ms
+
+  enum Type : uint8_t { TYPE_TIME = 1, TYPE_STATE, TYPE_SENSOR, TYPE_INPUT, TYPE_RELAY };
+
+  typedef std::function<void()> SnapshotFunction;
+
+  void begin(const char* firmwareVersion);
+  void loop();
+
+  /** Writes the initial STATE records of a segment, through state(). */
+  void setSnapshotFunction(const SnapshotFunction& function) { _snapshot = function; }
+
+  void start();
+  void stop();
+  void clear();
+  bool isRecording() const { return _recording; }
+
+  void sensor(uint8_t pin, const uint8_t* address, float fahrenheit);
+  void input(const char* node, int16_t range, const char* property, const char* value);
+  void state(const char* node, const char* property, const char* value);
+  void relay(uint8_t pin, bool state);
+
+  uint32_t getDropped() const { return _dropped; }
+
+  static const char* const FILE_PATH;
+  static const char* const OLD_FILE_PATH;
+
+private:
+  const char* _firmwareVersion = "";
+  bool        _mounted         = false;
+  bool        _recording       = false;
+  bool        _timeWritten     = false;  // TIME record of this segment
+
+  uint8_t       _buffer[BUFFER_SIZE];
+  size_t        _length    = 0;
+  unsigned long _lastFlush = 0;
+  uint32_t      _dropped   = 0;  // records lost to a full buffer or file system errors
+
+  SnapshotFunction _snapshot;
+
+  uint8_t* reserve(Type type, size_t payload);
+  void     writeTime();
+  void     writeCommand(Type type, const char* node, int16_t range, const char* property, const char* value);
+  void     flush();
+
+  static uint8_t* put(uint8_t* p, const void* data, size_t size);
+};
+
+extern TraceRecorder traceRecorder;
@@ -10,6 +10,8 @@
 #include "DallasTemperatureNode.hpp"
 #include "ESP32TemperatureNode.hpp"
 #include "RelayModuleNode.hpp"
+#include "RelayGroup.hpp"
+#include "Scheduler.hpp"
 #include "OperationModeNode.hpp"
 #include "Rule.hpp"
 #include "RuleManu.hpp"
@@ -17,9 +19,18 @@
 #include "RuleBoost.hpp"
 #include "RuleTimer.hpp"
 #include "ContactNode.hpp"
+#include "DiagnosticsNode.hpp"
+#include "HistoryNode.hpp"
+#include "Benchmark.hpp"
 
+#include "CrashLog.hpp"
+#include "Log.hpp"
 #include "LoggerNode.hpp"
+#include "PublishQueue.hpp"
+#include "SerialLogBuffer.hpp"
+#include "StateNode.hpp"
 #include "TimeClientHelper.hpp"
+#include "TraceRecorder.hpp"
 
 
 #ifdef ESP32
@@ -47,15 +58,29 @@ const uint8_t PIN_CONTACT = RX; // GPIO 3
 
 #endif
 const uint8_t TEMP_READ_INTERVALL = 30;  //Sekunden zwischen Updates der Temperaturen.
+const long RELAY_STATUS_INTERVAL = 300;  // in s, changes are published right away
+const long CONTACT_POLL_INTERVAL = 5;    // in s, a change is reported after two equal readings
+const unsigned long PUMP_STOP_DELAY = 3000;  // in ms, pump spin down before the valves move
 
+#define FIRMWARE_VERSION "2.0.0"
 
-HomieSetting<long> loopIntervalSetting("loop-interval", "The processing interval in seconds");
+
+HomieSetting<long> loopIntervalSetting("loop-interval", "Fallback in seconds for the interval settings of the nodes");
+HomieSetting<long> temperatureIntervalSetting("temperature-interval", "Reading interval of the temperature sensors in seconds");
+HomieSetting<long> relayIntervalSetting("relay-interval", "Status interval of the relays in seconds");
+HomieSetting<long> contactIntervalSetting("contact-interval", "Polling interval of the contacts in seconds");
+HomieSetting<const char*> sensorIntervalsSetting("sensor-intervals", "Intervals of single sensors: property:seconds[/seconds while the relay is on],...");
 
 HomieSetting<double> temperatureMaxPoolSetting("temperature-max-pool", "Maximum temperature of solar");
 HomieSetting<double> temperatureMinSolarSetting("temperature-min-solar", "Minimum temperature of solar");
 HomieSetting<double> temperatureHysteresisSetting("temperature-hysteresis", "Temperature hysteresis");
 
+HomieSetting<long> valveDelaySetting("valve-delay", "Travel time of the valves in seconds");
+
 HomieSetting<const char*> operationModeSetting("operation-mode", "Operational Mode");
+HomieSetting<const char*> timezoneSetting("timezone", "POSIX TZ string of the local time zone");
+HomieSetting<bool> traceSetting("trace", "Record sensor readings, commands and relay transitions from boot");
+HomieSetting<long> stateSpacingSetting("state-spacing", "Minimum spacing of the controller state document in seconds, 0 turns it off");
 
 LoggerNode LN;
 
@@ -106,8 +131,33 @@ ContactNode contactNode("waterflow", "Water Flow", PIN_CONTACT);
 
 OperationModeNode operationModeNode("operation-mode", "Operation Mode");
 
+DiagnosticsNode diagnosticsNode("diagnostics", "Diagnostics");
+
+StateNode stateNode("controller", "Controller State");
+
+HistoryNode historyNode("history", "History");
+
+#ifdef LOOP_PROFILING
+LoopStats mainLoopStats("main", "loop");
+#endif
+
+RelayGroup             circuitGroup;
+RelayGroup::Transition toPoolTransition;
+RelayGroup::Transition toSpaTransition;
+
 unsigned long _measurementInterval = 10;
 unsigned long _lastMeasurement;
+bool          _setupDone = false;  // the setup handler ran, Homie calls it once MQTT is connected
+
+/**
+ * Interval of a node class: its own setting, else loop-interval, else the default of the setting.
+ */
+long intervalOf(HomieSetting<long>& setting) {
+  if (setting.wasProvided() || !loopIntervalSetting.wasProvided()) {
+    return setting.get();
+  }
+  return loopIntervalSetting.get();
+}
 
 /**
  * Homie Setup handler.
@@ -115,23 +165,50 @@ unsigned long _lastMeasurement;
  */
 void setupHandler() {
 
-  // set mesurement intervals
-  long _loopInterval = loopIntervalSetting.get();
+  // first, to take in the values the nodes publish while set up
+  if (stateSpacingSetting.get() > 0 && !stateNode.isEnabled()) {
+    for (uint8_t i = 0; i < poolRequestUnKnown.entryCount; i++) {
+      stateNode.add(poolTemperatureNode, poolRequestUnKnown.entries[i].property);
+      stateNode.add(poolTemperatureNode, poolRequestUnKnown.entries[i].propertyState);
+    }
+    stateNode.add(solarTemperatureNode, "temperature");
+    stateNode.add(solarTemperatureNode, "state");
+
+    RelayModuleNode* relays[] = {&poolPumpNode, &solarPumpNode, &poolLightNode, &poolHeaterNode, &poolSuctionNode, &poolReturnNode};
+    for (RelayModuleNode* relay : relays) {
+      stateNode.add(*relay, "switch");
+    }
+    stateNode.add(contactNode, "open");
+
+    const char* const modeProperties[] = {"mode", "circuit", "pool-max-temp", "solar-min-temp", "hysteresis",
+                                          "timer-start-h", "timer-start-min", "timer-end-h", "timer-end-min"};
+    for (const char* property : modeProperties) {
+      stateNode.add(operationModeNode, property);
+    }
+    stateNode.begin(stateSpacingSetting.get() * 1000UL);
+  }
 
-  solarTemperatureNode.setMeasurementInterval(_loopInterval);
-  poolTemperatureNode.setMeasurementInterval(_loopInterval);
+  // set mesurement intervals, loop-interval is the fallback for configurations without the node settings
+  const long temperatureInterval = intervalOf(temperatureIntervalSetting);
 
-  poolPumpNode.setMeasurementInterval(_loopInterval);
-  solarPumpNode.setMeasurementInterval(_loopInterval);
-  poolLightNode.setMeasurementInterval(_loopInterval);
-  poolHeaterNode.setMeasurementInterval(_loopInterval);
-  poolSuctionNode.setMeasurementInterval(_loopInterval);
-  poolReturnNode.setMeasurementInterval(_loopInterval);
+  solarTemperatureNode.setMeasurementInterval(temperatureInterval);
+  poolTemperatureNode.setMeasurementInterval(temperatureInterval);
+  poolTemperatureNode.bindRelay("tempRetHeater", &poolHeaterNode);
+  poolTemperatureNode.setEntryIntervals(sensorIntervalsSetting.get());
 
-  contactNode.setMeasurementInterval(_loopInterval);
+  const long relayInterval = intervalOf(relayIntervalSetting);
+
+  poolPumpNode.setMeasurementInterval(relayInterval);
+  solarPumpNode.setMeasurementInterval(relayInterval);
+  poolLightNode.setMeasurementInterval(relayInterval);
+  poolHeaterNode.setMeasurementInterval(relayInterval);
+  poolSuctionNode.setMeasurementInterval(relayInterval);
+  poolReturnNode.setMeasurementInterval(relayInterval);
+
+  contactNode.setMeasurementInterval(intervalOf(contactIntervalSetting));
 
 #ifdef ESP32
-  ctrlTemperatureNode.setMeasurementInterval(_loopInterval);
+  ctrlTemperatureNode.setMeasurementInterval(temperatureInterval);
 #endif
 
   operationModeNode.setMode(operationModeSetting.get());
@@ -145,6 +222,19 @@ void setupHandler() {
   ts.timerEndMinutes = 30;
   operationModeNode.setTimerSetting(ts);
 
+  // pump and heater off, both valves together, pump on again after the valves moved if it was running
+  const unsigned long valveDelay = valveDelaySetting.get() * 1000UL;
+  toPoolTransition.clear();
+  toPoolTransition.set(&poolPumpNode, false).set(&poolHeaterNode, false)
+      .then(PUMP_STOP_DELAY).set(&poolSuctionNode, false).set(&poolReturnNode, false)
+      .then(valveDelay).restore(&poolPumpNode);
+  toSpaTransition.clear();
+  toSpaTransition.set(&poolPumpNode, false).set(&poolHeaterNode, false)
+      .then(PUMP_STOP_DELAY).set(&poolSuctionNode, true).set(&poolReturnNode, true)
+      .then(valveDelay).restore(&poolPumpNode);
+  operationModeNode.setCircuitTransitions(&circuitGroup, &toPoolTransition, &toSpaTransition);
+  operationModeNode.setCircuitValves(&poolSuctionNode, &poolReturnNode);
+
   operationModeNode.setPoolTemperaturNode(&poolTemperatureNode);
   operationModeNode.setSolarTemperatureNode(&solarTemperatureNode);
 
@@ -161,21 +251,62 @@ void setupHandler() {
   RuleTimer* timerRule = new RuleTimer(&solarPumpNode, &poolPumpNode);
   operationModeNode.addRule(timerRule);
 
+  // the trace starts with what the commands of the trace build on
+  traceRecorder.setSnapshotFunction([]() {
+    const char* mode = operationModeNode.getId();
+    traceRecorder.state(mode, "mode", operationModeNode.getMode().c_str());
+    traceRecorder.state(mode, "pool-max-temp", String(operationModeNode.getPoolMaxTemperature()).c_str());
+    traceRecorder.state(mode, "solar-min-temp", String(operationModeNode.getSolarMinTemperature()).c_str());
+    traceRecorder.state(mode, "hysteresis", String(operationModeNode.getTemperaturHysteresis()).c_str());
+
+    const TimerSetting timer = operationModeNode.getTimerSetting();
+    traceRecorder.state(mode, "timer-start-h", String(timer.timerStartHour).c_str());
+    traceRecorder.state(mode, "timer-start-min", String(timer.timerStartMinutes).c_str());
+    traceRecorder.state(mode, "timer-end-h", String(timer.timerEndHour).c_str());
+    traceRecorder.state(mode, "timer-end-min", String(timer.timerEndMinutes).c_str());
+
+    RelayModuleNode* relays[] = {&poolPumpNode, &solarPumpNode, &poolLightNode, &poolHeaterNode, &poolSuctionNode, &poolReturnNode};
+    for (RelayModuleNode* relay : relays) {
+      traceRecorder.state(relay->getId(), "switch", relay->getSwitch() ? "true" : "false");
+    }
+    // after the valves, the circuit in their position needs no transition
+    traceRecorder.state(mode, "circuit", operationModeNode.getCircuit().c_str());
+  });
+  traceRecorder.begin(FIRMWARE_VERSION);
+  if (traceSetting.get()) {
+    traceRecorder.start();
+  }
+
   _lastMeasurement = 0;
+  _setupDone       = true;
 }
 
+#ifdef BENCHMARK
+/**
+ * Runs the benchmarks on the nodes of the firmware, see Benchmark.hpp.
+ */
+void runBenchmarks(Print& out) {
+  serialLog.flush();
+  Benchmarks::run(out, FIRMWARE_VERSION, {&operationModeNode, &poolPumpNode, &poolTemperatureNode, &LN});
+}
+#endif
+
 /**
  * Startup of controller.
  */
 void setup() {
+  // relays first: bring back the state from before a reset within ms of boot
+  RelayModuleNode::restoreAll();
+  crashLog.begin();
+
   Serial.begin(SERIAL_SPEED);
 
   while (!Serial) {
     ;  // wait for serial port to connect. Needed for native USB port only
   }
-  Homie.setLoggingPrinter(&Serial);
+  Homie.setLoggingPrinter(&serialLog);
 
-  Homie_setFirmware("pool-controller", "2.0.0");
+  Homie_setFirmware("pool-controller", FIRMWARE_VERSION);
   Homie_setBrand("smart-swimmingpool");
 
   //WiFi.setSleepMode(WIFI_NONE_SLEEP); //see: https://github.com/esp8266/Arduino/issues/5083
@@ -185,6 +316,26 @@ void setup() {
     return (candidate >= 0) && (candidate <= 300);
   });
 
+  temperatureIntervalSetting.setDefaultValue(TEMP_READ_INTERVALL).setValidator([](long candidate) {
+    return (candidate >= 1) && (candidate <= 3600);
+  });
+
+  relayIntervalSetting.setDefaultValue(RELAY_STATUS_INTERVAL).setValidator([](long candidate) {
+    return (candidate >= 1) && (candidate <= 3600);
+  });
+
+  contactIntervalSetting.setDefaultValue(CONTACT_POLL_INTERVAL).setValidator([](long candidate) {
+    return (candidate >= 1) && (candidate <= 300);
+  });
+
+  sensorIntervalsSetting.setDefaultValue("tempRetHeater:30/5").setValidator([](const char* candidate) {
+    return DallasTemperatureNode::isValidIntervals(candidate);
+  });
+
+  valveDelaySetting.setDefaultValue(30).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 120);
+  });
+
   temperatureMaxPoolSetting.setDefaultValue(75.5).setValidator(
       [](long candidate) { return (candidate >= 0) && (candidate <= 100); });
 
@@ -198,20 +349,70 @@ void setup() {
     return (strcmp(candidate, "auto")) || (strcmp(candidate, "manu")) || (strcmp(candidate, "boost"));
   });
 
+  timezoneSetting.setDefaultValue("PST8PDT,M3.2.0,M11.1.0").setValidator([](const char* candidate) {
+    return PosixTimezone::isValidRule(candidate);
+  });
+
+  traceSetting.setDefaultValue(false);
+
+  stateSpacingSetting.setDefaultValue(0).setValidator([](long candidate) {
+    return (candidate >= 0) && (candidate <= 3600);
+  });
+
+  // every command into the trace, the node handles it afterwards
+  Homie.setGlobalInputHandler([](const HomieNode& node, const HomieRange& range, const String& property, const String& value) {
+    traceRecorder.input(node.getId(), range.isRange ? range.index : -1, property.c_str(), value.c_str());
+    return false;
+  });
+
   //Homie.disableLogging();
   Homie.setSetupFunction(setupHandler);
 
   LN.log(__PRETTY_FUNCTION__, LoggerNode::DEBUG, "Before Homie setup())");
   Homie.setup();
 
+  setTimezone(timezoneSetting.get());
+  timeClientSetup();
+
   LN.logf(__PRETTY_FUNCTION__, LoggerNode::DEBUG, "Free heap: %d", ESP.getFreeHeap());
-  Homie.getLogger() << F("Free heap: ") << ESP.getFreeHeap() << endl;
+  LOG_INFO << F("Free heap: ") << ESP.getFreeHeap() << endl;
 }
 
 /**
  * Main loop of ESP.
  */
 void loop() {
+  PROFILE_SCOPE(mainLoopStats);
 
+  crashLog.setPhase(CrashLog::PHASE_TIME_CLIENT);
+  timeClientLoop();
+
+  crashLog.setPhase(CrashLog::PHASE_HOMIE);
   Homie.loop();
+
+  // while disconnected only the tasks marked to run offline, see Scheduler.hpp
+  crashLog.setPhase(CrashLog::PHASE_SCHEDULER);
+  scheduler.loop(Homie.isConnected());
+
+  crashLog.setPhase(CrashLog::PHASE_RELAYS);
+  circuitGroup.loop();
+  RelayModuleNode::storeLoop();
+
+  crashLog.setPhase(CrashLog::PHASE_LOG);
+  LN.flush();  // log traffic after the control publishes of this pass
+  if (_setupDone) {
+    serialLog.endBoot();  // the output of the setup handler's pass is in the ring
+  }
+  serialLog.loop();
+  traceRecorder.loop();
+
+  crashLog.setPhase(CrashLog::PHASE_PUBLISH);
+  publishQueue.loop();
+
+#ifdef BENCHMARK
+  // "b" on the serial console
+  if (Serial.available() > 0 && Serial.read() == 'b') {
+    runBenchmarks(Serial);
+  }
+#endif
 }
@@ -0,0 +1,289 @@
+/**
+ * DallasTemperatureNode against the simulated 1-Wire bus of the native
+ * build: what it publishes when sensors drop out, send broken scratchpads,
+ * convert too slowly or brown out on parasite power, and the bus and
+ * conversion wait time of a measurement.
+ *
+ *   pio test -e native-test
+ *
+ * Every test has its own node on its own pin, the nodes run by the
+ * scheduler on the virtual clock like in the firmware.
+ */
+
+#include <Arduino.h>
+#include <Homie.hpp>
+#include <NativeHal.hpp>
+#include <unity.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DallasTemperatureNode.hpp"
+#include "OneWireBus.hpp"
+#include "PublishQueue.hpp"
+#include "Scheduler.hpp"
+
+namespace {
+
+const unsigned long INTERVAL = 60;  // in s, the shortest of the node
+const unsigned long STEP     = 10;  // in ms
+
+/** Exposes setup(), the tests set up their node after attaching the devices. */
+class TestNode : public DallasTemperatureNode {
+public:
+  using DallasTemperatureNode::DallasTemperatureNode;
+  using DallasTemperatureNode::setup;
+};
+
+DallasProperties oneSensor     = {1, {{0, "temp", "Temp", "tempState", "Temp State", ""}}};
+DallasProperties twoSensors    = {2, {{0, "tempA", "Temp A", "tempAState", "Temp A State", ""},
+                                      {1, "tempB", "Temp B", "tempBState", "Temp B State", ""}}};
+DallasProperties crcSensor     = {1, {{0, "temp", "Temp", "tempState", "Temp State", ""}}};
+DallasProperties dropoutSensor = {1, {{0, "temp", "Temp", "tempState", "Temp State", ""}}};
+DallasProperties slowSensor    = {1, {{0, "temp", "Temp", "tempState", "Temp State", ""}}};
+DallasProperties badAddress    = {1, {{0, "temp", "Temp", "tempState", "Temp State", "2800000000000001"}}};
+
+TestNode readingNode(&twoSensors, "reading", "Reading", "Ambient", 0, INTERVAL);
+TestNode crcNode(&crcSensor, "crc", "CRC", "Ambient", 1, INTERVAL);
+TestNode dropoutNode(&dropoutSensor, "dropout", "Dropout", "Ambient", 2, INTERVAL);
+TestNode slowNode(&slowSensor, "slow", "Slow", "Ambient", 3, INTERVAL);
+TestNode parasiteNode(&oneSensor, "parasite", "Parasite", "Ambient", 4, INTERVAL);
+TestNode addressNode(&badAddress, "address", "Address", "Ambient", 5, INTERVAL);
+TestNode emptyNode("empty", "Empty", "Ambient", 6, INTERVAL);
+
+std::map<std::string, std::vector<std::string>> published;
+std::map<std::string, std::vector<uint64_t>>    publishedAt;  // in us
+
+/** Runs the scheduler and the publish queue for the given time. */
+void run(unsigned long seconds) {
+  const uint64_t end = hal::nowMicros() + seconds * 1000000ULL;
+  while (hal::nowMicros() < end) {
+    scheduler.loop();
+    publishQueue.loop();
+    hal::advanceMillis(STEP);
+  }
+}
+
+const std::vector<std::string>& values(const char* topic) {
+  return published[topic];
+}
+
+std::string last(const char* topic) {
+  const std::vector<std::string>& list = values(topic);
+  return list.empty() ? std::string() : list.back();
+}
+
+size_t count(const char* topic, const char* value) {
+  size_t n = 0;
+  for (const std::string& v : values(topic)) n += (v == value);
+  return n;
+}
+
+}  // namespace
+
+void setUp() {
+  published.clear();
+  publishedAt.clear();
+}
+
+/** The devices live on the stack of a test, a failed one leaves them attached. */
+void tearDown() {
+  for (uint8_t pin = 0; pin < hal::NUM_PINS; pin++) hal::oneWireBus(pin).clear();
+}
+
+/**
+ * Two fault-free sensors, found in ROM search order: their readings and a
+ * bus time of a few ms per measurement besides the 750 ms of conversion at
+ * 12 bit.
+ */
+void test_readings_and_bus_time() {
+  hal::Ds18b20 a(0x100, hal::waveform::constant(25.0F));
+  hal::Ds18b20 b(0x101, hal::waveform::constant(30.0F));
+  hal::OneWireBus& bus = hal::oneWireBus(0);
+  bus.attach(&a);
+  bus.attach(&b);
+  readingNode.setup();
+  bus.resetStats();
+
+  run(3 * INTERVAL);
+
+  TEST_ASSERT_EQUAL_STRING("77.00", last("reading/tempA").c_str());
+  TEST_ASSERT_EQUAL_STRING("86.00", last("reading/tempB").c_str());
+  TEST_ASSERT_EQUAL_STRING("OK", last("reading/tempAState").c_str());
+  TEST_ASSERT_EQUAL_STRING("OK", last("reading/tempBState").c_str());
+
+  const hal::OneWireBus::Stats& stats        = bus.getStats();
+  const uint32_t                measurements = a.getConversions();
+  TEST_ASSERT_EQUAL_UINT32(3, measurements);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.noPresence);
+  TEST_ASSERT_UINT32_WITHIN(10000, 750000, (uint32_t)stats.maxWaitMicros);
+  TEST_ASSERT_UINT32_WITHIN(30000, 750000 * measurements, (uint32_t)stats.waitMicros);
+  // the polling slots during the conversion count to both
+  TEST_ASSERT_LESS_THAN_UINT32(30000, (uint32_t)((stats.busMicros - stats.waitMicros) / measurements));
+}
+
+/**
+ * Scratchpads with a broken CRC are reported as Error without a reading,
+ * the node recovers with the next good read.
+ */
+void test_crc_errors() {
+  hal::Ds18b20 sensor(0x201, hal::waveform::constant(20.0F));
+  hal::oneWireBus(1).attach(&sensor);
+  crcNode.setup();
+
+  sensor.setCrcErrorRate(1.0F);
+  run(2 * INTERVAL);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, sensor.getCrcErrors());
+  TEST_ASSERT_EQUAL_STRING("Error", last("crc/tempState").c_str());
+  TEST_ASSERT_EQUAL(0, values("crc/temp").size());
+
+  sensor.setCrcErrorRate(0.0F);
+  run(INTERVAL);
+  TEST_ASSERT_EQUAL_STRING("OK", last("crc/tempState").c_str());
+  TEST_ASSERT_EQUAL_STRING("68.00", last("crc/temp").c_str());
+}
+
+/**
+ * A sensor missing single transactions gives Error for those measurements
+ * and OK for the others, one missing from the bus only Error.
+ */
+void test_dropouts() {
+  hal::Ds18b20 sensor(0x301, hal::waveform::constant(22.5F));
+  hal::OneWireBus& bus = hal::oneWireBus(2);
+  bus.attach(&sensor);
+  dropoutNode.setup();
+
+  sensor.setSeed(42);
+  sensor.setDropoutRate(0.3F);
+  run(20 * INTERVAL);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, sensor.getDropouts());
+  TEST_ASSERT_GREATER_THAN(0, count("dropout/tempState", "Error"));
+  TEST_ASSERT_GREATER_THAN(0, count("dropout/tempState", "OK"));
+  TEST_ASSERT_EQUAL(count("dropout/tempState", "OK"), values("dropout/temp").size());
+
+  published.clear();
+  sensor.setDropoutRate(0.0F);
+  sensor.setConnected(false);
+  run(2 * INTERVAL);
+  TEST_ASSERT_EQUAL(0, count("dropout/tempState", "OK"));
+  TEST_ASSERT_EQUAL_STRING("Error", last("dropout/tempState").c_str());
+  TEST_ASSERT_GREATER_THAN_UINT32(0, bus.getStats().noPresence);
+
+  sensor.setConnected(true);
+  run(INTERVAL);
+  TEST_ASSERT_EQUAL_STRING("OK", last("dropout/tempState").c_str());
+  TEST_ASSERT_EQUAL_STRING("72.50", last("dropout/temp").c_str());
+}
+
+/**
+ * A conversion slower than the datasheet maximum: the node stops waiting
+ * after 750 ms and reads the scratchpad of the conversion before, the
+ * power-on 85 °C the first time, which is reported as Error.
+ */
+void test_slow_conversion() {
+  const uint64_t step = hal::nowMicros() + 150 * 1000000ULL;
+  hal::Ds18b20   sensor(0x401, hal::waveform::step(20.0F, 30.0F, step / 1e6));
+  hal::OneWireBus& bus = hal::oneWireBus(3);
+  bus.attach(&sensor);
+  slowNode.setup();
+  bus.resetStats();
+
+  sensor.setConversionFactor(1.5F);
+  run(INTERVAL);
+  TEST_ASSERT_EQUAL_STRING("Error", last("slow/tempState").c_str());
+  TEST_ASSERT_UINT32_WITHIN(10000, 750000, (uint32_t)bus.getStats().maxWaitMicros);
+
+  run(4 * INTERVAL);
+  TEST_ASSERT_EQUAL_STRING("OK", last("slow/tempState").c_str());
+
+  // one conversion behind: the first reading after the step is the one before
+  const std::vector<std::string>& readings = values("slow/temp");
+  const std::vector<uint64_t>&    times    = publishedAt["slow/temp"];
+  size_t                          i        = 0;
+  while (i < times.size() && times[i] < step) i++;
+  TEST_ASSERT_LESS_THAN_UINT32(readings.size() - 1, i);
+  TEST_ASSERT_EQUAL_STRING("68.00", readings[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("68.00", readings[i].c_str());
+  TEST_ASSERT_EQUAL_STRING("86.00", readings[i + 1].c_str());
+}
+
+/**
+ * A parasite powered sensor gets the strong pull-up for the whole 750 ms,
+ * a slower one browns out when it ends and comes back with 85 °C.
+ */
+void test_parasite_brownout() {
+  hal::Ds18b20 sensor(0x501, hal::waveform::constant(24.0F));
+  sensor.setParasite(true);
+  hal::OneWireBus& bus = hal::oneWireBus(4);
+  bus.attach(&sensor);
+  parasiteNode.setup();
+  bus.resetStats();
+
+  run(INTERVAL);
+  TEST_ASSERT_EQUAL_UINT32(0, sensor.getBrownouts());
+  TEST_ASSERT_EQUAL_STRING("OK", last("parasite/tempState").c_str());
+  TEST_ASSERT_EQUAL_STRING("75.20", last("parasite/temp").c_str());
+  TEST_ASSERT_UINT32_WITHIN(1000, 750000, (uint32_t)bus.getStats().maxWaitMicros);
+
+  published.clear();
+  sensor.setConversionFactor(1.2F);
+  run(2 * INTERVAL);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, sensor.getBrownouts());
+  TEST_ASSERT_EQUAL_STRING("Error", last("parasite/tempState").c_str());
+  TEST_ASSERT_EQUAL(0, values("parasite/temp").size());
+
+  sensor.setConversionFactor(1.0F);
+  run(INTERVAL);
+  TEST_ASSERT_EQUAL_STRING("OK", last("parasite/tempState").c_str());
+}
+
+/**
+ * A configured address with a broken CRC is reported as InvalidAddress.
+ */
+void test_invalid_address() {
+  hal::Ds18b20 sensor(0x601);
+  hal::oneWireBus(5).attach(&sensor);
+  addressNode.setup();
+
+  run(INTERVAL);
+  TEST_ASSERT_EQUAL_STRING("InvalidAddress", last("address/tempState").c_str());
+  TEST_ASSERT_EQUAL(0, values("address/temp").size());
+}
+
+/**
+ * Without sensors the node raises $state alert and searches the bus again,
+ * a sensor attached later is found and read.
+ */
+void test_alert_and_reinit() {
+  emptyNode.setup();
+
+  run(2 * INTERVAL);
+  TEST_ASSERT_EQUAL(2, count("empty/$state", "alert"));
+  TEST_ASSERT_EQUAL(0, values("empty/temperature").size());
+
+  hal::Ds18b20 sensor(0x701, hal::waveform::constant(25.0F));
+  hal::oneWireBus(6).attach(&sensor);
+  run(3 * INTERVAL);
+  TEST_ASSERT_LESS_OR_EQUAL(3, count("empty/$state", "alert"));
+  TEST_ASSERT_GREATER_THAN(0, values("empty/temperature").size());
+  TEST_ASSERT_NOT_NULL(strstr(last("empty/temperature").c_str(), "\"Temperature\":77.0"));
+}
+
+int main(int argc, char** argv) {
+  hal::setVirtualClock(true);
+  Homie.setPublishHook([](const char* topic, const char* value, bool retained) {
+    published[topic].push_back(value);
+    publishedAt[topic].push_back(hal::nowMicros());
+  });
+
+  UNITY_BEGIN();
+  RUN_TEST(test_readings_and_bus_time);
+  RUN_TEST(test_crc_errors);
+  RUN_TEST(test_dropouts);
+  RUN_TEST(test_slow_conversion);
+  RUN_TEST(test_parasite_brownout);
+  RUN_TEST(test_invalid_address);
+  RUN_TEST(test_alert_and_reinit);
+  return UNITY_END();
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+Decodes binary log records of the pool controller (see src/BinaryLog.hpp).
+
+Reads hex records, e.g. the "logbin" property of the Log node, one or more
+records per line, and prints them formatted with src/LogFormats.def:
+
+  mosquitto_sub -h <MQTT_HOST> -t 'homie/pool-controller/Log/logbin' | tools/logdecode.py
+
+JSON lines, like the "crash" property, are decoded from their "Records" field.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+LEVELS = ["DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL"]
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)[hlzjt]*([diuxXocfeEgG%])")
+
+
+def load_formats(path):
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    return re.findall(r'^LOG_FORMAT\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', text, re.MULTILINE)
+
+
+def format_record(fmt, args):
+    values = iter(args)
+
+    def convert(match):
+        flags, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        raw = next(values, None)
+        if raw is None:
+            return "?"
+        if conversion in "feEgG":
+            return ("%" + flags + conversion) % struct.unpack("<f", struct.pack("<I", raw))[0]
+        if conversion in "di":
+            return ("%" + flags + "d") % struct.unpack("<i", struct.pack("<I", raw))[0]
+        if conversion == "c":
+            return chr(raw)
+        return ("%" + flags + (conversion if conversion in "xXo" else "d")) % raw
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(data, formats):
+    pos = 0
+    while pos + 8 <= len(data):
+        time, descriptor = struct.unpack_from("<II", data, pos)
+        pos += 8
+        record_id = descriptor & 0xFFFF
+        level = (descriptor >> 16) & 0xFF
+        argc = descriptor >> 24
+        args = struct.unpack_from("<%dI" % argc, data, pos)
+        pos += 4 * argc
+
+        if record_id < len(formats):
+            name, fmt = formats[record_id]
+            text = format_record(fmt, args)
+        else:
+            name, text = "LOG_%d" % record_id, " ".join("%08x" % a for a in args)
+        level_name = LEVELS[level] if level < len(LEVELS) else str(level)
+        yield "%d [%s]: %s: %s" % (time, level_name, name, text)
+
+
+def main():
+    default_table = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "LogFormats.def")
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--formats", default=default_table, help="format table (default: src/LogFormats.def)")
+    parser.add_argument("input", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    options = parser.parse_args()
+
+    formats = load_formats(options.formats)
+    for line in options.input:
+        line = line.strip()
+        if not line:
+            continue
+        if line.startswith("{"):
+            report = json.loads(line)
+            print("reset: %s, phase: %s" % (report.get("Reason"), report.get("Phase")))
+            line = report.get("Records", "")
+        try:
+            data = bytes.fromhex(line)
+        except ValueError:
+            print("invalid hex: " + line, file=sys.stderr)
+            continue
+        for text in decode(data, formats):
+            print(text)
+
+
+if __name__ == "__main__":
+    main()